@@ -49,6 +49,9 @@
 #include "../gpu/drm/rockchip/rockchip_drm_drv.h"
 #include "../opp/opp.h"
 
+#define CREATE_TRACE_POINTS
+#include "rockchip_dmc_trace.h"
+
 #define system_status_to_dmcfreq(nb) container_of(nb, struct rockchip_dmcfreq, \
 						  status_nb)
 #define reboot_to_dmcfreq(nb) container_of(nb, struct rockchip_dmcfreq, \
@@ -64,6 +67,9 @@
 #define FALLBACK_STATIC_TEMPERATURE	55000
 #define MAX_FREQ_COUNT			6
 
+#define DMC_PREDICT_HIST_NUM		8
+#define DMC_PREDICT_HOLD_MS		1000
+
 struct dmc_freq_table {
 	unsigned long freq;
 	struct dev_pm_opp_supply supplies[2];
@@ -104,10 +110,44 @@ struct rockchip_dmcfreq_ondemand_data {
 	unsigned int downdifferential;
 };
 
+/*
+ * The system status which are known to be followed by a bandwidth demand,
+ * the demand seen during the last time of each one is used as soon as it
+ * is set again.
+ */
+static const unsigned long dmc_predict_status[] = {
+	SYS_STATUS_VIDEO_1080P,
+	SYS_STATUS_VIDEO_4K,
+	SYS_STATUS_VIDEO_4K_10B,
+	SYS_STATUS_VIDEO_4K_60P,
+	SYS_STATUS_VIDEO_SVEP,
+	SYS_STATUS_HDMI,
+	SYS_STATUS_HDMIRX,
+	SYS_STATUS_PERFORMANCE,
+};
+
+struct rockchip_dmcfreq_predict_data {
+	/* demand history of each devfreq-event, indexed as dmcfreq->edev */
+	unsigned long (*hist)[DMC_PREDICT_HIST_NUM];
+	unsigned int hist_idx;
+	unsigned int hist_cnt;
+
+	/* set by the system status notifier, handled by the governor */
+	unsigned long status;
+	unsigned long last_status;
+	unsigned long event_rate[ARRAY_SIZE(dmc_predict_status)];
+	unsigned long event_peak[ARRAY_SIZE(dmc_predict_status)];
+
+	unsigned long hold_rate;
+	u64 hold_endtime;
+	unsigned int hold_ms;
+};
+
 struct rockchip_dmcfreq {
 	struct device *dev;
 	struct dmcfreq_common_info info;
 	struct rockchip_dmcfreq_ondemand_data ondemand_data;
+	struct rockchip_dmcfreq_predict_data predict_data;
 	struct clk *dmc_clk;
 	struct devfreq_event_dev **edev;
 	struct mutex lock; /* serializes access to video_info_list */
@@ -161,6 +201,7 @@ struct rockchip_dmcfreq {
 
 	bool is_fixed;
 	bool is_set_rate_direct;
+	bool is_predict;
 
 	unsigned int touchboostpulse_duration_val;
 	u64 touchboostpulse_endtime;
@@ -2534,6 +2575,8 @@ static int rockchip_dmcfreq_system_status_notifier(struct notifier_block *nb,
 	unsigned int refresh = false;
 	bool is_fixed = false;
 
+	WRITE_ONCE(dmcfreq->predict_data.status, status);
+
 	if (dmcfreq->fixed_rate && (is_dualview(status) || is_isp(status))) {
 		if (dmcfreq->is_fixed)
 			return NOTIFY_OK;
@@ -2715,25 +2758,46 @@ static ssize_t downdifferential_store(struct device *dev,
 
 static DEVICE_ATTR_RW(downdifferential);
 
-static unsigned long get_nocp_req_rate(struct rockchip_dmcfreq *dmcfreq)
+static unsigned long cpu_bw_2_rate(struct rockchip_dmcfreq *dmcfreq,
+				   unsigned long cpu_bw)
 {
-	unsigned long target = 0, cpu_bw = 0;
+	unsigned long target = 0;
 	int i;
 
-	if (!dmcfreq->cpu_bw_tbl || dmcfreq->nocp_cpu_id < 0)
-		goto out;
-
-	cpu_bw = dmcfreq->nocp_bw[dmcfreq->nocp_cpu_id];
-
 	for (i = 0; dmcfreq->cpu_bw_tbl[i].freq != CPUFREQ_TABLE_END; i++) {
 		if (cpu_bw >= dmcfreq->cpu_bw_tbl[i].min)
 			target = dmcfreq->cpu_bw_tbl[i].freq;
 	}
 
-out:
 	return target;
 }
 
+static unsigned long get_nocp_req_rate(struct rockchip_dmcfreq *dmcfreq)
+{
+	if (!dmcfreq->cpu_bw_tbl || dmcfreq->nocp_cpu_id < 0)
+		return 0;
+
+	return cpu_bw_2_rate(dmcfreq, dmcfreq->nocp_bw[dmcfreq->nocp_cpu_id]);
+}
+
+/* the rate requested by system status, vop and touch boost */
+static unsigned long get_req_rate(struct rockchip_dmcfreq *dmcfreq)
+{
+	unsigned long target_freq = 0;
+	u64 now;
+
+	if (dmcfreq->status_rate)
+		target_freq = dmcfreq->status_rate;
+	else if (dmcfreq->auto_min_rate)
+		target_freq = dmcfreq->auto_min_rate;
+	target_freq = max(target_freq, dmcfreq->info.vop_req_rate);
+	now = ktime_to_us(ktime_get());
+	if (now < dmcfreq->touchboostpulse_endtime)
+		target_freq = max(target_freq, dmcfreq->boost_rate);
+
+	return target_freq;
+}
+
 static int devfreq_dmc_ondemand_func(struct devfreq *df,
 				     unsigned long *freq)
 {
@@ -2744,20 +2808,11 @@ static int devfreq_dmc_ondemand_func(struct devfreq *df,
 	struct rockchip_dmcfreq_ondemand_data *data = &dmcfreq->ondemand_data;
 	unsigned int upthreshold = data->upthreshold;
 	unsigned int downdifferential = data->downdifferential;
-	unsigned long target_freq = 0, nocp_req_rate = 0;
-	u64 now;
+	unsigned long target_freq = 0;
 
 	if (dmcfreq->info.auto_freq_en && !dmcfreq->is_fixed) {
-		if (dmcfreq->status_rate)
-			target_freq = dmcfreq->status_rate;
-		else if (dmcfreq->auto_min_rate)
-			target_freq = dmcfreq->auto_min_rate;
-		nocp_req_rate = get_nocp_req_rate(dmcfreq);
-		target_freq = max3(target_freq, nocp_req_rate,
-				   dmcfreq->info.vop_req_rate);
-		now = ktime_to_us(ktime_get());
-		if (now < dmcfreq->touchboostpulse_endtime)
-			target_freq = max(target_freq, dmcfreq->boost_rate);
+		target_freq = max(get_req_rate(dmcfreq),
+				  get_nocp_req_rate(dmcfreq));
 	} else {
 		if (dmcfreq->status_rate)
 			target_freq = dmcfreq->status_rate;
@@ -2873,6 +2928,217 @@ static struct devfreq_governor devfreq_dmc_ondemand = {
 	.event_handler = devfreq_dmc_ondemand_handler,
 };
 
+/*
+ * The predicted demand of a source is the larger one of the last sample
+ * plus its rise since the previous sample, and the peak of the history
+ * weighted down by its age, so a short dip does not drop the rate at once.
+ */
+static unsigned long dmc_predict_demand(struct rockchip_dmcfreq_predict_data *data,
+					unsigned long *hist)
+{
+	unsigned long last, prev, peak;
+	unsigned int idx, age;
+
+	if (!data->hist_cnt)
+		return 0;
+
+	idx = (data->hist_idx + DMC_PREDICT_HIST_NUM - 1) % DMC_PREDICT_HIST_NUM;
+	last = hist[idx];
+	peak = last;
+	if (data->hist_cnt > 1) {
+		prev = hist[(idx + DMC_PREDICT_HIST_NUM - 1) % DMC_PREDICT_HIST_NUM];
+		if (last > prev)
+			peak = last + (last - prev);
+	}
+
+	for (age = 1; age < data->hist_cnt; age++) {
+		prev = hist[(idx + DMC_PREDICT_HIST_NUM - age) % DMC_PREDICT_HIST_NUM];
+		prev = prev / DMC_PREDICT_HIST_NUM * (DMC_PREDICT_HIST_NUM - age);
+		peak = max(peak, prev);
+	}
+
+	return peak;
+}
+
+/* the rate at which the dfi demand in kHz gives the target load */
+static unsigned long dmc_predict_dfi_rate(struct rockchip_dmcfreq *dmcfreq,
+					  unsigned long demand)
+{
+	struct rockchip_dmcfreq_ondemand_data *od = &dmcfreq->ondemand_data;
+	u64 rate;
+
+	rate = (u64)demand * 1000 * 100;
+	rate = div_u64(rate, od->upthreshold - od->downdifferential / 2);
+
+	return min_t(u64, rate, DEVFREQ_MAX_FREQ);
+}
+
+/*
+ * Start to hold the rate learned for the status which is newly set, and
+ * learn the peak rate needed while a status is set once it is cleared.
+ */
+static void dmc_predict_update_status(struct rockchip_dmcfreq *dmcfreq, u64 now)
+{
+	struct rockchip_dmcfreq_predict_data *data = &dmcfreq->predict_data;
+	unsigned long status = READ_ONCE(data->status);
+	unsigned long set = status & ~data->last_status;
+	unsigned long clr = data->last_status & ~status;
+	bool hold = false;
+	int i;
+
+	if (!set && !clr)
+		return;
+
+	if (now >= data->hold_endtime)
+		data->hold_rate = 0;
+
+	for (i = 0; i < ARRAY_SIZE(dmc_predict_status); i++) {
+		if (clr & dmc_predict_status[i]) {
+			if (data->event_rate[i])
+				data->event_rate[i] = data->event_rate[i] / 2 +
+						      data->event_peak[i] / 2;
+			else
+				data->event_rate[i] = data->event_peak[i];
+		}
+		if (set & dmc_predict_status[i]) {
+			data->event_peak[i] = 0;
+			if (data->event_rate[i]) {
+				data->hold_rate = max(data->hold_rate,
+						      data->event_rate[i]);
+				hold = true;
+			}
+		}
+	}
+
+	if (hold) {
+		data->hold_endtime = now + data->hold_ms * USEC_PER_MSEC;
+		trace_rockchip_dmcfreq_predict_event(status, data->hold_rate,
+						     data->hold_ms);
+	}
+	data->last_status = status;
+}
+
+static void dmc_predict_learn(struct rockchip_dmcfreq_predict_data *data,
+			      unsigned long rate)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(dmc_predict_status); i++) {
+		if (data->last_status & dmc_predict_status[i])
+			data->event_peak[i] = max(data->event_peak[i], rate);
+	}
+}
+
+static int devfreq_dmc_predict_func(struct devfreq *df,
+				    unsigned long *freq)
+{
+	struct rockchip_dmcfreq *dmcfreq = dev_get_drvdata(df->dev.parent);
+	struct rockchip_dmcfreq_ondemand_data *od = &dmcfreq->ondemand_data;
+	struct rockchip_dmcfreq_predict_data *data = &dmcfreq->predict_data;
+	unsigned int upthreshold = od->upthreshold;
+	unsigned int downdifferential = od->downdifferential;
+	unsigned long req_rate, dfi_rate = 0, nocp_rate = 0, hold_rate = 0;
+	unsigned long cur_rate, need_rate = 0, target_freq, demand;
+	struct devfreq_dev_status *stat;
+	u64 now;
+	int i;
+
+	if (!dmcfreq->info.auto_freq_en || dmcfreq->is_fixed ||
+	    !upthreshold || !downdifferential || upthreshold > 100 ||
+	    upthreshold < downdifferential)
+		return devfreq_dmc_ondemand_func(df, freq);
+
+	if (devfreq_update_stats(df)) {
+		reset_last_status(df);
+		*freq = df->previous_freq;
+		return 0;
+	}
+
+	now = ktime_to_us(ktime_get());
+	dmc_predict_update_status(dmcfreq, now);
+	req_rate = get_req_rate(dmcfreq);
+
+	stat = &df->last_status;
+	cur_rate = stat->current_frequency;
+
+	/* Set MAX if the load or the initial frequency is unknown */
+	if (stat->total_time == 0 || cur_rate == 0) {
+		*freq = DEVFREQ_MAX_FREQ;
+		return 0;
+	}
+
+	/* Prevent overflow */
+	if (stat->busy_time >= (1 << 24) || stat->total_time >= (1 << 24)) {
+		stat->busy_time >>= 7;
+		stat->total_time >>= 7;
+	}
+
+	/* the demand of dfi is in kHz, the others are the raw bandwidth */
+	for (i = 0; i < dmcfreq->edev_count; i++) {
+		if (i == dmcfreq->dfi_id)
+			demand = div_u64((u64)stat->busy_time * (cur_rate / 1000),
+					 stat->total_time);
+		else
+			demand = dmcfreq->nocp_bw[i];
+		data->hist[i][data->hist_idx] = demand;
+	}
+	data->hist_idx = (data->hist_idx + 1) % DMC_PREDICT_HIST_NUM;
+	if (data->hist_cnt < DMC_PREDICT_HIST_NUM)
+		data->hist_cnt++;
+
+	if (dmcfreq->dfi_id >= 0) {
+		/* the demand is unknown while the bus is saturated */
+		if (stat->busy_time * 100 > stat->total_time * upthreshold) {
+			dfi_rate = DEVFREQ_MAX_FREQ;
+			need_rate = df->scaling_max_freq;
+		} else {
+			demand = dmc_predict_demand(data, data->hist[dmcfreq->dfi_id]);
+			dfi_rate = dmc_predict_dfi_rate(dmcfreq, demand);
+			demand = div_u64((u64)stat->busy_time * (cur_rate / 1000),
+					 stat->total_time);
+			need_rate = dmc_predict_dfi_rate(dmcfreq, demand);
+		}
+	}
+
+	if (dmcfreq->cpu_bw_tbl && dmcfreq->nocp_cpu_id >= 0) {
+		demand = dmc_predict_demand(data, data->hist[dmcfreq->nocp_cpu_id]);
+		nocp_rate = cpu_bw_2_rate(dmcfreq, demand);
+		need_rate = max(need_rate, get_nocp_req_rate(dmcfreq));
+	}
+
+	dmc_predict_learn(data, need_rate);
+
+	if (now < data->hold_endtime)
+		hold_rate = data->hold_rate;
+
+	target_freq = max3(req_rate, dfi_rate, nocp_rate);
+	target_freq = max(target_freq, hold_rate);
+
+	/* Keep the current frequency while the load is within differential */
+	if (target_freq < cur_rate &&
+	    stat->busy_time * 100 >
+	    stat->total_time * (upthreshold - downdifferential))
+		target_freq = cur_rate;
+
+	trace_rockchip_dmcfreq_predict(cur_rate, req_rate, dfi_rate, nocp_rate,
+				       hold_rate, target_freq);
+	*freq = target_freq;
+
+	return 0;
+}
+
+/*
+ * Same as dmc_ondemand for the system status, vop and touch boost, but the
+ * load based rate comes from the demand history of each devfreq-event and
+ * the demand learned for the system status, the rate goes to the predicted
+ * one at once rather than step by step.
+ */
+static struct devfreq_governor devfreq_dmc_predict = {
+	.name = "dmc_predict",
+	.get_target_freq = devfreq_dmc_predict_func,
+	.event_handler = devfreq_dmc_ondemand_handler,
+};
+
 static int rockchip_dmcfreq_enable_event(struct rockchip_dmcfreq *dmcfreq)
 {
 	int i, ret;
@@ -2983,6 +3249,11 @@ static int rockchip_dmcfreq_get_event(struct rockchip_dmcfreq *dmcfreq)
 			     GFP_KERNEL);
 	if (!dmcfreq->nocp_bw)
 		return -ENOMEM;
+	dmcfreq->predict_data.hist =
+		devm_kcalloc(dev, available_count,
+			     sizeof(*dmcfreq->predict_data.hist), GFP_KERNEL);
+	if (!dmcfreq->predict_data.hist)
+		return -ENOMEM;
 
 	return 0;
 }
@@ -3055,6 +3326,11 @@ static void rockchip_dmcfreq_parse_dt(struct rockchip_dmcfreq *dmcfreq)
 
 	of_property_read_u32(np, "min-cpu-freq", &dmcfreq->min_cpu_freq);
 
+	dmcfreq->is_predict = of_property_read_bool(np, "predict-enable");
+	dmcfreq->predict_data.hold_ms = DMC_PREDICT_HOLD_MS;
+	of_property_read_u32(np, "predict-hold-ms",
+			     &dmcfreq->predict_data.hold_ms);
+
 	of_property_read_u32(np, "upthreshold",
 			     &dmcfreq->ondemand_data.upthreshold);
 	of_property_read_u32(np, "downdifferential",
@@ -3121,7 +3397,9 @@ static int rockchip_dmcfreq_add_devfreq(struct rockchip_dmcfreq *dmcfreq)
 	dev_pm_opp_put(opp);
 
 	devp->initial_freq = dmcfreq->rate;
-	devfreq = devm_devfreq_add_device(dev, devp, "dmc_ondemand",
+	devfreq = devm_devfreq_add_device(dev, devp,
+					  dmcfreq->is_predict ? "dmc_predict" :
+					  "dmc_ondemand",
 					  &dmcfreq->ondemand_data);
 	if (IS_ERR(devfreq)) {
 		dev_err(dev, "failed to add devfreq\n");
@@ -3406,6 +3684,9 @@ static int rockchip_dmcfreq_probe(struct platform_device *pdev)
 	cpu_latency_qos_add_request(&pm_qos, PM_QOS_DEFAULT_VALUE);
 
 	ret = devfreq_add_governor(&devfreq_dmc_ondemand);
+	if (ret)
+		return ret;
+	ret = devfreq_add_governor(&devfreq_dmc_predict);
 	if (ret)
 		return ret;
 	ret = rockchip_dmcfreq_enable_event(data);
@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Simulated devfreq-event counter for the rockchip dmc governors.
+ *
+ * The counters returned on each polling are written from userspace, so the
+ * dmc governors can be checked with a known load sequence and without a
+ * real dfi or nocp device. Each write to the "samples" attribute queues one
+ * or more "<load_count> <total_count>" pairs, and one pair is taken at each
+ * polling. The last pair is returned again once the queue is empty.
+ *
+ * Copyright (c) 2024 Rockchip Electronics Co. Ltd.
+ */
+
+#include <linux/devfreq-event.h>
+#include <linux/kernel.h>
+#include <linux/kfifo.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/sysfs.h>
+
+#define DMC_SIM_SAMPLE_NUM	64
+
+struct dmc_sim_sample {
+	unsigned long load_count;
+	unsigned long total_count;
+};
+
+struct rockchip_dmc_sim {
+	struct device *dev;
+	struct devfreq_event_dev *edev;
+	struct devfreq_event_desc desc;
+	/* protects samples and last */
+	spinlock_t lock;
+	DECLARE_KFIFO(samples, struct dmc_sim_sample, DMC_SIM_SAMPLE_NUM);
+	struct dmc_sim_sample last;
+	unsigned long count;
+};
+
+static int rockchip_dmc_sim_enable(struct devfreq_event_dev *edev)
+{
+	return 0;
+}
+
+static int rockchip_dmc_sim_disable(struct devfreq_event_dev *edev)
+{
+	return 0;
+}
+
+static int rockchip_dmc_sim_set_event(struct devfreq_event_dev *edev)
+{
+	return 0;
+}
+
+static int rockchip_dmc_sim_get_event(struct devfreq_event_dev *edev,
+				      struct devfreq_event_data *edata)
+{
+	struct rockchip_dmc_sim *sim = devfreq_event_get_drvdata(edev);
+	struct dmc_sim_sample sample;
+
+	spin_lock(&sim->lock);
+	if (kfifo_get(&sim->samples, &sample))
+		sim->last = sample;
+	edata->load_count = sim->last.load_count;
+	edata->total_count = sim->last.total_count;
+	sim->count++;
+	spin_unlock(&sim->lock);
+
+	return 0;
+}
+
+static const struct devfreq_event_ops rockchip_dmc_sim_ops = {
+	.enable = rockchip_dmc_sim_enable,
+	.disable = rockchip_dmc_sim_disable,
+	.get_event = rockchip_dmc_sim_get_event,
+	.set_event = rockchip_dmc_sim_set_event,
+};
+
+static ssize_t samples_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct rockchip_dmc_sim *sim = dev_get_drvdata(dev);
+	ssize_t len;
+
+	spin_lock(&sim->lock);
+	len = sysfs_emit(buf, "last %lu %lu queued %u polled %lu\n",
+			 sim->last.load_count, sim->last.total_count,
+			 kfifo_len(&sim->samples), sim->count);
+	spin_unlock(&sim->lock);
+
+	return len;
+}
+
+/* the whole write is parsed first, so it is queued entirely or not at all */
+static ssize_t samples_store(struct device *dev, struct device_attribute *attr,
+			     const char *buf, size_t count)
+{
+	struct rockchip_dmc_sim *sim = dev_get_drvdata(dev);
+	struct dmc_sim_sample *samples;
+	unsigned int num = 0;
+	const char *p = buf;
+	ssize_t ret = count;
+	int n;
+
+	samples = kmalloc_array(DMC_SIM_SAMPLE_NUM, sizeof(*samples), GFP_KERNEL);
+	if (!samples)
+		return -ENOMEM;
+
+	while (sscanf(p, "%lu %lu%n", &samples[num].load_count,
+		      &samples[num].total_count, &n) == 2) {
+		if (samples[num].load_count > samples[num].total_count) {
+			ret = -EINVAL;
+			goto out;
+		}
+		p += n;
+		if (++num == DMC_SIM_SAMPLE_NUM)
+			break;
+	}
+
+	/* nothing but the trailing blanks is left */
+	p = skip_spaces(p);
+	if (*p || !num) {
+		ret = *p && num == DMC_SIM_SAMPLE_NUM ? -ENOSPC : -EINVAL;
+		goto out;
+	}
+
+	spin_lock(&sim->lock);
+	if (kfifo_avail(&sim->samples) < num)
+		ret = -ENOSPC;
+	else
+		kfifo_in(&sim->samples, samples, num);
+	spin_unlock(&sim->lock);
+
+out:
+	kfree(samples);
+
+	return ret;
+}
+
+static DEVICE_ATTR_RW(samples);
+
+static int rockchip_dmc_sim_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct rockchip_dmc_sim *sim;
+	int ret;
+
+	sim = devm_kzalloc(dev, sizeof(*sim), GFP_KERNEL);
+	if (!sim)
+		return -ENOMEM;
+
+	sim->dev = dev;
+	spin_lock_init(&sim->lock);
+	INIT_KFIFO(sim->samples);
+
+	sim->desc.name = "dfi";
+	of_property_read_string(dev->of_node, "event-name", &sim->desc.name);
+	sim->desc.ops = &rockchip_dmc_sim_ops;
+	sim->desc.driver_data = sim;
+
+	sim->edev = devm_devfreq_event_add_edev(dev, &sim->desc);
+	if (IS_ERR(sim->edev)) {
+		dev_err(dev, "failed to add devfreq-event device\n");
+		return PTR_ERR(sim->edev);
+	}
+
+	platform_set_drvdata(pdev, sim);
+
+	ret = device_create_file(dev, &dev_attr_samples);
+	if (ret)
+		dev_err(dev, "failed to register samples sysfs file\n");
+
+	return ret;
+}
+
+static int rockchip_dmc_sim_remove(struct platform_device *pdev)
+{
+	device_remove_file(&pdev->dev, &dev_attr_samples);
+
+	return 0;
+}
+
+static const struct of_device_id rockchip_dmc_sim_of_match[] = {
+	{ .compatible = "rockchip,dmc-sim-event" },
+	{ },
+};
+MODULE_DEVICE_TABLE(of, rockchip_dmc_sim_of_match);
+
+static struct platform_driver rockchip_dmc_sim_driver = {
+	.probe = rockchip_dmc_sim_probe,
+	.remove = rockchip_dmc_sim_remove,
+	.driver = {
+		.name = "rockchip-dmc-sim",
+		.of_match_table = rockchip_dmc_sim_of_match,
+	},
+};
+module_platform_driver(rockchip_dmc_sim_driver);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Rockchip simulated devfreq-event counter for dmc");
@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2024 Rockchip Electronics Co. Ltd.
+ *
+ * Tracepoints of the dmc predictive governor
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM	rockchip_dmc
+
+#if !defined(_ROCKCHIP_DMC_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _ROCKCHIP_DMC_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(rockchip_dmcfreq_predict,
+
+	TP_PROTO(unsigned long cur_rate, unsigned long req_rate,
+		 unsigned long dfi_rate, unsigned long nocp_rate,
+		 unsigned long hold_rate, unsigned long target_rate),
+
+	TP_ARGS(cur_rate, req_rate, dfi_rate, nocp_rate, hold_rate, target_rate),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, cur_rate)
+		__field(unsigned long, req_rate)
+		__field(unsigned long, dfi_rate)
+		__field(unsigned long, nocp_rate)
+		__field(unsigned long, hold_rate)
+		__field(unsigned long, target_rate)
+	),
+
+	TP_fast_assign(
+		__entry->cur_rate = cur_rate;
+		__entry->req_rate = req_rate;
+		__entry->dfi_rate = dfi_rate;
+		__entry->nocp_rate = nocp_rate;
+		__entry->hold_rate = hold_rate;
+		__entry->target_rate = target_rate;
+	),
+
+	TP_printk("cur=%lu req=%lu dfi=%lu nocp=%lu hold=%lu target=%lu",
+		  __entry->cur_rate, __entry->req_rate, __entry->dfi_rate,
+		  __entry->nocp_rate, __entry->hold_rate, __entry->target_rate)
+);
+
+TRACE_EVENT(rockchip_dmcfreq_predict_event,
+
+	TP_PROTO(unsigned long status, unsigned long hold_rate,
+		 unsigned int hold_ms),
+
+	TP_ARGS(status, hold_rate, hold_ms),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, status)
+		__field(unsigned long, hold_rate)
+		__field(unsigned int, hold_ms)
+	),
+
+	TP_fast_assign(
+		__entry->status = status;
+		__entry->hold_rate = hold_rate;
+		__entry->hold_ms = hold_ms;
+	),
+
+	TP_printk("status=0x%lx hold=%lu for %u ms",
+		  __entry->status, __entry->hold_rate, __entry->hold_ms)
+);
+
+#endif /* _ROCKCHIP_DMC_TRACE_H */
+
+/* this part must be outside header guard */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE rockchip_dmc_trace
+#include <trace/define_trace.h>
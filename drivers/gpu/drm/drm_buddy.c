@@ -50,6 +50,16 @@ static void list_insert_sorted(struct drm_buddy *mm,
 		return;
 	}
 
+	/*
+	 * Allocations are taken from the tail, so frees and splits tend to
+	 * land there as well. Avoid walking the whole list in that case.
+	 */
+	node = list_last_entry(head, struct drm_buddy_block, link);
+	if (drm_buddy_block_offset(block) > drm_buddy_block_offset(node)) {
+		list_add_tail(&block->link, head);
+		return;
+	}
+
 	list_for_each_entry(node, head, link)
 		if (drm_buddy_block_offset(block) < drm_buddy_block_offset(node))
 			break;
@@ -74,6 +84,15 @@ static void mark_free(struct drm_buddy *mm,
 	list_insert_sorted(mm, block);
 }
 
+static void mark_free_after(struct drm_buddy_block *block,
+			    struct drm_buddy_block *prev)
+{
+	block->header &= ~DRM_BUDDY_HEADER_STATE;
+	block->header |= DRM_BUDDY_FREE;
+
+	list_add(&block->link, &prev->link);
+}
+
 static void mark_split(struct drm_buddy_block *block)
 {
 	block->header &= ~DRM_BUDDY_HEADER_STATE;
@@ -221,7 +240,8 @@ static int split_block(struct drm_buddy *mm,
 	}
 
 	mark_free(mm, block->left);
-	mark_free(mm, block->right);
+	/* No block of the same order can sit between two buddies */
+	mark_free_after(block->right, block->left);
 
 	mark_split(block);
 
@@ -688,6 +708,10 @@ int drm_buddy_alloc_blocks(struct drm_buddy *mm,
 	if (range_overflows(start, size, mm->size))
 		return -EINVAL;
 
+	/* Don't split and then undo a request that can never fit */
+	if (size > mm->avail)
+		return -ENOSPC;
+
 	/* Actual range allocation */
 	if (start + size == end)
 		return __drm_buddy_alloc_range(mm, start, size, blocks);
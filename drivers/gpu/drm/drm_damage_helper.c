@@ -50,6 +50,79 @@ static void convert_clip_rect_to_rect(const struct drm_clip_rect *src,
 	}
 }
 
+/*
+ * Cost of one more transfer to the display, expressed in pixels. Two damage
+ * clips are merged when uploading their bounding box costs less than
+ * uploading both and paying for the extra transfer. Slow-upload displays
+ * (USB, SPI) otherwise get one tiny transfer per clip.
+ */
+#define DAMAGE_TRANSFER_COST_PIXELS	4096
+
+/*
+ * A pass is O(n^2) in the number of clips. Clips grown by a merge are only
+ * rechecked against the clips before them on the next pass, so bound the
+ * passes to keep the worst case quadratic.
+ */
+#define DAMAGE_COALESCE_MAX_PASSES	3
+
+static u64 damage_rect_area(const struct drm_mode_rect *r)
+{
+	if (r->x2 <= r->x1 || r->y2 <= r->y1)
+		return 0;
+
+	return (u64)(r->x2 - r->x1) * (r->y2 - r->y1);
+}
+
+/*
+ * Greedily merges clips as long as that lowers the upload cost, and
+ * returns the new number of clips. The order of the remaining clips is
+ * not preserved. Empty clips are left alone. After the last pass a few
+ * clips may still be worth merging; that only costs some upload time.
+ */
+static uint32_t coalesce_damage_rects(struct drm_mode_rect *rects,
+				      uint32_t num_clips)
+{
+	bool merged = true;
+	uint32_t i, j, pass;
+
+	/* Clips before i are only checked against the smaller clip */
+	for (pass = 0; merged && pass < DAMAGE_COALESCE_MAX_PASSES; pass++) {
+		merged = false;
+		for (i = 0; i < num_clips; i++) {
+			u64 area_i = damage_rect_area(&rects[i]);
+
+			if (!area_i)
+				continue;
+
+			for (j = i + 1; j < num_clips; j++) {
+				u64 area_j = damage_rect_area(&rects[j]);
+				struct drm_mode_rect u;
+
+				if (!area_j)
+					continue;
+
+				u.x1 = min(rects[i].x1, rects[j].x1);
+				u.y1 = min(rects[i].y1, rects[j].y1);
+				u.x2 = max(rects[i].x2, rects[j].x2);
+				u.y2 = max(rects[i].y2, rects[j].y2);
+
+				if (damage_rect_area(&u) >
+				    area_i + area_j + DAMAGE_TRANSFER_COST_PIXELS)
+					continue;
+
+				/* Check the remaining clips against the grown one */
+				rects[i] = u;
+				area_i = damage_rect_area(&u);
+				rects[j] = rects[--num_clips];
+				j = i;
+				merged = true;
+			}
+		}
+	}
+
+	return num_clips;
+}
+
 /**
  * drm_atomic_helper_check_plane_damage - Verify plane damage on atomic_check.
  * @state: The driver state object.
@@ -145,6 +218,7 @@ int drm_atomic_helper_dirtyfb(struct drm_framebuffer *fb,
 		}
 
 		convert_clip_rect_to_rect(clips, rects, num_clips, inc);
+		num_clips = coalesce_damage_rects(rects, num_clips);
 		damage = drm_property_create_blob(fb->dev,
 						  num_clips * sizeof(*rects),
 						  rects);
@@ -12,6 +12,9 @@
 #include <linux/iosys-map.h>
 #include <linux/module.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include <asm/unaligned.h>
 
 #include <drm/drm_device.h>
 #include <drm/drm_format_helper.h>
@@ -20,6 +23,15 @@
 #include <drm/drm_print.h>
 #include <drm/drm_rect.h>
 
+static unsigned int drm_fb_xfrm_bands = 1;
+module_param_named(xfrm_bands, drm_fb_xfrm_bands, uint, 0600);
+MODULE_PARM_DESC(xfrm_bands,
+		 "Maximum number of row bands converted in parallel [default=1]");
+
+/* Upper limit for xfrm_bands, and smallest band worth a worker */
+#define DRM_FB_XFRM_MAX_BANDS		8
+#define DRM_FB_XFRM_BAND_MIN_PIXELS	(64 * 1024)
+
 static unsigned int clip_offset(const struct drm_rect *clip, unsigned int pitch, unsigned int cpp)
 {
 	return clip->y1 * pitch + clip->x1 * cpp;
@@ -129,6 +141,115 @@ static int __drm_fb_xfrm_toio(void __iomem *dst, unsigned long dst_pitch, unsign
 	return 0;
 }
 
+struct drm_fb_xfrm_band {
+	struct work_struct work;
+	struct iosys_map dst;
+	unsigned long dst_pitch;
+	unsigned long dst_pixsize;
+	const void *vaddr;
+	const struct drm_framebuffer *fb;
+	struct drm_rect clip;
+	bool vaddr_cached_hint;
+	void (*xfrm_line)(void *dbuf, const void *sbuf, unsigned int npixels);
+	int ret;
+};
+
+static void drm_fb_xfrm_band(struct drm_fb_xfrm_band *band)
+{
+	if (band->dst.is_iomem)
+		band->ret = __drm_fb_xfrm_toio(band->dst.vaddr_iomem, band->dst_pitch,
+					       band->dst_pixsize, band->vaddr, band->fb,
+					       &band->clip, band->vaddr_cached_hint,
+					       band->xfrm_line);
+	else
+		band->ret = __drm_fb_xfrm(band->dst.vaddr, band->dst_pitch,
+					  band->dst_pixsize, band->vaddr, band->fb,
+					  &band->clip, band->vaddr_cached_hint,
+					  band->xfrm_line);
+}
+
+static void drm_fb_xfrm_band_work(struct work_struct *work)
+{
+	drm_fb_xfrm_band(container_of(work, struct drm_fb_xfrm_band, work));
+}
+
+static unsigned int drm_fb_xfrm_nbands(const struct drm_rect *clip)
+{
+	unsigned long pixels = drm_rect_width(clip) * drm_rect_height(clip);
+	unsigned int nbands = READ_ONCE(drm_fb_xfrm_bands);
+
+	nbands = min_t(unsigned int, nbands, DRM_FB_XFRM_MAX_BANDS);
+	nbands = min_t(unsigned int, nbands, num_online_cpus());
+	nbands = min_t(unsigned long, nbands, pixels / DRM_FB_XFRM_BAND_MIN_PIXELS);
+	nbands = min_t(unsigned int, nbands, drm_rect_height(clip));
+
+	return nbands;
+}
+
+/*
+ * Splits a large clip into bands of whole lines and converts them in
+ * parallel. The first band runs in the caller, the others on the unbound
+ * workqueue. Each band uses its own temporary line buffers. Returns a
+ * positive value if the bands can't be set up, so that the caller converts
+ * the clip in one go.
+ */
+static int drm_fb_xfrm_banded(struct iosys_map *dst, unsigned long dst_pitch,
+			      unsigned long dst_pixsize, const void *vaddr,
+			      const struct drm_framebuffer *fb, const struct drm_rect *clip,
+			      bool vaddr_cached_hint, unsigned int nbands,
+			      void (*xfrm_line)(void *dbuf, const void *sbuf, unsigned int npixels))
+{
+	unsigned int lines = drm_rect_height(clip);
+	unsigned int band_lines = DIV_ROUND_UP(lines, nbands);
+	struct drm_fb_xfrm_band *bands;
+	unsigned int i;
+	int ret = 0;
+
+	/* Rounding up the band size may leave fewer, but no empty, bands */
+	nbands = DIV_ROUND_UP(lines, band_lines);
+
+	bands = kcalloc(nbands, sizeof(*bands), GFP_KERNEL);
+	if (!bands)
+		return 1;
+
+	if (!dst_pitch)
+		dst_pitch = drm_rect_width(clip) * dst_pixsize;
+
+	for (i = 0; i < nbands; ++i) {
+		struct drm_fb_xfrm_band *band = &bands[i];
+		unsigned int y = i * band_lines;
+
+		band->dst = *dst;
+		iosys_map_incr(&band->dst, y * dst_pitch);
+		band->dst_pitch = dst_pitch;
+		band->dst_pixsize = dst_pixsize;
+		band->vaddr = vaddr;
+		band->fb = fb;
+		band->clip = *clip;
+		band->clip.y1 = clip->y1 + y;
+		band->clip.y2 = min_t(int, band->clip.y1 + band_lines, clip->y2);
+		band->vaddr_cached_hint = vaddr_cached_hint;
+		band->xfrm_line = xfrm_line;
+
+		INIT_WORK(&band->work, drm_fb_xfrm_band_work);
+		if (i)
+			queue_work(system_unbound_wq, &band->work);
+	}
+
+	drm_fb_xfrm_band(&bands[0]);
+
+	for (i = 0; i < nbands; ++i) {
+		if (i)
+			flush_work(&bands[i].work);
+		if (!ret)
+			ret = bands[i].ret;
+	}
+
+	kfree(bands);
+
+	return ret;
+}
+
 /* TODO: Make this function work with multi-plane formats. */
 static int drm_fb_xfrm(struct iosys_map *dst,
 		       const unsigned int *dst_pitch, const u8 *dst_pixsize,
@@ -139,10 +260,19 @@ static int drm_fb_xfrm(struct iosys_map *dst,
 	static const unsigned int default_dst_pitch[DRM_FORMAT_MAX_PLANES] = {
 		0, 0, 0, 0
 	};
+	unsigned int nbands = drm_fb_xfrm_nbands(clip);
 
 	if (!dst_pitch)
 		dst_pitch = default_dst_pitch;
 
+	if (nbands > 1) {
+		int ret = drm_fb_xfrm_banded(&dst[0], dst_pitch[0], dst_pixsize[0],
+					     src[0].vaddr, fb, clip, vaddr_cached_hint,
+					     nbands, xfrm_line);
+		if (ret <= 0)
+			return ret;
+	}
+
 	/* TODO: handle src in I/O memory here */
 	if (dst[0].is_iomem)
 		return __drm_fb_xfrm_toio(dst[0].vaddr_iomem, dst_pitch[0], dst_pixsize[0],
@@ -399,10 +529,22 @@ static void drm_fb_xrgb8888_to_rgb888_line(void *dbuf, const void *sbuf, unsigne
 {
 	u8 *dbuf8 = dbuf;
 	const __le32 *sbuf32 = sbuf;
-	unsigned int x;
-	u32 pix;
+	unsigned int x = 0;
+	u32 pix, pix1, pix2, pix3;
 
-	for (x = 0; x < pixels; x++) {
+	/* Pack four pixels into three 32-bit stores instead of twelve byte stores */
+	for (; x + 4 <= pixels; x += 4) {
+		pix = le32_to_cpu(sbuf32[x]);
+		pix1 = le32_to_cpu(sbuf32[x + 1]);
+		pix2 = le32_to_cpu(sbuf32[x + 2]);
+		pix3 = le32_to_cpu(sbuf32[x + 3]);
+		put_unaligned_le32((pix & 0x00FFFFFF) | (pix1 << 24), dbuf8);
+		put_unaligned_le32(((pix1 & 0x00FFFF00) >> 8) | (pix2 << 16), dbuf8 + 4);
+		put_unaligned_le32(((pix2 & 0x00FF0000) >> 16) | (pix3 << 8), dbuf8 + 8);
+		dbuf8 += 12;
+	}
+
+	for (; x < pixels; x++) {
 		pix = le32_to_cpu(sbuf32[x]);
 		*dbuf8++ = (pix & 0x000000FF) >>  0;
 		*dbuf8++ = (pix & 0x0000FF00) >>  8;
@@ -495,6 +495,108 @@ static u64 rb_to_hole_size_or_zero(struct rb_node *rb)
 	return rb ? rb_to_hole_size(rb) : 0;
 }
 
+/*
+ * Checks whether an allocation of @size fits into @hole after applying
+ * the color adjustment, the range and the alignment, and returns where it
+ * would start in @start.
+ */
+static bool hole_fits(const struct drm_mm *mm, struct drm_mm_node *hole,
+		      u64 size, u64 alignment, u64 remainder_mask,
+		      unsigned long color, u64 range_start, u64 range_end,
+		      enum drm_mm_insert_mode mode, u64 *start)
+{
+	u64 hole_start = __drm_mm_hole_node_start(hole);
+	u64 hole_end = hole_start + hole->hole_size;
+	u64 adj_start, adj_end;
+	u64 col_start, col_end;
+
+	col_start = hole_start;
+	col_end = hole_end;
+	if (mm->color_adjust)
+		mm->color_adjust(hole, color, &col_start, &col_end);
+
+	adj_start = max(col_start, range_start);
+	adj_end = min(col_end, range_end);
+
+	if (adj_end <= adj_start || adj_end - adj_start < size)
+		return false;
+
+	if (mode == DRM_MM_INSERT_HIGH)
+		adj_start = adj_end - size;
+
+	if (alignment) {
+		u64 rem;
+
+		if (likely(remainder_mask))
+			rem = adj_start & remainder_mask;
+		else
+			div64_u64_rem(adj_start, alignment, &rem);
+		if (rem) {
+			adj_start -= rem;
+			if (mode != DRM_MM_INSERT_HIGH)
+				adj_start += alignment;
+
+			if (adj_start < max(col_start, range_start) ||
+			    min(col_end, range_end) - adj_start < size)
+				return false;
+
+			if (adj_end <= adj_start ||
+			    adj_end - adj_start < size)
+				return false;
+		}
+	}
+
+	*start = adj_start;
+	return true;
+}
+
+/*
+ * The size tree orders holes regardless of their address, so a best fit
+ * search restricted to a small part of the address space (e.g. a mappable
+ * aperture) would walk all the big enough holes outside of it as well.
+ * Walk the holes inside the range on the address tree instead. The
+ * subtree_max_hole augmentation skips every subtree without a big enough
+ * hole, so only candidates are visited.
+ */
+static bool best_in_range(const struct drm_mm *mm, u64 range_start, u64 range_end)
+{
+	u64 mm_start = mm->head_node.start + mm->head_node.size;
+	u64 mm_end = mm->head_node.start;
+
+	return range_end - range_start < (mm_end - mm_start) / 2;
+}
+
+static struct drm_mm_node *
+best_hole_in_range(struct drm_mm *mm, u64 size, u64 alignment,
+		   u64 remainder_mask, unsigned long color,
+		   u64 range_start, u64 range_end, u64 *start)
+{
+	struct drm_mm_node *hole, *best = NULL;
+	u64 adj_start;
+
+	for (hole = find_hole_addr(mm, range_start, size);
+	     hole;
+	     hole = next_hole_low_addr(hole, size)) {
+		if (__drm_mm_hole_node_start(hole) >= range_end)
+			break;
+
+		if (best && hole->hole_size >= best->hole_size)
+			continue;
+
+		if (!hole_fits(mm, hole, size, alignment, remainder_mask, color,
+			       range_start, range_end, DRM_MM_INSERT_BEST,
+			       &adj_start))
+			continue;
+
+		best = hole;
+		*start = adj_start;
+		if (hole->hole_size == size)
+			break;
+	}
+
+	return best;
+}
+
 /**
  * drm_mm_insert_node_in_range - ranged search for space and insert @node
  * @mm: drm_mm to allocate from
@@ -520,6 +622,7 @@ int drm_mm_insert_node_in_range(struct drm_mm * const mm,
 {
 	struct drm_mm_node *hole;
 	u64 remainder_mask;
+	u64 hole_start, hole_end, adj_start;
 	bool once;
 
 	DRM_MM_BUG_ON(range_start > range_end);
@@ -537,77 +640,58 @@ int drm_mm_insert_node_in_range(struct drm_mm * const mm,
 	mode &= ~DRM_MM_INSERT_ONCE;
 
 	remainder_mask = is_power_of_2(alignment) ? alignment - 1 : 0;
+
+	if (mode == DRM_MM_INSERT_BEST && !once &&
+	    best_in_range(mm, range_start, range_end)) {
+		hole = best_hole_in_range(mm, size, alignment, remainder_mask,
+					  color, range_start, range_end,
+					  &adj_start);
+		if (hole)
+			goto insert;
+		return -ENOSPC;
+	}
+
 	for (hole = first_hole(mm, range_start, range_end, size, mode);
 	     hole;
 	     hole = once ? NULL : next_hole(mm, hole, size, mode)) {
-		u64 hole_start = __drm_mm_hole_node_start(hole);
-		u64 hole_end = hole_start + hole->hole_size;
-		u64 adj_start, adj_end;
-		u64 col_start, col_end;
+		hole_start = __drm_mm_hole_node_start(hole);
 
 		if (mode == DRM_MM_INSERT_LOW && hole_start >= range_end)
 			break;
 
-		if (mode == DRM_MM_INSERT_HIGH && hole_end <= range_start)
+		if (mode == DRM_MM_INSERT_HIGH &&
+		    hole_start + hole->hole_size <= range_start)
 			break;
 
-		col_start = hole_start;
-		col_end = hole_end;
-		if (mm->color_adjust)
-			mm->color_adjust(hole, color, &col_start, &col_end);
-
-		adj_start = max(col_start, range_start);
-		adj_end = min(col_end, range_end);
-
-		if (adj_end <= adj_start || adj_end - adj_start < size)
-			continue;
+		if (hole_fits(mm, hole, size, alignment, remainder_mask, color,
+			      range_start, range_end, mode, &adj_start))
+			goto insert;
+	}
 
-		if (mode == DRM_MM_INSERT_HIGH)
-			adj_start = adj_end - size;
-
-		if (alignment) {
-			u64 rem;
-
-			if (likely(remainder_mask))
-				rem = adj_start & remainder_mask;
-			else
-				div64_u64_rem(adj_start, alignment, &rem);
-			if (rem) {
-				adj_start -= rem;
-				if (mode != DRM_MM_INSERT_HIGH)
-					adj_start += alignment;
-
-				if (adj_start < max(col_start, range_start) ||
-				    min(col_end, range_end) - adj_start < size)
-					continue;
-
-				if (adj_end <= adj_start ||
-				    adj_end - adj_start < size)
-					continue;
-			}
-		}
+	return -ENOSPC;
 
-		node->mm = mm;
-		node->size = size;
-		node->start = adj_start;
-		node->color = color;
-		node->hole_size = 0;
+insert:
+	hole_start = __drm_mm_hole_node_start(hole);
+	hole_end = hole_start + hole->hole_size;
 
-		__set_bit(DRM_MM_NODE_ALLOCATED_BIT, &node->flags);
-		list_add(&node->node_list, &hole->node_list);
-		drm_mm_interval_tree_add_node(hole, node);
+	node->mm = mm;
+	node->size = size;
+	node->start = adj_start;
+	node->color = color;
+	node->hole_size = 0;
 
-		rm_hole(hole);
-		if (adj_start > hole_start)
-			add_hole(hole);
-		if (adj_start + size < hole_end)
-			add_hole(node);
+	__set_bit(DRM_MM_NODE_ALLOCATED_BIT, &node->flags);
+	list_add(&node->node_list, &hole->node_list);
+	drm_mm_interval_tree_add_node(hole, node);
 
-		save_stack(node);
-		return 0;
-	}
+	rm_hole(hole);
+	if (adj_start > hole_start)
+		add_hole(hole);
+	if (adj_start + size < hole_end)
+		add_hole(node);
 
-	return -ENOSPC;
+	save_stack(node);
+	return 0;
 }
 EXPORT_SYMBOL(drm_mm_insert_node_in_range);
 
@@ -207,8 +207,15 @@ struct syncobj_wait_entry {
 	struct dma_fence *fence;
 	struct dma_fence_cb fence_cb;
 	u64    point;
+	bool   signaled;
 };
 
+/*
+ * Most waits are on a handful of syncobjs; keep those off the heap so that
+ * polling already signaled points costs no allocations at all.
+ */
+#define DRM_SYNCOBJ_WAIT_ON_STACK 4
+
 static void syncobj_wait_syncobj_func(struct drm_syncobj *syncobj,
 				      struct syncobj_wait_entry *wait);
 
@@ -975,6 +982,8 @@ static signed long drm_syncobj_array_wait_timeout(struct drm_syncobj **syncobjs,
 						  signed long timeout,
 						  uint32_t *idx)
 {
+	struct syncobj_wait_entry stack_entries[DRM_SYNCOBJ_WAIT_ON_STACK];
+	uint64_t stack_points[DRM_SYNCOBJ_WAIT_ON_STACK];
 	struct syncobj_wait_entry *entries;
 	struct dma_fence *fence;
 	uint64_t *points;
@@ -983,9 +992,13 @@ static signed long drm_syncobj_array_wait_timeout(struct drm_syncobj **syncobjs,
 	if (flags & DRM_SYNCOBJ_WAIT_FLAGS_WAIT_FOR_SUBMIT)
 		lockdep_assert_none_held_once();
 
-	points = kmalloc_array(count, sizeof(*points), GFP_KERNEL);
-	if (points == NULL)
-		return -ENOMEM;
+	if (count <= DRM_SYNCOBJ_WAIT_ON_STACK) {
+		points = stack_points;
+	} else {
+		points = kmalloc_array(count, sizeof(*points), GFP_KERNEL);
+		if (points == NULL)
+			return -ENOMEM;
+	}
 
 	if (!user_points) {
 		memset(points, 0, count * sizeof(uint64_t));
@@ -996,10 +1009,15 @@ static signed long drm_syncobj_array_wait_timeout(struct drm_syncobj **syncobjs,
 		goto err_free_points;
 	}
 
-	entries = kcalloc(count, sizeof(*entries), GFP_KERNEL);
-	if (!entries) {
-		timeout = -ENOMEM;
-		goto err_free_points;
+	if (count <= DRM_SYNCOBJ_WAIT_ON_STACK) {
+		entries = stack_entries;
+		memset(entries, 0, count * sizeof(*entries));
+	} else {
+		entries = kcalloc(count, sizeof(*entries), GFP_KERNEL);
+		if (!entries) {
+			timeout = -ENOMEM;
+			goto err_free_points;
+		}
 	}
 	/* Walk the list of sync objects and initialize entries.  We do
 	 * this up-front so that we can properly return -EINVAL if there is
@@ -1033,6 +1051,7 @@ static signed long drm_syncobj_array_wait_timeout(struct drm_syncobj **syncobjs,
 		    dma_fence_is_signaled(entries[i].fence)) {
 			if (signaled_count == 0 && idx)
 				*idx = i;
+			entries[i].signaled = true;
 			signaled_count++;
 		}
 	}
@@ -1063,6 +1082,20 @@ static signed long drm_syncobj_array_wait_timeout(struct drm_syncobj **syncobjs,
 			if (!fence)
 				continue;
 
+			/* Points only move forward; once seen signaled there
+			 * is no need to poll the fence or arm a callback on
+			 * it again.
+			 */
+			if (entries[i].signaled) {
+				if (flags & DRM_SYNCOBJ_WAIT_FLAGS_WAIT_ALL) {
+					signaled_count++;
+					continue;
+				}
+				if (idx)
+					*idx = i;
+				goto done_waiting;
+			}
+
 			if ((flags & DRM_SYNCOBJ_WAIT_FLAGS_WAIT_AVAILABLE) ||
 			    dma_fence_is_signaled(fence) ||
 			    (!entries[i].fence_cb.func &&
@@ -1070,6 +1103,7 @@ static signed long drm_syncobj_array_wait_timeout(struct drm_syncobj **syncobjs,
 						    &entries[i].fence_cb,
 						    syncobj_wait_fence_func))) {
 				/* The fence has been signaled */
+				entries[i].signaled = true;
 				if (flags & DRM_SYNCOBJ_WAIT_FLAGS_WAIT_ALL) {
 					signaled_count++;
 				} else {
@@ -1107,10 +1141,12 @@ static signed long drm_syncobj_array_wait_timeout(struct drm_syncobj **syncobjs,
 						  &entries[i].fence_cb);
 		dma_fence_put(entries[i].fence);
 	}
-	kfree(entries);
+	if (entries != stack_entries)
+		kfree(entries);
 
 err_free_points:
-	kfree(points);
+	if (points != stack_points)
+		kfree(points);
 
 	return timeout;
 }
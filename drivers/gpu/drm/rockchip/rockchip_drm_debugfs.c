@@ -16,6 +16,7 @@
 #include "rockchip_drm_drv.h"
 #include "rockchip_drm_debugfs.h"
 #include "rockchip_drm_fb.h"
+#include "rockchip_drm_gem.h"
 
 #define DUMP_BUF_PATH		"/data"
 #define AFBC_HEADER_SIZE		16
@@ -288,3 +289,23 @@ int rockchip_drm_debugfs_add_color_bar(struct drm_crtc *crtc, struct dentry *roo
 
 	return 0;
 }
+
+static int rockchip_drm_debugfs_gem_pool_show(struct seq_file *s, void *data)
+{
+	rockchip_gem_pool_show(s);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(rockchip_drm_debugfs_gem_pool);
+
+int rockchip_drm_debugfs_add_gem_pool(struct dentry *root)
+{
+	struct dentry *ent;
+
+	ent = debugfs_create_file("gem_pool", 0444, root, NULL,
+				  &rockchip_drm_debugfs_gem_pool_fops);
+	if (!ent)
+		DRM_ERROR("Failed to add gem_pool for debugfs\n");
+
+	return 0;
+}
@@ -1385,6 +1385,7 @@ static void rockchip_drm_debugfs_init(struct drm_minor *minor)
 	drm_debugfs_create_files(rockchip_debugfs_files,
 				 ARRAY_SIZE(rockchip_debugfs_files),
 				 minor->debugfs_root, minor);
+	rockchip_drm_debugfs_add_gem_pool(minor->debugfs_root);
 
 	drm_for_each_crtc(crtc, dev) {
 		int pipe = drm_crtc_index(crtc);
@@ -2288,10 +2289,14 @@ static int __init rockchip_drm_init(void)
 	ADD_ROCKCHIP_SUB_DRIVER(dw_dp_driver, CONFIG_ROCKCHIP_DW_DP);
 
 #endif
+	ret = rockchip_gem_pool_init();
+	if (ret)
+		return ret;
+
 	ret = platform_register_drivers(rockchip_sub_drivers,
 					num_rockchip_sub_drivers);
 	if (ret)
-		return ret;
+		goto err_pool_fini;
 
 	ret = platform_driver_register(&rockchip_drm_platform_driver);
 	if (ret)
@@ -2304,6 +2309,8 @@ static int __init rockchip_drm_init(void)
 err_unreg_drivers:
 	platform_unregister_drivers(rockchip_sub_drivers,
 				    num_rockchip_sub_drivers);
+err_pool_fini:
+	rockchip_gem_pool_fini();
 	return ret;
 }
 
@@ -2313,6 +2320,8 @@ static void __exit rockchip_drm_fini(void)
 
 	platform_unregister_drivers(rockchip_sub_drivers,
 				    num_rockchip_sub_drivers);
+
+	rockchip_gem_pool_fini();
 }
 
 #ifdef CONFIG_VIDEO_REVERSE_IMAGE
@@ -105,6 +105,53 @@ static void rockchip_gem_free_list(struct list_head lists[])
 	}
 }
 
+static struct page **rockchip_gem_pool_get_pages(struct rockchip_gem_object *rk_obj)
+{
+	unsigned long n_pages = rk_obj->base.size >> PAGE_SHIFT;
+	unsigned long i = 0, j;
+	unsigned int order;
+	struct page **pages;
+	struct page *page;
+
+	pages = kvmalloc_array(n_pages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return ERR_PTR(-ENOMEM);
+
+	while (i < n_pages) {
+		page = rockchip_gem_pool_alloc(ilog2(n_pages - i), &order);
+		if (!page)
+			goto err_free;
+
+		for (j = 0; j < (1UL << order); j++)
+			pages[i + j] = nth_page(page, j);
+		i += 1UL << order;
+	}
+
+	return pages;
+
+err_free:
+	n_pages = i;
+	for (i = 0; i < n_pages; i++) {
+		if (!PageTail(pages[i]))
+			rockchip_gem_pool_free(pages[i], compound_order(pages[i]));
+	}
+	kvfree(pages);
+
+	return ERR_PTR(-ENOMEM);
+}
+
+static void rockchip_gem_pool_put_pages(struct page **pages, unsigned long n_pages)
+{
+	unsigned long i;
+
+	/* the head pages stand for the whole chunk */
+	for (i = 0; i < n_pages; i++) {
+		if (!PageTail(pages[i]))
+			rockchip_gem_pool_free(pages[i], compound_order(pages[i]));
+	}
+	kvfree(pages);
+}
+
 void rockchip_gem_get_ddr_info(void)
 {
 	struct dram_addrmap_info *ddr_map_info;
@@ -138,7 +185,10 @@ static int rockchip_gem_get_pages(struct rockchip_gem_object *rk_obj)
 	for (i = 0; i < PG_ROUND; i++)
 		INIT_LIST_HEAD(&lists[i]);
 
-	pages = drm_gem_get_pages(&rk_obj->base);
+	if (rk_obj->pool)
+		pages = rockchip_gem_pool_get_pages(rk_obj);
+	else
+		pages = drm_gem_get_pages(&rk_obj->base);
 	if (IS_ERR(pages))
 		return PTR_ERR(pages);
 
@@ -243,7 +293,10 @@ static int rockchip_gem_get_pages(struct rockchip_gem_object *rk_obj)
 	rockchip_gem_free_list(lists);
 	kvfree(dst_pages);
 err_put_pages:
-	drm_gem_put_pages(&rk_obj->base, rk_obj->pages, false, false);
+	if (rk_obj->pool)
+		rockchip_gem_pool_put_pages(rk_obj->pages, rk_obj->base.size >> PAGE_SHIFT);
+	else
+		drm_gem_put_pages(&rk_obj->base, rk_obj->pages, false, false);
 	return ret;
 }
 
@@ -251,7 +304,10 @@ static void rockchip_gem_put_pages(struct rockchip_gem_object *rk_obj)
 {
 	sg_free_table(rk_obj->sgt);
 	kfree(rk_obj->sgt);
-	drm_gem_put_pages(&rk_obj->base, rk_obj->pages, true, true);
+	if (rk_obj->pool)
+		rockchip_gem_pool_put_pages(rk_obj->pages, rk_obj->num_pages);
+	else
+		drm_gem_put_pages(&rk_obj->base, rk_obj->pages, true, true);
 }
 
 static inline void *drm_calloc_large(size_t nmemb, size_t size);
@@ -447,6 +503,8 @@ static int rockchip_gem_alloc_buf(struct rockchip_gem_object *rk_obj,
 			return ret;
 	} else {
 		rk_obj->buf_type = ROCKCHIP_GEM_BUF_TYPE_SHMEM;
+		/* the pool has no dma32 pages, use shmem for them */
+		rk_obj->pool = !(rk_obj->flags & ROCKCHIP_BO_DMA32);
 		ret = rockchip_gem_get_pages(rk_obj);
 		if (ret < 0)
 			return ret;
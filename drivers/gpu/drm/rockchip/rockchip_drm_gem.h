@@ -9,6 +9,8 @@
 
 #include <linux/dma-direction.h>
 
+struct seq_file;
+
 #define to_rockchip_obj(x) container_of(x, struct rockchip_gem_object, base)
 #define ROCKCHIP_BO_DMA32 1
 
@@ -35,6 +37,8 @@ struct rockchip_gem_object {
 	struct page **pages;
 	struct sg_table *sgt;
 	size_t size;
+	/* pages are from rockchip gem pool rather than shmem */
+	bool pool;
 };
 
 struct sg_table *rockchip_gem_prime_get_sg_table(struct drm_gem_object *obj);
@@ -82,6 +86,12 @@ int rockchip_gem_prime_end_cpu_access(struct drm_gem_object *obj,
 
 void rockchip_gem_get_ddr_info(void);
 
+struct page *rockchip_gem_pool_alloc(unsigned int max_order, unsigned int *order);
+void rockchip_gem_pool_free(struct page *page, unsigned int order);
+int rockchip_gem_pool_init(void);
+void rockchip_gem_pool_fini(void);
+void rockchip_gem_pool_show(struct seq_file *s);
+
 extern const struct drm_gem_object_funcs rockchip_gem_object_funcs;
 
 #endif /* _ROCKCHIP_DRM_GEM_H */
@@ -0,0 +1,323 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2024 Rockchip Electronics Co., Ltd.
+ *
+ * Page pool for the GEM objects backed by system pages.
+ *
+ * Freed pages are kept in per-order pools and cleared in the background,
+ * so buffers of the same size which are allocated and released again and
+ * again do not go through the page allocator and page clearing each time.
+ * The pools are given back to the system by the shrinker.
+ */
+
+#include <linux/highmem.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/seq_file.h>
+#include <linux/shrinker.h>
+#include <linux/sizes.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+#include "rockchip_drm_gem.h"
+
+/* pages kept in all pools at most, the others go back to the system */
+#define ROCKCHIP_GEM_POOL_MAX_PAGES	(SZ_64M >> PAGE_SHIFT)
+
+#ifdef CONFIG_ARM_LPAE
+#define ROCKCHIP_GEM_POOL_GFP		(GFP_HIGHUSER | __GFP_DMA32)
+#else
+#define ROCKCHIP_GEM_POOL_GFP		(GFP_HIGHUSER)
+#endif
+
+/*
+ * Large orders are only tried without reclaim, it is cheaper to fall back
+ * to a smaller order than to stall on compaction.
+ */
+#define ROCKCHIP_GEM_POOL_HIGH_GFP	((ROCKCHIP_GEM_POOL_GFP | __GFP_NOWARN | \
+					  __GFP_NORETRY | __GFP_COMP) & \
+					 ~__GFP_RECLAIM)
+
+struct rockchip_gem_pool {
+	unsigned int order;
+	gfp_t gfp;
+	spinlock_t lock;
+	/* pages cleared and ready to use */
+	struct list_head clean;
+	/* pages released and waiting to be cleared */
+	struct list_head dirty;
+	unsigned long clean_count;
+	unsigned long dirty_count;
+
+	/* allocation statistics */
+	atomic_long_t alloc_pool;
+	atomic_long_t alloc_system;
+	atomic_long_t alloc_fail;
+};
+
+/*
+ * 2M and 64K chunks, then single pages. Large chunks keep the number of
+ * allocations and of sg entries of a framebuffer low.
+ */
+static struct rockchip_gem_pool rockchip_gem_pools[] = {
+	{ .order = 9, .gfp = ROCKCHIP_GEM_POOL_HIGH_GFP },
+	{ .order = 4, .gfp = ROCKCHIP_GEM_POOL_HIGH_GFP },
+	{ .order = 0, .gfp = ROCKCHIP_GEM_POOL_GFP },
+};
+
+/* pages in all pools, in PAGE_SIZE units */
+static atomic_long_t rockchip_gem_pool_pages = ATOMIC_LONG_INIT(0);
+
+static void rockchip_gem_pool_clear_pages(struct page *page, unsigned int order)
+{
+	unsigned int i;
+
+	for (i = 0; i < (1U << order); i++)
+		clear_highpage(nth_page(page, i));
+}
+
+static struct rockchip_gem_pool *rockchip_gem_pool_find(unsigned int order)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(rockchip_gem_pools); i++) {
+		if (rockchip_gem_pools[i].order == order)
+			return &rockchip_gem_pools[i];
+	}
+
+	return NULL;
+}
+
+static struct page *rockchip_gem_pool_take_list(struct rockchip_gem_pool *pool,
+						bool dirty)
+{
+	struct page *page;
+
+	spin_lock(&pool->lock);
+	page = list_first_entry_or_null(dirty ? &pool->dirty : &pool->clean,
+					struct page, lru);
+	if (page) {
+		list_del(&page->lru);
+		if (dirty)
+			pool->dirty_count--;
+		else
+			pool->clean_count--;
+	}
+	spin_unlock(&pool->lock);
+
+	if (page)
+		atomic_long_sub(1L << pool->order, &rockchip_gem_pool_pages);
+
+	return page;
+}
+
+static struct page *rockchip_gem_pool_take(struct rockchip_gem_pool *pool,
+					   bool *dirty)
+{
+	struct page *page;
+
+	page = rockchip_gem_pool_take_list(pool, false);
+	*dirty = !page;
+	if (!page)
+		page = rockchip_gem_pool_take_list(pool, true);
+
+	return page;
+}
+
+static void rockchip_gem_pool_clear_work(struct work_struct *work)
+{
+	struct rockchip_gem_pool *pool;
+	struct page *page;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(rockchip_gem_pools); i++) {
+		pool = &rockchip_gem_pools[i];
+
+		for (;;) {
+			spin_lock(&pool->lock);
+			page = list_first_entry_or_null(&pool->dirty, struct page, lru);
+			if (page) {
+				list_del(&page->lru);
+				pool->dirty_count--;
+			}
+			spin_unlock(&pool->lock);
+			if (!page)
+				break;
+
+			rockchip_gem_pool_clear_pages(page, pool->order);
+
+			spin_lock(&pool->lock);
+			list_add_tail(&page->lru, &pool->clean);
+			pool->clean_count++;
+			spin_unlock(&pool->lock);
+			cond_resched();
+		}
+	}
+}
+
+static DECLARE_WORK(rockchip_gem_pool_work, rockchip_gem_pool_clear_work);
+
+/**
+ * rockchip_gem_pool_alloc - allocate cleared pages
+ * @max_order: the largest order wanted
+ * @order: returns the order of the allocated pages
+ *
+ * The pools of the orders not above @max_order are tried from the largest
+ * one, and the page allocator when a pool is empty. High order pages are
+ * compound pages, so the order is known again when they are freed.
+ */
+struct page *rockchip_gem_pool_alloc(unsigned int max_order, unsigned int *order)
+{
+	struct rockchip_gem_pool *pool;
+	struct page *page;
+	bool dirty;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(rockchip_gem_pools); i++) {
+		pool = &rockchip_gem_pools[i];
+		if (pool->order > max_order)
+			continue;
+
+		page = rockchip_gem_pool_take(pool, &dirty);
+		if (page) {
+			if (dirty)
+				rockchip_gem_pool_clear_pages(page, pool->order);
+			atomic_long_inc(&pool->alloc_pool);
+		} else {
+			page = alloc_pages(pool->gfp | __GFP_ZERO, pool->order);
+			if (page)
+				atomic_long_inc(&pool->alloc_system);
+			else
+				atomic_long_inc(&pool->alloc_fail);
+		}
+
+		if (page) {
+			*order = pool->order;
+			return page;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * rockchip_gem_pool_free - give pages back to the pool
+ * @page: pages allocated by rockchip_gem_pool_alloc()
+ * @order: the order of the pages
+ */
+void rockchip_gem_pool_free(struct page *page, unsigned int order)
+{
+	struct rockchip_gem_pool *pool = rockchip_gem_pool_find(order);
+
+	/*
+	 * Pages still referenced by someone else, e.g. a get_user_pages() or
+	 * pin_user_pages() user of the mmap, must not be handed out again, so
+	 * only our reference is dropped and the last user frees them.
+	 */
+	if (!pool || page_count(page) != 1 ||
+	    folio_maybe_dma_pinned(page_folio(page)) ||
+	    atomic_long_read(&rockchip_gem_pool_pages) + (1L << order) >
+	    ROCKCHIP_GEM_POOL_MAX_PAGES) {
+		__free_pages(page, order);
+		return;
+	}
+
+	spin_lock(&pool->lock);
+	list_add_tail(&page->lru, &pool->dirty);
+	pool->dirty_count++;
+	spin_unlock(&pool->lock);
+	atomic_long_add(1L << order, &rockchip_gem_pool_pages);
+
+	queue_work(system_unbound_wq, &rockchip_gem_pool_work);
+}
+
+/* the clean pages of all the pools go back first, then the dirty ones */
+static unsigned long rockchip_gem_pool_drain(unsigned long nr_to_scan)
+{
+	struct rockchip_gem_pool *pool;
+	unsigned long freed = 0;
+	struct page *page;
+	int pass, i;
+
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < ARRAY_SIZE(rockchip_gem_pools) && freed < nr_to_scan; i++) {
+			pool = &rockchip_gem_pools[i];
+
+			while (freed < nr_to_scan) {
+				page = rockchip_gem_pool_take_list(pool, pass > 0);
+				if (!page)
+					break;
+
+				__free_pages(page, pool->order);
+				freed += 1UL << pool->order;
+			}
+		}
+	}
+
+	return freed;
+}
+
+static unsigned long rockchip_gem_pool_shrink_count(struct shrinker *shrinker,
+						    struct shrink_control *sc)
+{
+	unsigned long count = atomic_long_read(&rockchip_gem_pool_pages);
+
+	return count ? count : SHRINK_EMPTY;
+}
+
+static unsigned long rockchip_gem_pool_shrink_scan(struct shrinker *shrinker,
+						   struct shrink_control *sc)
+{
+	unsigned long freed = rockchip_gem_pool_drain(sc->nr_to_scan);
+
+	return freed ? freed : SHRINK_STOP;
+}
+
+static struct shrinker rockchip_gem_pool_shrinker = {
+	.count_objects = rockchip_gem_pool_shrink_count,
+	.scan_objects = rockchip_gem_pool_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+void rockchip_gem_pool_show(struct seq_file *s)
+{
+	struct rockchip_gem_pool *pool;
+	int i;
+
+	seq_printf(s, "%-8s %10s %10s %12s %12s %10s\n", "size", "clean", "dirty",
+		   "from pool", "from system", "failed");
+	for (i = 0; i < ARRAY_SIZE(rockchip_gem_pools); i++) {
+		pool = &rockchip_gem_pools[i];
+
+		seq_printf(s, "%6luK %10lu %10lu %12ld %12ld %10ld\n",
+			   (PAGE_SIZE << pool->order) >> 10,
+			   READ_ONCE(pool->clean_count), READ_ONCE(pool->dirty_count),
+			   atomic_long_read(&pool->alloc_pool),
+			   atomic_long_read(&pool->alloc_system),
+			   atomic_long_read(&pool->alloc_fail));
+	}
+	seq_printf(s, "total %lu KiB in pool\n",
+		   (atomic_long_read(&rockchip_gem_pool_pages) << PAGE_SHIFT) >> 10);
+}
+
+int rockchip_gem_pool_init(void)
+{
+	struct rockchip_gem_pool *pool;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(rockchip_gem_pools); i++) {
+		pool = &rockchip_gem_pools[i];
+		spin_lock_init(&pool->lock);
+		INIT_LIST_HEAD(&pool->clean);
+		INIT_LIST_HEAD(&pool->dirty);
+	}
+
+	return register_shrinker(&rockchip_gem_pool_shrinker, "drm-rockchip-gem-pool");
+}
+
+void rockchip_gem_pool_fini(void)
+{
+	unregister_shrinker(&rockchip_gem_pool_shrinker);
+	cancel_work_sync(&rockchip_gem_pool_work);
+	rockchip_gem_pool_drain(ULONG_MAX);
+}
@@ -2553,7 +2553,8 @@ static void rkcif_exp_work(struct work_struct *exp_work)
 	struct sditf_gain *gain;
 	struct sditf_effect_time *effect_time;
 	struct sditf_effect_gain *effect_gain;
-	struct v4l2_ctrl *ctrl;
+	struct v4l2_ctrl_handler *hdl = dev->terminal_sensor.sd->ctrl_handler;
+	struct v4l2_ctrl_batch_val vals[2];
 	u32 cur_time = 0;
 	u32 cur_gain = 0;
 	int i = 0;
@@ -2600,9 +2601,6 @@ static void rkcif_exp_work(struct work_struct *exp_work)
 			dev_info(priv->dev, "exp set id %d, val 0x%x\n",
 				 priv->connect_id, cur_time);
 	}
-	ctrl = v4l2_ctrl_find(dev->terminal_sensor.sd->ctrl_handler,
-			      V4L2_CID_EXPOSURE);
-	v4l2_ctrl_s_ctrl(ctrl, cur_time);
 	priv->cur_time = cur_time;
 	if (stream->frame_idx == 0) {
 		cur_gain = priv->cur_gain;
@@ -2633,11 +2631,20 @@ static void rkcif_exp_work(struct work_struct *exp_work)
 			dev_info(priv->dev, "gain set id %d, val 0x%x\n",
 				 priv->connect_id, cur_gain);
 	}
-	ctrl = v4l2_ctrl_find(dev->terminal_sensor.sd->ctrl_handler,
-			      V4L2_CID_ANALOGUE_GAIN);
-	v4l2_ctrl_s_ctrl(ctrl, cur_gain);
 	priv->cur_gain = cur_gain;
 
+	/*
+	 * exposure and gain of one frame go to the sensor together, the
+	 * sensor reads them back from the value snapshot of its handler
+	 */
+	v4l2_ctrl_handler_enable_snapshot(hdl);
+	vals[0].ctrl = v4l2_ctrl_find(hdl, V4L2_CID_EXPOSURE);
+	vals[0].val = cur_time;
+	vals[1].ctrl = v4l2_ctrl_find(hdl, V4L2_CID_ANALOGUE_GAIN);
+	vals[1].val = cur_gain;
+	if (vals[0].ctrl && vals[1].ctrl)
+		v4l2_ctrl_s_ctrls_batch(hdl, vals, ARRAY_SIZE(vals));
+
 	id = rkcif_get_exp_effect_stream_id(dev, stream->frame_idx - 1);
 	if (id < 0) {
 		dev_err(dev->dev, "%s %d get exp_effect stream failed\n",
@@ -4045,6 +4045,91 @@ struct rkisp_isp_params_ops_v32 isp_params_ops_v32 = {
 	.vsm_enable = isp_vsm_enable,
 };
 
+#define ISP32_CFG_DIFF(_module, _field) {					\
+	.module = ISP32_MODULE_##_module,					\
+	.offset = offsetof(struct isp32_isp_params_cfg, _field),		\
+	.size = sizeof_field(struct isp32_isp_params_cfg, _field),		\
+}
+
+/*
+ * Modules only programmed through registers, which keep their value until
+ * the next config. The modules using lut buffers, sram or the previous
+ * frame (lsc, 3dlut, ldch, cac, bay3d, dhaz, rawawb, rawhist) are always
+ * applied.
+ */
+static const struct {
+	u64 module;
+	u32 offset;
+	u32 size;
+} isp32_cfg_diff_tbl[] = {
+	ISP32_CFG_DIFF(DPCC, others.dpcc_cfg),
+	ISP32_CFG_DIFF(BLS, others.bls_cfg),
+	ISP32_CFG_DIFF(SDG, others.sdg_cfg),
+	ISP32_CFG_DIFF(AWB_GAIN, others.awb_gain_cfg),
+	ISP32_CFG_DIFF(DEBAYER, others.debayer_cfg),
+	ISP32_CFG_DIFF(CCM, others.ccm_cfg),
+	ISP32_CFG_DIFF(GOC, others.gammaout_cfg),
+	ISP32_CFG_DIFF(CSM, others.csm_cfg),
+	ISP32_CFG_DIFF(CGC, others.cgc_cfg),
+	ISP32_CFG_DIFF(CPROC, others.cproc_cfg),
+	ISP32_CFG_DIFF(IE, others.ie_cfg),
+	ISP32_CFG_DIFF(HDRMGE, others.hdrmge_cfg),
+	ISP32_CFG_DIFF(DRC, others.drc_cfg),
+	ISP32_CFG_DIFF(GIC, others.gic_cfg),
+	ISP32_CFG_DIFF(YNR, others.ynr_cfg),
+	ISP32_CFG_DIFF(CNR, others.cnr_cfg),
+	ISP32_CFG_DIFF(SHARP, others.sharp_cfg),
+	ISP32_CFG_DIFF(BAYNR, others.baynr_cfg),
+	ISP32_CFG_DIFF(GAIN, others.gain_cfg),
+	ISP32_CFG_DIFF(RAWAF, meas.rawaf),
+	ISP32_CFG_DIFF(RAWAE0, meas.rawae0),
+	ISP32_CFG_DIFF(RAWAE1, meas.rawae1),
+	ISP32_CFG_DIFF(RAWAE2, meas.rawae2),
+	ISP32_CFG_DIFF(RAWAE3, meas.rawae3),
+};
+
+/*
+ * The params are parsed in place from the vb2 buffer. Most of the module
+ * configs are the same from one frame to the next, even if user space asks
+ * to update them, so drop the update of the modules whose config is the
+ * same as the last applied one, and record the others.
+ */
+static void isp_params_cfg_diff(struct rkisp_isp_params_vdev *params_vdev,
+				struct isp32_isp_params_cfg *new_params, u32 id)
+{
+	struct rkisp_isp_params_val_v32 *priv_val = params_vdev->priv_val;
+	struct isp32_isp_params_cfg *shadow = priv_val->cfg_shadow + id;
+	u64 module_cfg_update = new_params->module_cfg_update;
+	u64 valid = priv_val->cfg_valid[id];
+	int i;
+
+	if (module_cfg_update & ISP32_MODULE_FORCE)
+		valid = 0;
+
+	for (i = 0; i < ARRAY_SIZE(isp32_cfg_diff_tbl); i++) {
+		u64 module = isp32_cfg_diff_tbl[i].module;
+		u32 offset = isp32_cfg_diff_tbl[i].offset;
+		u32 size = isp32_cfg_diff_tbl[i].size;
+
+		if (!(module_cfg_update & module))
+			continue;
+		if ((valid & module) &&
+		    !memcmp((void *)shadow + offset, (void *)new_params + offset, size)) {
+			module_cfg_update &= ~module;
+			continue;
+		}
+		memcpy((void *)shadow + offset, (void *)new_params + offset, size);
+		valid |= module;
+	}
+
+	v4l2_dbg(4, rkisp_debug, &params_vdev->dev->v4l2_dev,
+		 "%s id:%d seq:%d module_cfg_update:0x%llx skip:0x%llx\n",
+		 __func__, id, new_params->frame_id, module_cfg_update,
+		 new_params->module_cfg_update & ~module_cfg_update);
+	priv_val->cfg_valid[id] = valid;
+	new_params->module_cfg_update = module_cfg_update;
+}
+
 static __maybe_unused
 void __isp_isr_other_config(struct rkisp_isp_params_vdev *params_vdev,
 			    const struct isp32_isp_params_cfg *new_params,
@@ -4955,6 +5040,8 @@ rkisp_params_first_cfg_v32(struct rkisp_isp_params_vdev *params_vdev)
 	priv_val->lsc_en = 0;
 	priv_val->mge_en = 0;
 	priv_val->lut3d_en = 0;
+	/* the first config is not recorded, apply all next configs */
+	memset(priv_val->cfg_valid, 0, sizeof(priv_val->cfg_valid));
 	if (dev->is_bigmode)
 		rkisp_unite_set_bits(dev, ISP3X_ISP_CTRL1, 0,
 				     ISP3X_BIGMODE_MANUAL | ISP3X_BIGMODE_FORCE_EN, false);
@@ -5396,6 +5483,7 @@ rkisp_params_cfg_v32(struct rkisp_isp_params_vdev *params_vdev,
 		     u32 frame_id, enum rkisp_params_type type)
 {
 	struct rkisp_device *dev = params_vdev->dev;
+	struct rkisp_isp_params_val_v32 *priv_val = params_vdev->priv_val;
 	struct isp32_isp_params_cfg *new_params = NULL;
 	struct rkisp_buffer *cur_buf = params_vdev->cur_buf;
 	int i;
@@ -5418,6 +5506,7 @@ rkisp_params_cfg_v32(struct rkisp_isp_params_vdev *params_vdev,
 				/* update en immediately */
 				if (new_params->module_en_update ||
 				    (new_params->module_cfg_update & ISP32_MODULE_FORCE)) {
+					isp_params_cfg_diff(params_vdev, new_params, i);
 					__isp_isr_meas_config(params_vdev,
 							      new_params, RKISP_PARAMS_ALL, i);
 					__isp_isr_other_config(params_vdev,
@@ -5449,6 +5538,11 @@ rkisp_params_cfg_v32(struct rkisp_isp_params_vdev *params_vdev,
 
 	new_params = (struct isp32_isp_params_cfg *)(cur_buf->vaddr[0]);
 	for (i = 0; i < dev->unite_div; i++) {
+		/* hdr read back configs in two steps, without the shadow */
+		if (type == RKISP_PARAMS_ALL)
+			isp_params_cfg_diff(params_vdev, new_params, i);
+		else
+			priv_val->cfg_valid[i] &= ~new_params->module_cfg_update;
 		__isp_isr_meas_config(params_vdev, new_params, type, i);
 		__isp_isr_other_config(params_vdev, new_params, type, i);
 		__isp_isr_other_en(params_vdev, new_params, type, i);
@@ -5543,6 +5637,13 @@ int rkisp_init_params_vdev_v32(struct rkisp_isp_params_vdev *params_vdev)
 		kfree(priv_val);
 		return -ENOMEM;
 	}
+	priv_val->cfg_shadow = vmalloc(size);
+	if (!priv_val->cfg_shadow) {
+		vfree(params_vdev->isp32_params);
+		params_vdev->isp32_params = NULL;
+		kfree(priv_val);
+		return -ENOMEM;
+	}
 
 	params_vdev->priv_val = (void *)priv_val;
 	params_vdev->ops = &rkisp_isp_params_ops_tbl;
@@ -5565,7 +5666,12 @@ void rkisp_uninit_params_vdev_v32(struct rkisp_isp_params_vdev *params_vdev)
 		vfree(params_vdev->isp32_params);
 	if (priv_val) {
 		tasklet_kill(&priv_val->lsc_tasklet);
+		vfree(priv_val->cfg_shadow);
 		kfree(priv_val);
 		params_vdev->priv_val = NULL;
 	}
 }
+
+#ifdef CONFIG_VIDEO_ROCKCHIP_ISP_KUNIT_TEST
+#include "isp_params_v32_test.c"
+#endif
@@ -203,6 +203,10 @@ struct rkisp_isp_params_val_v32 {
 
 	struct rkisp_dummy_buffer buf_frm;
 
+	/* copy of the last applied module configs, see isp_params_cfg_diff() */
+	struct isp32_isp_params_cfg *cfg_shadow;
+	u64 cfg_valid[ISP_UNITE_MAX];
+
 	bool dhaz_en;
 	bool drc_en;
 	bool lsc_en;
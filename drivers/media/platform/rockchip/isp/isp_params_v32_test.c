@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (c) 2024 Rockchip Electronics Co., Ltd. */
+/* KUnit tests of isp_params_cfg_diff(), included by isp_params_v32.c */
+
+#include <kunit/test.h>
+
+struct isp32_cfg_diff_test {
+	struct rkisp_device dev;
+	struct rkisp_isp_params_vdev params_vdev;
+	struct rkisp_isp_params_val_v32 priv_val;
+	struct isp32_isp_params_cfg *new_params;
+};
+
+static int isp32_cfg_diff_test_init(struct kunit *test)
+{
+	struct isp32_cfg_diff_test *t;
+
+	t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, t);
+	/* the exit op frees whatever was allocated */
+	test->priv = t;
+	t->priv_val.cfg_shadow = vzalloc(sizeof(*t->priv_val.cfg_shadow) * ISP_UNITE_MAX);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, t->priv_val.cfg_shadow);
+	t->new_params = vzalloc(sizeof(*t->new_params));
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, t->new_params);
+
+	t->params_vdev.dev = &t->dev;
+	t->params_vdev.priv_val = &t->priv_val;
+	return 0;
+}
+
+static void isp32_cfg_diff_test_exit(struct kunit *test)
+{
+	struct isp32_cfg_diff_test *t = test->priv;
+
+	if (!t)
+		return;
+	vfree(t->new_params);
+	vfree(t->priv_val.cfg_shadow);
+}
+
+static void isp32_cfg_diff_first_frame(struct kunit *test)
+{
+	struct isp32_cfg_diff_test *t = test->priv;
+	struct isp32_isp_params_cfg *new_params = t->new_params;
+	u64 update = ISP32_MODULE_DPCC | ISP32_MODULE_BLS | ISP32_MODULE_RAWAF;
+
+	new_params->module_cfg_update = update;
+	new_params->others.dpcc_cfg.stage1_enable = 1;
+	isp_params_cfg_diff(&t->params_vdev, new_params, ISP_UNITE_LEFT);
+
+	KUNIT_EXPECT_EQ(test, new_params->module_cfg_update, update);
+	KUNIT_EXPECT_EQ(test, t->priv_val.cfg_valid[ISP_UNITE_LEFT], update);
+	KUNIT_EXPECT_EQ(test, t->priv_val.cfg_shadow[ISP_UNITE_LEFT].others.dpcc_cfg.stage1_enable, 1);
+}
+
+static void isp32_cfg_diff_same_config(struct kunit *test)
+{
+	struct isp32_cfg_diff_test *t = test->priv;
+	struct isp32_isp_params_cfg *new_params = t->new_params;
+	u64 update = ISP32_MODULE_DPCC | ISP32_MODULE_BLS | ISP32_MODULE_LSC;
+
+	new_params->module_cfg_update = update;
+	isp_params_cfg_diff(&t->params_vdev, new_params, ISP_UNITE_LEFT);
+
+	new_params->module_cfg_update = update;
+	isp_params_cfg_diff(&t->params_vdev, new_params, ISP_UNITE_LEFT);
+
+	/* lsc is not diffed, so it is always applied */
+	KUNIT_EXPECT_EQ(test, new_params->module_cfg_update, ISP32_MODULE_LSC);
+}
+
+static void isp32_cfg_diff_changed_config(struct kunit *test)
+{
+	struct isp32_cfg_diff_test *t = test->priv;
+	struct isp32_isp_params_cfg *new_params = t->new_params;
+	u64 update = ISP32_MODULE_DPCC | ISP32_MODULE_BLS;
+
+	new_params->module_cfg_update = update;
+	isp_params_cfg_diff(&t->params_vdev, new_params, ISP_UNITE_LEFT);
+
+	new_params->module_cfg_update = update;
+	new_params->others.bls_cfg.enable_auto = 1;
+	isp_params_cfg_diff(&t->params_vdev, new_params, ISP_UNITE_LEFT);
+
+	KUNIT_EXPECT_EQ(test, new_params->module_cfg_update, ISP32_MODULE_BLS);
+	KUNIT_EXPECT_EQ(test, t->priv_val.cfg_shadow[ISP_UNITE_LEFT].others.bls_cfg.enable_auto, 1);
+}
+
+static void isp32_cfg_diff_force(struct kunit *test)
+{
+	struct isp32_cfg_diff_test *t = test->priv;
+	struct isp32_isp_params_cfg *new_params = t->new_params;
+	u64 update = ISP32_MODULE_DPCC | ISP32_MODULE_BLS;
+
+	new_params->module_cfg_update = update;
+	isp_params_cfg_diff(&t->params_vdev, new_params, ISP_UNITE_LEFT);
+
+	new_params->module_cfg_update = update | ISP32_MODULE_FORCE;
+	isp_params_cfg_diff(&t->params_vdev, new_params, ISP_UNITE_LEFT);
+
+	KUNIT_EXPECT_EQ(test, new_params->module_cfg_update, update | ISP32_MODULE_FORCE);
+}
+
+static void isp32_cfg_diff_not_updated(struct kunit *test)
+{
+	struct isp32_cfg_diff_test *t = test->priv;
+	struct isp32_isp_params_cfg *new_params = t->new_params;
+
+	new_params->module_cfg_update = ISP32_MODULE_DPCC;
+	isp_params_cfg_diff(&t->params_vdev, new_params, ISP_UNITE_LEFT);
+
+	/* a module not asked for must not be recorded as applied */
+	new_params->module_cfg_update = ISP32_MODULE_BLS;
+	new_params->others.dpcc_cfg.stage1_enable = 1;
+	isp_params_cfg_diff(&t->params_vdev, new_params, ISP_UNITE_LEFT);
+
+	KUNIT_EXPECT_EQ(test, t->priv_val.cfg_shadow[ISP_UNITE_LEFT].others.dpcc_cfg.stage1_enable, 0);
+
+	new_params->module_cfg_update = ISP32_MODULE_DPCC;
+	isp_params_cfg_diff(&t->params_vdev, new_params, ISP_UNITE_LEFT);
+
+	KUNIT_EXPECT_EQ(test, new_params->module_cfg_update, ISP32_MODULE_DPCC);
+}
+
+static void isp32_cfg_diff_per_unite(struct kunit *test)
+{
+	struct isp32_cfg_diff_test *t = test->priv;
+	struct isp32_isp_params_cfg *new_params = t->new_params;
+	u64 update = ISP32_MODULE_DPCC;
+
+	new_params->module_cfg_update = update;
+	isp_params_cfg_diff(&t->params_vdev, new_params, ISP_UNITE_LEFT);
+
+	/* the right half keeps its own shadow */
+	new_params->module_cfg_update = update;
+	isp_params_cfg_diff(&t->params_vdev, new_params, ISP_UNITE_RIGHT);
+
+	KUNIT_EXPECT_EQ(test, new_params->module_cfg_update, update);
+	KUNIT_EXPECT_EQ(test, t->priv_val.cfg_valid[ISP_UNITE_RIGHT], update);
+}
+
+static struct kunit_case isp32_cfg_diff_test_cases[] = {
+	KUNIT_CASE(isp32_cfg_diff_first_frame),
+	KUNIT_CASE(isp32_cfg_diff_same_config),
+	KUNIT_CASE(isp32_cfg_diff_changed_config),
+	KUNIT_CASE(isp32_cfg_diff_force),
+	KUNIT_CASE(isp32_cfg_diff_not_updated),
+	KUNIT_CASE(isp32_cfg_diff_per_unite),
+	{}
+};
+
+static struct kunit_suite isp32_cfg_diff_test_suite = {
+	.name = "rkisp_isp32_cfg_diff",
+	.init = isp32_cfg_diff_test_init,
+	.exit = isp32_cfg_diff_test_exit,
+	.test_cases = isp32_cfg_diff_test_cases,
+};
+
+kunit_test_suite(isp32_cfg_diff_test_suite);
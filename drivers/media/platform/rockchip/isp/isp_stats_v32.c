@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0
 /* Copyright (c) 2022 Rockchip Electronics Co., Ltd. */
 
+#include <linux/io.h>
 #include <linux/kfifo.h>
 #include <linux/rk-isp32-config.h>
 #include <media/v4l2-common.h>
@@ -29,6 +30,20 @@ static u32 isp3_stats_read(struct rkisp_isp_stats_vdev *stats_vdev, u32 addr)
 	return rkisp_read(stats_vdev->dev, addr, true);
 }
 
+/* Read consecutive registers at once, instead of one readl() per register */
+static void isp3_stats_read_block(struct rkisp_isp_stats_vdev *stats_vdev,
+				  u32 addr, u32 *buf, size_t count)
+{
+	__ioread32_copy(buf, stats_vdev->dev->hw_dev->base_addr + addr, count);
+}
+
+/* Read count words from a ram data port, which steps on each read */
+static void isp3_stats_read_fifo(struct rkisp_isp_stats_vdev *stats_vdev,
+				 u32 addr, u32 *buf, size_t count)
+{
+	ioread32_rep(stats_vdev->dev->hw_dev->base_addr + addr, buf, count);
+}
+
 static void isp3_stats_write(struct rkisp_isp_stats_vdev *stats_vdev,
 			     u32 addr, u32 value)
 {
@@ -119,6 +134,7 @@ rkisp_stats_get_dhaz_stats(struct rkisp_isp_stats_vdev *stats_vdev, void *pbuf)
 {
 	struct rkisp_device *dev = stats_vdev->dev;
 	struct isp3x_dhaz_stat *dhaz;
+	u32 hist[ISP3X_DHAZ_HIST_IIR_NUM / 2];
 	u32 value, i;
 
 	if (!pbuf)
@@ -149,10 +165,11 @@ rkisp_stats_get_dhaz_stats(struct rkisp_isp_stats_vdev *stats_vdev, void *pbuf)
 		dhaz->dhaz_adp_gratio = value >> 16;
 		dhaz->dhaz_adp_tmax = value & 0xFFFF;
 
-		for (i = 0; i < ISP3X_DHAZ_HIST_IIR_NUM / 2; i++) {
-			value = isp3_stats_read(stats_vdev, ISP3X_DHAZ_HIST_REG0 + 4 * i);
-			dhaz->h_rgb_iir[2 * i] = value & 0xFFFF;
-			dhaz->h_rgb_iir[2 * i + 1] = value >> 16;
+		isp3_stats_read_block(stats_vdev, ISP3X_DHAZ_HIST_REG0,
+				      hist, ARRAY_SIZE(hist));
+		for (i = 0; i < ARRAY_SIZE(hist); i++) {
+			dhaz->h_rgb_iir[2 * i] = hist[i] & 0xFFFF;
+			dhaz->h_rgb_iir[2 * i + 1] = hist[i] >> 16;
 		}
 	}
 	return 0;
@@ -221,7 +238,7 @@ rkisp_stats_get_rawaebig_meas_ddr(struct rkisp_isp_stats_vdev *stats_vdev,
 				  u32 blk_no)
 {
 	struct isp32_rawaebig_stat1 *ae = NULL;
-	u32 i, base, addr, ctrl, meas_type;
+	u32 base, ctrl, meas_type;
 
 	switch (blk_no) {
 	case 1:
@@ -255,14 +272,12 @@ rkisp_stats_get_rawaebig_meas_ddr(struct rkisp_isp_stats_vdev *stats_vdev,
 	if (!ae || stats_vdev->ae_meas_done_next)
 		goto out;
 
-	for (i = 0; i < ISP32_RAWAEBIG_SUBWIN_NUM; i++) {
-		addr = base + ISP3X_RAWAE_BIG_WND1_SUMR + i * 4;
-		ae->sumr[i] = isp3_stats_read(stats_vdev, addr);
-		addr = base + ISP3X_RAWAE_BIG_WND1_SUMG + i * 4;
-		ae->sumg[i] = isp3_stats_read(stats_vdev, addr);
-		addr = base + ISP3X_RAWAE_BIG_WND1_SUMB + i * 4;
-		ae->sumb[i] = isp3_stats_read(stats_vdev, addr);
-	}
+	isp3_stats_read_block(stats_vdev, base + ISP3X_RAWAE_BIG_WND1_SUMR,
+			      ae->sumr, ISP32_RAWAEBIG_SUBWIN_NUM);
+	isp3_stats_read_block(stats_vdev, base + ISP3X_RAWAE_BIG_WND1_SUMG,
+			      ae->sumg, ISP32_RAWAEBIG_SUBWIN_NUM);
+	isp3_stats_read_block(stats_vdev, base + ISP3X_RAWAE_BIG_WND1_SUMB,
+			      ae->sumb, ISP32_RAWAEBIG_SUBWIN_NUM);
 
 	pbuf->meas_type |= meas_type;
 
@@ -674,6 +689,8 @@ rkisp_stats_get_rawawb_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 				 struct rkisp32_lite_stat_buffer *pbuf)
 {
 	struct isp32_lite_rawawb_meas_stat *awb;
+	u32 wpnum2[ISP32_RAWAWB_SUM_NUM], hist[ISP32_RAWAWB_HSTBIN_NUM / 2];
+	u32 ram[ISP32L_RAWAWB_RAMDATA_RGB_NUM * 2 + ISP32L_RAWAWB_RAMDATA_WP_NUM];
 	u32 i, val, ctrl = isp3_stats_read(stats_vdev, ISP3X_RAWAWB_CTRL);
 
 	if (!(ctrl & ISP32_3A_MEAS_DONE)) {
@@ -685,6 +702,8 @@ rkisp_stats_get_rawawb_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 	if (!pbuf)
 		goto out;
 	awb = &pbuf->params.rawawb;
+	isp3_stats_read_block(stats_vdev, ISP3X_RAWAWB_WPNUM2_0,
+			      wpnum2, ARRAY_SIZE(wpnum2));
 	for (i = 0; i < ISP32_RAWAWB_SUM_NUM; i++) {
 		val = isp3_stats_read(stats_vdev, ISP3X_RAWAWB_SUM_RGAIN_NOR_0 + 0x30 * i);
 		awb->sum[i].rgain_nor = val;
@@ -700,8 +719,7 @@ rkisp_stats_get_rawawb_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 		val = isp3_stats_read(stats_vdev, ISP3X_RAWAWB_WP_NUM_BIG_0 + 0x30 * i);
 		awb->sum[i].wp_num_big = val;
 
-		val = isp3_stats_read(stats_vdev, ISP3X_RAWAWB_WPNUM2_0 + 4 * i);
-		awb->sum[i].wp_num2 = val;
+		awb->sum[i].wp_num2 = wpnum2[i];
 	}
 
 	for (i = 0; i < ISP32_RAWAWB_EXCL_STAT_NUM; i++) {
@@ -713,23 +731,26 @@ rkisp_stats_get_rawawb_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 		awb->sum_exc[i].wp_num_exc = val;
 	}
 
-	for (i = 0; i < ISP32_RAWAWB_HSTBIN_NUM / 2; i++) {
-		val = isp3_stats_read(stats_vdev, ISP3X_RAWAWB_Y_HIST01 + 4 * i);
-		awb->yhist_bin[2 * i] = val & 0xffff;
-		awb->yhist_bin[2 * i + 1] = (val >> 16) & 0xffff;
+	isp3_stats_read_block(stats_vdev, ISP3X_RAWAWB_Y_HIST01,
+			      hist, ARRAY_SIZE(hist));
+	for (i = 0; i < ARRAY_SIZE(hist); i++) {
+		awb->yhist_bin[2 * i] = hist[i] & 0xffff;
+		awb->yhist_bin[2 * i + 1] = (hist[i] >> 16) & 0xffff;
 	}
 
 	/* RAMDATA R/G/B/WP */
+	isp3_stats_read_fifo(stats_vdev, ISP3X_RAWAWB_RAM_DATA_BASE,
+			     ram, ARRAY_SIZE(ram));
 	for (i = 0; i < ISP32L_RAWAWB_RAMDATA_RGB_NUM; i++) {
-		val = isp3_stats_read(stats_vdev, ISP3X_RAWAWB_RAM_DATA_BASE);
+		val = ram[2 * i];
 		awb->ramdata_r[i] = val & 0x1fffff;
 		awb->ramdata_g[i] = (val >> 21) & 0x7ff;
-		val = isp3_stats_read(stats_vdev, ISP3X_RAWAWB_RAM_DATA_BASE);
+		val = ram[2 * i + 1];
 		awb->ramdata_g[i] |= ((val & 0x3ff) << 11);
 		awb->ramdata_b[i] = (val >> 10) & 0x1fffff;
 	}
 	for (i = 0; i < ISP32L_RAWAWB_RAMDATA_WP_NUM; i++) {
-		val = isp3_stats_read(stats_vdev, ISP3X_RAWAWB_RAM_DATA_BASE);
+		val = ram[ISP32L_RAWAWB_RAMDATA_RGB_NUM * 2 + i];
 		awb->ramdata_wpnum0[i] = val & 0x3fff;
 		awb->ramdata_wpnum1[i] = (val >> 16) & 0x3fff;
 	}
@@ -745,7 +766,7 @@ rkisp_stats_get_rawaf_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 				struct rkisp32_lite_stat_buffer *pbuf)
 {
 	struct isp32_lite_rawaf_stat *af;
-	u32 i, val, ctrl;
+	u32 ctrl;
 
 	ctrl = isp3_stats_read(stats_vdev, ISP3X_RAWAF_CTRL);
 	if (!(ctrl & ISP32_3A_MEAS_DONE)) {
@@ -763,14 +784,10 @@ rkisp_stats_get_rawaf_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 	af->int_state = isp3_stats_read(stats_vdev, ISP3X_RAWAF_INT_STATE);
 	af->highlit_cnt_winb = isp3_stats_read(stats_vdev, ISP3X_RAWAF_HIGHLIT_CNT_WINB);
 	/* hiir: first 25 word, viir: remaining 25 word */
-	for (i = 0; i < ISP32L_RAWAF_WND_DATA; i++) {
-		val = isp3_stats_read(stats_vdev, ISP3X_RAWAF_RAM_DATA);
-		af->ramdata.hiir_wnd_data[i] = val;
-	}
-	for (i = 0; i < ISP32L_RAWAF_WND_DATA; i++) {
-		val = isp3_stats_read(stats_vdev, ISP3X_RAWAF_RAM_DATA);
-		af->ramdata.viir_wnd_data[i] = val;
-	}
+	isp3_stats_read_fifo(stats_vdev, ISP3X_RAWAF_RAM_DATA,
+			     af->ramdata.hiir_wnd_data, ISP32L_RAWAF_WND_DATA);
+	isp3_stats_read_fifo(stats_vdev, ISP3X_RAWAF_RAM_DATA,
+			     af->ramdata.viir_wnd_data, ISP32L_RAWAF_WND_DATA);
 
 	pbuf->meas_type |= ISP32_STAT_RAWAF;
 out:
@@ -789,7 +806,8 @@ rkisp_stats_get_rawae3_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 				 struct rkisp32_lite_stat_buffer *pbuf)
 {
 	struct isp32_lite_rawaebig_stat *ae = NULL;
-	u32 i, val, addr, ctrl, base = RAWAE_BIG1_BASE;
+	u32 mean[ISP32_RAWAELITE_MEAN_NUM];
+	u32 i, j, n, val, addr, ctrl, base = RAWAE_BIG1_BASE;
 
 	ctrl = isp3_stats_read(stats_vdev, base + ISP3X_RAWAE_BIG_CTRL);
 	if (!(ctrl & ISP32_3A_MEAS_DONE)) {
@@ -811,11 +829,15 @@ rkisp_stats_get_rawae3_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 	ae->sumb = isp3_stats_read(stats_vdev, addr);
 
 	addr = base + ISP3X_RAWAE_BIG_RO_MEAN_BASE_ADDR;
-	for (i = 0; i < ISP32_RAWAEBIG_MEAN_NUM; i++) {
-		val = isp3_stats_read(stats_vdev, addr);
-		ae->data[i].channelg_xy = val & 0xfff;
-		ae->data[i].channelb_xy = (val >> 12) & 0x3ff;
-		ae->data[i].channelr_xy = (val >> 22) & 0x3ff;
+	for (i = 0; i < ISP32_RAWAEBIG_MEAN_NUM; i += n) {
+		n = min_t(u32, ISP32_RAWAEBIG_MEAN_NUM - i, ARRAY_SIZE(mean));
+		isp3_stats_read_fifo(stats_vdev, addr, mean, n);
+		for (j = 0; j < n; j++) {
+			val = mean[j];
+			ae->data[i + j].channelg_xy = val & 0xfff;
+			ae->data[i + j].channelb_xy = (val >> 12) & 0x3ff;
+			ae->data[i + j].channelr_xy = (val >> 22) & 0x3ff;
+		}
 	}
 
 	pbuf->meas_type |= ISP32_STAT_RAWAE3;
@@ -835,7 +857,7 @@ rkisp_stats_get_rawhst3_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 				  struct rkisp32_lite_stat_buffer *pbuf)
 {
 	struct isp2x_rawhistbig_stat *hst;
-	u32 i, ctrl, addr, base = ISP3X_RAWHIST_BIG1_BASE;
+	u32 ctrl, base = ISP3X_RAWHIST_BIG1_BASE;
 
 	ctrl = isp3_stats_read(stats_vdev, base + ISP3X_RAWHIST_BIG_CTRL);
 	if (!(ctrl & ISP32_3A_MEAS_DONE)) {
@@ -848,9 +870,8 @@ rkisp_stats_get_rawhst3_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 	if (!pbuf)
 		goto out;
 	hst = &pbuf->params.rawhist3;
-	addr = base + ISP3X_RAWHIST_BIG_RO_BASE_BIN;
-	for (i = 0; i < ISP3X_HIST_BIN_N_MAX; i++)
-		hst->hist_bin[i] = isp3_stats_read(stats_vdev, addr);
+	isp3_stats_read_fifo(stats_vdev, base + ISP3X_RAWHIST_BIG_RO_BASE_BIN,
+			     hst->hist_bin, ISP3X_HIST_BIN_N_MAX);
 
 	pbuf->meas_type |= ISP32_STAT_RAWHST3;
 out:
@@ -863,6 +884,7 @@ rkisp_stats_get_rawaelite_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 				    struct rkisp32_lite_stat_buffer *pbuf)
 {
 	struct isp2x_rawaelite_stat *ae;
+	u32 mean[ISP32_RAWAELITE_MEAN_NUM];
 	u32 i, val, ctrl;
 
 	ctrl = isp3_stats_read(stats_vdev, ISP3X_RAWAE_LITE_CTRL);
@@ -875,8 +897,10 @@ rkisp_stats_get_rawaelite_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 	if (!pbuf)
 		goto out;
 	ae = &pbuf->params.rawae0;
-	for (i = 0; i < ISP32_RAWAELITE_MEAN_NUM; i++) {
-		val = isp3_stats_read(stats_vdev, ISP3X_RAWAE_LITE_RO_MEAN + 4 * i);
+	isp3_stats_read_block(stats_vdev, ISP3X_RAWAE_LITE_RO_MEAN,
+			      mean, ARRAY_SIZE(mean));
+	for (i = 0; i < ARRAY_SIZE(mean); i++) {
+		val = mean[i];
 		ae->data[i].channelg_xy = val & 0xfff;
 		ae->data[i].channelb_xy = (val >> 12) & 0x3ff;
 		ae->data[i].channelr_xy = (val >> 22) & 0x3ff;
@@ -893,7 +917,7 @@ rkisp_stats_get_rawhstlite_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 				     struct rkisp32_lite_stat_buffer *pbuf)
 {
 	struct isp32_lite_rawhistlite_stat *hst;
-	u32 i, ctrl;
+	u32 ctrl;
 
 	ctrl = isp3_stats_read(stats_vdev, ISP3X_RAWHIST_LITE_CTRL);
 	if ((ctrl & ISP32_3A_MEAS_DONE) == 0) {
@@ -905,8 +929,8 @@ rkisp_stats_get_rawhstlite_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 	if (!pbuf)
 		goto out;
 	hst = &pbuf->params.rawhist0;
-	for (i = 0; i < ISP32L_HIST_LITE_BIN_N_MAX; i++)
-		hst->hist_bin[i] = isp3_stats_read(stats_vdev, ISP3X_RAWHIST_LITE_RO_BASE_BIN);
+	isp3_stats_read_fifo(stats_vdev, ISP3X_RAWHIST_LITE_RO_BASE_BIN,
+			     hst->hist_bin, ISP32L_HIST_LITE_BIN_N_MAX);
 
 	pbuf->meas_type |= ISP32_STAT_RAWHST0;
 out:
@@ -3,6 +3,9 @@
 
 #include <linux/clk.h>
 #include <linux/delay.h>
+#include <linux/file.h>
+#include <linux/sync_file.h>
+#include <linux/uaccess.h>
 #include <media/v4l2-device.h>
 #include <media/v4l2-fh.h>
 #include <media/v4l2-ioctl.h>
@@ -21,6 +24,27 @@ struct rkvpss_output_ch {
 	u32 c_offs;
 };
 
+/* queued jobs of a file not handled yet, see RKVPSS_CMD_FRAME_QUEUE */
+#define RKVPSS_OFL_JOBS_MAX 4
+
+struct rkvpss_ofl_fh {
+	struct v4l2_fh fh;
+	atomic_t jobs;
+};
+
+static inline struct rkvpss_ofl_fh *file_to_ofl_fh(struct file *file)
+{
+	return container_of(file->private_data, struct rkvpss_ofl_fh, fh);
+}
+
+struct rkvpss_ofl_job {
+	struct work_struct work;
+	struct file *file;
+	struct dma_fence *fence;
+	int cnt;
+	struct rkvpss_frame_cfg cfg[];
+};
+
 struct rkvpss_offline_buf {
 	struct list_head list;
 	struct vb2_buffer vb;
@@ -254,6 +278,30 @@ static void rkvpss_ofl_buf_del(struct file *file, struct rkvpss_buf_info *info)
 		buf_del(file, info->dev_id, info->buf_fd[i], false, false);
 }
 
+/*
+ * Pack a zme coefficient table in the register format: 17 phases of 8 taps,
+ * two taps per register, the registers of the phases are consecutive.
+ */
+static void zme_coe_pack(const s16 coe[17][8], u32 *val)
+{
+	u32 i, j;
+
+	for (i = 0; i < 17; i++)
+		for (j = 0; j < 8; j += 2)
+			*val++ = RKVPSS_ZME_TAP_COE(coe[i][j], coe[i][j + 1]);
+}
+
+/* The tables only depend on the scaling ratio, pack them once */
+static void zme_coe_init(struct rkvpss_offline_dev *ofl)
+{
+	u32 idx;
+
+	for (idx = 0; idx < RKVPSS_ZME_COE_TBL; idx++) {
+		zme_coe_pack(rkvpss_zme_tap8_coe[idx], ofl->zme_hor_coe[idx]);
+		zme_coe_pack(rkvpss_zme_tap6_coe[idx], ofl->zme_ver_coe[idx]);
+	}
+}
+
 static void poly_phase_scale(struct rkvpss_frame_cfg *frame_cfg,
 			     struct rkvpss_offline_dev *ofl,
 			     struct rkvpss_output_cfg *cfg, bool unite, bool left)
@@ -262,7 +310,7 @@ static void poly_phase_scale(struct rkvpss_frame_cfg *frame_cfg,
 	u32 in_w = cfg->crop_width, in_h = cfg->crop_height;
 	u32 out_w = cfg->scl_width, out_h = cfg->scl_height;
 	u32 ctrl, y_xscl_fac, y_yscl_fac, uv_xscl_fac, uv_yscl_fac;
-	u32 i, j, idx, ratio, val, in_div, out_div, factor;
+	u32 i, idx, ratio, val, in_div, out_div, factor;
 	bool dering_en = false, yuv420_in = false, yuv422_to_420 = false;
 
 	if (in_w == out_w && in_h == out_w) {
@@ -332,13 +380,10 @@ static void poly_phase_scale(struct rkvpss_frame_cfg *frame_cfg,
 
 		ratio = y_xscl_fac * 10000 / factor;
 		idx = rkvpss_get_zme_tap_coe_index(ratio);
-		for (i = 0; i < 17; i++) {
-			for (j = 0; j < 8; j += 2) {
-				val = RKVPSS_ZME_TAP_COE(rkvpss_zme_tap8_coe[idx][i][j],
-							 rkvpss_zme_tap8_coe[idx][i][j + 1]);
-				rkvpss_hw_write(hw, RKVPSS_ZME_Y_HOR_COE0_10 + i * 16 + j * 2, val);
-				rkvpss_hw_write(hw, RKVPSS_ZME_UV_HOR_COE0_10 + i * 16 + j * 2, val);
-			}
+		for (i = 0; i < RKVPSS_ZME_COE_NUM; i++) {
+			val = ofl->zme_hor_coe[idx][i];
+			rkvpss_hw_write(hw, RKVPSS_ZME_Y_HOR_COE0_10 + i * 4, val);
+			rkvpss_hw_write(hw, RKVPSS_ZME_UV_HOR_COE0_10 + i * 4, val);
 		}
 	} else {
 		y_xscl_fac = 0;
@@ -367,13 +412,10 @@ static void poly_phase_scale(struct rkvpss_frame_cfg *frame_cfg,
 
 		ratio = y_yscl_fac * 10000 / factor;
 		idx = rkvpss_get_zme_tap_coe_index(ratio);
-		for (i = 0; i < 17; i++) {
-			for (j = 0; j < 8; j += 2) {
-				val = RKVPSS_ZME_TAP_COE(rkvpss_zme_tap6_coe[idx][i][j],
-							 rkvpss_zme_tap6_coe[idx][i][j + 1]);
-				rkvpss_hw_write(hw, RKVPSS_ZME_Y_VER_COE0_10 + i * 16 + j * 2, val);
-				rkvpss_hw_write(hw, RKVPSS_ZME_UV_VER_COE0_10 + i * 16 + j * 2, val);
-			}
+		for (i = 0; i < RKVPSS_ZME_COE_NUM; i++) {
+			val = ofl->zme_ver_coe[idx][i];
+			rkvpss_hw_write(hw, RKVPSS_ZME_Y_VER_COE0_10 + i * 4, val);
+			rkvpss_hw_write(hw, RKVPSS_ZME_UV_VER_COE0_10 + i * 4, val);
 		}
 	} else {
 		y_yscl_fac = 0;
@@ -1429,9 +1471,9 @@ static int write_config(struct file *file, struct rkvpss_frame_cfg *cfg, bool un
 	return -ENOMEM;
 }
 
-static void calc_unite_scl_params(struct file *file, struct rkvpss_frame_cfg *cfg)
+static void calc_unite_scl_params(struct rkvpss_offline_dev *ofl,
+				  struct rkvpss_frame_cfg *cfg)
 {
-	struct rkvpss_offline_dev *ofl = video_drvdata(file);
 	struct rkvpss_unite_scl_params *params;
 	int i;
 	u32 right_scl_need_size_y, right_scl_need_size_c;
@@ -1444,6 +1486,18 @@ static void calc_unite_scl_params(struct file *file, struct rkvpss_frame_cfg *cf
 		if (cfg->output[i].enable == 0)
 			continue;
 		params = &ofl->unite_params[i];
+		/* same scaling as the previous frame */
+		if (params->crop_w == cfg->output[i].crop_width &&
+		    params->crop_h == cfg->output[i].crop_height &&
+		    params->scl_w == cfg->output[i].scl_width &&
+		    params->scl_h == cfg->output[i].scl_height &&
+		    params->enlarge == ofl->unite_right_enlarge)
+			continue;
+		params->crop_w = cfg->output[i].crop_width;
+		params->crop_h = cfg->output[i].crop_height;
+		params->scl_w = cfg->output[i].scl_width;
+		params->scl_h = cfg->output[i].scl_height;
+		params->enlarge = ofl->unite_right_enlarge;
 		params->y_w_fac = (cfg->output[i].crop_width - 1) * 4096 /
 				  (cfg->output[i].scl_width  - 1);
 		params->c_w_fac = (cfg->output[i].crop_width / 2 - 1) * 4096 /
@@ -1964,7 +2018,7 @@ static int rkvpss_prepare_run(struct file *file, struct rkvpss_frame_cfg *cfg)
 		if (ret < 0)
 			goto end;
 	} else {
-		calc_unite_scl_params(file, cfg);
+		calc_unite_scl_params(ofl, cfg);
 		ret = rkvpss_ofl_run(file, cfg, true, true);
 		if (ret < 0) {
 			v4l2_err(&ofl->v4l2_dev, "unite left error\n");
@@ -1981,6 +2035,128 @@ static int rkvpss_prepare_run(struct file *file, struct rkvpss_frame_cfg *cfg)
 	return ret;
 }
 
+static const char *rkvpss_ofl_fence_get_driver_name(struct dma_fence *fence)
+{
+	return "rkvpss";
+}
+
+static const char *rkvpss_ofl_fence_get_timeline_name(struct dma_fence *fence)
+{
+	return "rkvpss-offline";
+}
+
+static const struct dma_fence_ops rkvpss_ofl_fence_ops = {
+	.get_driver_name = rkvpss_ofl_fence_get_driver_name,
+	.get_timeline_name = rkvpss_ofl_fence_get_timeline_name,
+};
+
+static void rkvpss_ofl_job_work(struct work_struct *work)
+{
+	struct rkvpss_ofl_job *job = container_of(work, struct rkvpss_ofl_job, work);
+	struct rkvpss_offline_dev *ofl = video_drvdata(job->file);
+	int i, ret = 0;
+
+	for (i = 0; i < job->cnt; i++) {
+		/*
+		 * serialized with the ioctls of all the files, per frame so
+		 * that they are not held off for the whole batch
+		 */
+		mutex_lock(&ofl->apilock);
+		ret = rkvpss_prepare_run(job->file, &job->cfg[i]);
+		mutex_unlock(&ofl->apilock);
+		if (ret < 0) {
+			v4l2_err(&ofl->v4l2_dev, "queued frame %d/%d dev_id:%d seq:%d error:%d\n",
+				 i, job->cnt, job->cfg[i].dev_id, job->cfg[i].sequence, ret);
+			break;
+		}
+	}
+
+	if (ret < 0)
+		dma_fence_set_error(job->fence, ret);
+	dma_fence_signal(job->fence);
+	dma_fence_put(job->fence);
+	atomic_dec(&file_to_ofl_fh(job->file)->jobs);
+	fput(job->file);
+	kvfree(job);
+}
+
+static int rkvpss_ofl_queue(struct file *file, struct rkvpss_frame_batch *batch)
+{
+	struct rkvpss_offline_dev *ofl = video_drvdata(file);
+	struct rkvpss_ofl_fh *ofh = file_to_ofl_fh(file);
+	struct rkvpss_ofl_job *job;
+	struct sync_file *sync_file;
+	struct dma_fence *fence;
+	int i, fd, ret;
+	bool unite;
+
+	if (batch->cnt <= 0 || batch->cnt > RKVPSS_FRAME_BATCH_MAX)
+		return -EINVAL;
+
+	/* bound the memory and the work a file can queue ahead */
+	if (atomic_inc_return(&ofh->jobs) > RKVPSS_OFL_JOBS_MAX) {
+		ret = -EBUSY;
+		goto dec_jobs;
+	}
+
+	job = kvzalloc(struct_size(job, cfg, batch->cnt), GFP_KERNEL);
+	if (!job) {
+		ret = -ENOMEM;
+		goto dec_jobs;
+	}
+	if (copy_from_user(job->cfg, u64_to_user_ptr(batch->cfg),
+			   batch->cnt * sizeof(job->cfg[0]))) {
+		ret = -EFAULT;
+		goto free_job;
+	}
+	/* reject the whole batch now, rather than failing it later */
+	for (i = 0; i < batch->cnt; i++) {
+		ret = rkvpss_check_params(file, &job->cfg[i], &unite);
+		if (ret < 0)
+			goto free_job;
+	}
+
+	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+	if (!fence) {
+		ret = -ENOMEM;
+		goto free_job;
+	}
+	dma_fence_init(fence, &rkvpss_ofl_fence_ops, &ofl->fence_lock,
+		       ofl->fence_context, ++ofl->fence_seqno);
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0) {
+		ret = fd;
+		goto put_fence;
+	}
+	sync_file = sync_file_create(fence);
+	if (!sync_file) {
+		put_unused_fd(fd);
+		ret = -ENOMEM;
+		goto put_fence;
+	}
+
+	job->cnt = batch->cnt;
+	job->fence = fence;
+	job->file = get_file(file);
+	INIT_WORK(&job->work, rkvpss_ofl_job_work);
+	fd_install(fd, sync_file->file);
+	batch->out_fence_fd = fd;
+	queue_work(ofl->job_wq, &job->work);
+
+	v4l2_dbg(2, rkvpss_debug, &ofl->v4l2_dev,
+		 "%s cnt:%d fence:%llu fd:%d\n",
+		 __func__, batch->cnt, fence->seqno, fd);
+	return 0;
+put_fence:
+	dma_fence_put(fence);
+free_job:
+	kvfree(job);
+dec_jobs:
+	atomic_dec(&ofh->jobs);
+	return ret;
+}
+
 static long rkvpss_ofl_ioctl(struct file *file, void *fh,
 			     bool valid_prio, unsigned int cmd, void *arg)
 {
@@ -2009,6 +2185,9 @@ static long rkvpss_ofl_ioctl(struct file *file, void *fh,
 	case RKVPSS_CMD_CHECKPARAMS:
 		ret = rkvpss_check_params(file, arg, &unite);
 		break;
+	case RKVPSS_CMD_FRAME_QUEUE:
+		ret = rkvpss_ofl_queue(file, arg);
+		break;
 	default:
 		ret = -EFAULT;
 	}
@@ -2020,20 +2199,37 @@ static const struct v4l2_ioctl_ops offline_ioctl_ops = {
 	.vidioc_default = rkvpss_ofl_ioctl,
 };
 
+static void ofl_fh_release(struct file *file)
+{
+	struct rkvpss_ofl_fh *ofh = file_to_ofl_fh(file);
+
+	v4l2_fh_del(&ofh->fh);
+	v4l2_fh_exit(&ofh->fh);
+	kfree(ofh);
+	file->private_data = NULL;
+}
+
 static int ofl_open(struct file *file)
 {
 	struct rkvpss_offline_dev *ofl = video_drvdata(file);
+	struct rkvpss_ofl_fh *ofh;
 	int ret;
 
-	ret = v4l2_fh_open(file);
-	if (ret)
+	ofh = kzalloc(sizeof(*ofh), GFP_KERNEL);
+	if (!ofh) {
+		ret = -ENOMEM;
 		goto end;
+	}
+	atomic_set(&ofh->jobs, 0);
+	v4l2_fh_init(&ofh->fh, video_devdata(file));
+	file->private_data = &ofh->fh;
+	v4l2_fh_add(&ofh->fh);
 
 	mutex_lock(&ofl->hw->dev_lock);
 	ret = pm_runtime_get_sync(ofl->hw->dev);
 	mutex_unlock(&ofl->hw->dev_lock);
 	if (ret < 0)
-		v4l2_fh_release(file);
+		ofl_fh_release(file);
 end:
 	v4l2_dbg(1, rkvpss_debug, &ofl->v4l2_dev,
 		 "%s file:%p ret:%d\n", __func__, file, ret);
@@ -2047,7 +2243,7 @@ static int ofl_release(struct file *file)
 	v4l2_dbg(1, rkvpss_debug, &ofl->v4l2_dev,
 		 "%s file:%p\n", __func__, file);
 
-	v4l2_fh_release(file);
+	ofl_fh_release(file);
 	buf_del(file, 0, 0, true, false);
 	mutex_lock(&ofl->hw->dev_lock);
 	pm_runtime_put_sync(ofl->hw->dev);
@@ -2099,6 +2295,15 @@ int rkvpss_register_offline(struct rkvpss_hw_dev *hw)
 	if (ret)
 		return ret;
 
+	ofl->job_wq = alloc_ordered_workqueue("rkvpss_ofl", 0);
+	if (!ofl->job_wq) {
+		ret = -ENOMEM;
+		goto unreg_v4l2;
+	}
+	spin_lock_init(&ofl->fence_lock);
+	ofl->fence_context = dma_fence_context_alloc(1);
+	zme_coe_init(ofl);
+
 	mutex_init(&ofl->apilock);
 	ofl->vfd = offline_videodev;
 	ofl->mode_sel_en = true;
@@ -2109,7 +2314,7 @@ int rkvpss_register_offline(struct rkvpss_hw_dev *hw)
 	ret = video_register_device(vfd, VFL_TYPE_VIDEO, 0);
 	if (ret) {
 		v4l2_err(v4l2_dev, "Failed to register video device\n");
-		goto unreg_v4l2;
+		goto destroy_wq;
 	}
 	video_set_drvdata(vfd, ofl);
 	INIT_LIST_HEAD(&ofl->list);
@@ -2117,17 +2322,25 @@ int rkvpss_register_offline(struct rkvpss_hw_dev *hw)
 	mutex_init(&ofl->ofl_lock);
 	rkvpss_offline_proc_init(ofl);
 	return 0;
-unreg_v4l2:
+destroy_wq:
 	mutex_destroy(&ofl->apilock);
+	destroy_workqueue(ofl->job_wq);
+unreg_v4l2:
 	v4l2_device_unregister(v4l2_dev);
 	return ret;
 }
 
 void rkvpss_unregister_offline(struct rkvpss_hw_dev *hw)
 {
-	mutex_destroy(&hw->ofl_dev.apilock);
 	video_unregister_device(&hw->ofl_dev.vfd);
+	/* the queued jobs hold a reference on their file */
+	destroy_workqueue(hw->ofl_dev.job_wq);
+	mutex_destroy(&hw->ofl_dev.apilock);
 	v4l2_device_unregister(&hw->ofl_dev.v4l2_dev);
 	mutex_destroy(&hw->ofl_dev.ofl_lock);
 	rkvpss_offline_proc_cleanup(&hw->ofl_dev);
 }
+
+#ifdef CONFIG_VIDEO_ROCKCHIP_VPSS_KUNIT_TEST
+#include "vpss_offline_test.c"
+#endif
@@ -6,7 +6,11 @@
 #define DEV_NUM_MAX 256
 #define UNITE_ENLARGE 16
 #define UNITE_LEFT_ENLARGE 16
+#define RKVPSS_ZME_COE_NUM 68
+#define RKVPSS_ZME_COE_TBL 11
 
+#include <linux/dma-fence.h>
+#include <linux/workqueue.h>
 #include "hw.h"
 
 struct rkvpss_ofl_incfginfo {
@@ -48,6 +52,13 @@ struct rkvpss_dev_rate {
 };
 
 struct rkvpss_unite_scl_params {
+	/* the scaling the params below are calculated for */
+	u32 crop_w;
+	u32 crop_h;
+	u32 scl_w;
+	u32 scl_h;
+	u32 enlarge;
+
 	u32 y_w_fac;
 	u32 c_w_fac;
 	u32 y_h_fac;
@@ -75,6 +86,16 @@ struct rkvpss_offline_dev {
 	struct rkvpss_unite_scl_params unite_params[RKVPSS_OUTPUT_MAX];
 	u32 unite_right_enlarge;
 	bool mode_sel_en;
+
+	/* zme coefficients in register format, by coefficient table index */
+	u32 zme_hor_coe[RKVPSS_ZME_COE_TBL][RKVPSS_ZME_COE_NUM];
+	u32 zme_ver_coe[RKVPSS_ZME_COE_TBL][RKVPSS_ZME_COE_NUM];
+
+	/* queued frames, see RKVPSS_CMD_FRAME_QUEUE */
+	struct workqueue_struct *job_wq;
+	spinlock_t fence_lock;
+	u64 fence_context;
+	u64 fence_seqno;
 };
 
 int rkvpss_register_offline(struct rkvpss_hw_dev *hw);
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (c) 2024 Rockchip Electronics Co., Ltd. */
+/* KUnit tests of the offline zme and unite helpers, included by vpss_offline.c */
+
+#include <kunit/test.h>
+
+static void rkvpss_test_zme_coe_pack(struct kunit *test)
+{
+	s16 coe[17][8];
+	u32 *val;
+	int i, j;
+
+	val = kunit_kcalloc(test, RKVPSS_ZME_COE_NUM, sizeof(*val), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, val);
+	for (i = 0; i < 17; i++)
+		for (j = 0; j < 8; j++)
+			coe[i][j] = (j & 1) ? -(i * 8 + j) : i * 8 + j;
+
+	zme_coe_pack(coe, val);
+
+	/* two taps per register, low tap in the low half, 10 bits each */
+	for (i = 0; i < 17; i++) {
+		for (j = 0; j < 8; j += 2) {
+			u32 expect = (coe[i][j] & 0x3ff) | ((coe[i][j + 1] & 0x3ff) << 16);
+
+			KUNIT_EXPECT_EQ(test, val[i * 4 + j / 2], expect);
+		}
+	}
+}
+
+static void rkvpss_test_zme_coe_init(struct kunit *test)
+{
+	struct rkvpss_offline_dev *ofl;
+	u32 *val;
+	int idx;
+
+	ofl = kunit_kzalloc(test, sizeof(*ofl), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ofl);
+	val = kunit_kcalloc(test, RKVPSS_ZME_COE_NUM, sizeof(*val), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, val);
+
+	zme_coe_init(ofl);
+
+	for (idx = 0; idx < RKVPSS_ZME_COE_TBL; idx++) {
+		zme_coe_pack(rkvpss_zme_tap8_coe[idx], val);
+		KUNIT_EXPECT_EQ(test, memcmp(ofl->zme_hor_coe[idx], val,
+					     RKVPSS_ZME_COE_NUM * sizeof(*val)), 0);
+		zme_coe_pack(rkvpss_zme_tap6_coe[idx], val);
+		KUNIT_EXPECT_EQ(test, memcmp(ofl->zme_ver_coe[idx], val,
+					     RKVPSS_ZME_COE_NUM * sizeof(*val)), 0);
+	}
+}
+
+static void rkvpss_test_unite_params(struct kunit *test)
+{
+	struct rkvpss_offline_dev *ofl;
+	struct rkvpss_frame_cfg *cfg;
+	struct rkvpss_unite_scl_params *params;
+
+	ofl = kunit_kzalloc(test, sizeof(*ofl), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ofl);
+	cfg = kunit_kzalloc(test, sizeof(*cfg), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, cfg);
+	params = &ofl->unite_params[0];
+
+	ofl->unite_right_enlarge = UNITE_ENLARGE;
+	cfg->output[0].enable = 1;
+	cfg->output[0].crop_width = 3840;
+	cfg->output[0].crop_height = 2160;
+	cfg->output[0].scl_width = 1920;
+	cfg->output[0].scl_height = 1080;
+	calc_unite_scl_params(ofl, cfg);
+
+	KUNIT_EXPECT_EQ(test, params->y_w_fac, 3839 * 4096 / 1919);
+	KUNIT_EXPECT_EQ(test, params->c_w_fac, 1919 * 4096 / 959);
+	KUNIT_EXPECT_EQ(test, params->y_h_fac, 2159 * 4096 / 1079);
+	KUNIT_EXPECT_EQ(test, params->crop_w, 3840);
+	KUNIT_EXPECT_EQ(test, params->scl_w, 1920);
+	KUNIT_EXPECT_EQ(test, params->enlarge, UNITE_ENLARGE);
+	/* disabled channels are left alone */
+	KUNIT_EXPECT_EQ(test, ofl->unite_params[1].crop_w, 0);
+
+	/* same scaling: the cached params are kept */
+	params->y_w_fac = 0;
+	calc_unite_scl_params(ofl, cfg);
+	KUNIT_EXPECT_EQ(test, params->y_w_fac, 0);
+
+	/* new scale size: recalculated */
+	cfg->output[0].scl_width = 1280;
+	calc_unite_scl_params(ofl, cfg);
+	KUNIT_EXPECT_EQ(test, params->y_w_fac, 3839 * 4096 / 1279);
+
+	/* new right enlarge: recalculated */
+	params->y_w_fac = 0;
+	ofl->unite_right_enlarge = 0;
+	calc_unite_scl_params(ofl, cfg);
+	KUNIT_EXPECT_EQ(test, params->y_w_fac, 3839 * 4096 / 1279);
+	KUNIT_EXPECT_EQ(test, params->enlarge, 0);
+}
+
+static struct kunit_case rkvpss_ofl_test_cases[] = {
+	KUNIT_CASE(rkvpss_test_zme_coe_pack),
+	KUNIT_CASE(rkvpss_test_zme_coe_init),
+	KUNIT_CASE(rkvpss_test_unite_params),
+	{}
+};
+
+static struct kunit_suite rkvpss_ofl_test_suite = {
+	.name = "rkvpss_offline",
+	.test_cases = rkvpss_ofl_test_cases,
+};
+
+kunit_test_suite(rkvpss_ofl_test_suite);
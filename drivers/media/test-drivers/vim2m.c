@@ -7,16 +7,24 @@
  * destination, processes the data and issues an "irq" (simulated by a delayed
  * workqueue).
  * The device is capable of multi-instance, multi-buffer-per-transaction
- * operation (via the mem2mem framework).
+ * operation (via the mem2mem framework), and runs the jobs of up to
+ * num_workers instances in parallel.
+ * In fast mode the transaction time is not simulated and the rows of each
+ * frame are processed in bands by a pool of kthreads, so the overhead of
+ * the framework can be measured with the per-stage timings in debugfs.
  *
  * Copyright (c) 2009-2010 Samsung Electronics Co., Ltd.
  * Pawel Osciak, <pawel@osciak.com>
  * Marek Szyprowski, <m.szyprowski@samsung.com>
  */
 #include <linux/module.h>
+#include <linux/completion.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/fs.h>
+#include <linux/kthread.h>
 #include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 
 #include <linux/platform_device.h>
@@ -42,6 +50,16 @@ static unsigned int default_transtime = 40; /* Max 25 fps */
 module_param(default_transtime, uint, 0644);
 MODULE_PARM_DESC(default_transtime, "default transaction time in ms");
 
+/* Number of jobs processed at a time, each by its own worker */
+static unsigned int num_workers = 1;
+module_param(num_workers, uint, 0444);
+MODULE_PARM_DESC(num_workers, "number of parallel workers, 1-8");
+
+/* Number of row bands of a frame in fast mode */
+static unsigned int num_bands = 4;
+module_param(num_bands, uint, 0444);
+MODULE_PARM_DESC(num_bands, "number of row bands processed in parallel in fast mode, 1-8");
+
 #define MIN_W 32
 #define MIN_H 32
 #define MAX_W 640
@@ -61,6 +79,9 @@ MODULE_PARM_DESC(default_transtime, "default transaction time in ms");
 
 #define MEM2MEM_NAME		"vim2m"
 
+#define MEM2MEM_MAX_WORKERS	8
+#define MEM2MEM_MAX_BANDS	8
+
 /* Per queue */
 #define MEM2MEM_DEF_NUM_BUFS	VIDEO_MAX_FRAME
 /* In bytes, per queue */
@@ -146,6 +167,37 @@ enum {
 
 #define V4L2_CID_TRANS_TIME_MSEC	(V4L2_CID_USER_BASE + 0x1000)
 #define V4L2_CID_TRANS_NUM_BUFS		(V4L2_CID_USER_BASE + 0x1001)
+#define V4L2_CID_TRANS_FAST		(V4L2_CID_USER_BASE + 0x1002)
+
+/* Stages timed for each buffer */
+enum {
+	VIM2M_STAGE_QUEUE,	/* from buffer queued to job started */
+	VIM2M_STAGE_RUN,	/* from job started to frame processed */
+	VIM2M_STAGE_DONE,	/* from frame processed to buffers returned */
+	VIM2M_STAGE_NUM,
+};
+
+static const char * const vim2m_stage_name[VIM2M_STAGE_NUM] = {
+	"queue",
+	"run",
+	"done",
+};
+
+struct vim2m_stage_stat {
+	u64			count;
+	u64			total_ns;
+	u64			max_ns;
+};
+
+struct vim2m_buffer {
+	/* Must be first, the m2m framework owns it */
+	struct v4l2_m2m_buffer	m2m_buf;
+	/* When the buffer was queued to the driver */
+	u64			queued_ns;
+};
+
+#define to_vim2m_buf(vbuf) \
+	container_of(vbuf, struct vim2m_buffer, m2m_buf.vb)
 
 static struct vim2m_fmt *find_format(u32 fourcc)
 {
@@ -193,6 +245,31 @@ struct vim2m_dev {
 	struct mutex		dev_mutex;
 
 	struct v4l2_m2m_dev	*m2m_dev;
+	/* The module parameters, clamped to the supported range */
+	unsigned int		num_workers;
+	unsigned int		num_bands;
+	/* Runs the jobs of up to num_workers instances at a time */
+	struct workqueue_struct	*workqueue;
+	/* Process the row bands of fast mode, but the first one */
+	struct kthread_worker	*band_workers[MEM2MEM_MAX_BANDS - 1];
+
+	spinlock_t		stat_lock;
+	struct vim2m_stage_stat	stat[VIM2M_STAGE_NUM];
+	struct dentry		*debugfs_root;
+};
+
+struct vim2m_ctx;
+
+/* Rows [y_start, y_end) of the destination frame, processed in fast mode */
+struct vim2m_band {
+	struct kthread_work	work;
+	struct vim2m_ctx	*ctx;
+	u8			*p_in;
+	u8			*p_out;
+	unsigned int		y_start;
+	unsigned int		y_end;
+	/* One row of the frame as 0x00RRGGBB pixels */
+	u32			row[MAX_W];
 };
 
 struct vim2m_ctx {
@@ -212,6 +289,19 @@ struct vim2m_ctx {
 	struct mutex		vb_mutex;
 	struct delayed_work	work_run;
 
+	/* Source buffer whose request controls were applied by device_prepare() */
+	struct vb2_v4l2_buffer	*prepared_buf;
+	/* When the current transaction was started */
+	u64			run_ns;
+
+	/* Fast mode, see device_process_fast() */
+	bool			fast;
+	struct vim2m_band	bands[MEM2MEM_MAX_BANDS];
+	atomic_t		bands_left;
+	struct completion	bands_done;
+	/* Source pixel of each destination pixel of a row */
+	u16			xmap[MAX_W];
+
 	/* Abort requested by m2m */
 	int			aborting;
 
@@ -555,6 +645,247 @@ static int device_process(struct vim2m_ctx *ctx,
 	return 0;
 }
 
+/*
+ * Fast mode. Each row is converted in two passes, decoding the source pixels
+ * picked by ctx->xmap to 0x00RRGGBB and encoding them to the destination
+ * format. The format is dispatched once per row rather than per pixel, and
+ * the rows are split in bands which are processed in parallel.
+ */
+
+static void decode_row(u32 fourcc, const u8 *src, const u16 *xmap,
+		       u32 *row, unsigned int width)
+{
+	unsigned int x;
+	const u8 *p;
+	u16 pix;
+
+	switch (fourcc) {
+	case V4L2_PIX_FMT_RGB565:
+		for (x = 0; x < width; x++) {
+			pix = le16_to_cpu(((__le16 *)src)[xmap[x]]);
+			row[x] = ((((pix & 0xf800) >> 11) << 3 | 0x07) << 16) |
+				 ((((pix & 0x07e0) >> 5) << 2 | 0x03) << 8) |
+				 ((pix & 0x1f) << 3 | 0x07);
+		}
+		break;
+	case V4L2_PIX_FMT_RGB565X:
+		for (x = 0; x < width; x++) {
+			pix = be16_to_cpu(((__be16 *)src)[xmap[x]]);
+			row[x] = ((((pix & 0xf800) >> 11) << 3 | 0x07) << 16) |
+				 ((((pix & 0x07e0) >> 5) << 2 | 0x03) << 8) |
+				 ((pix & 0x1f) << 3 | 0x07);
+		}
+		break;
+	case V4L2_PIX_FMT_BGR24:
+		for (x = 0; x < width; x++) {
+			p = src + xmap[x] * 3;
+			row[x] = p[2] << 16 | p[1] << 8 | p[0];
+		}
+		break;
+	case V4L2_PIX_FMT_RGB24:
+	default:
+		for (x = 0; x < width; x++) {
+			p = src + xmap[x] * 3;
+			row[x] = p[0] << 16 | p[1] << 8 | p[2];
+		}
+		break;
+	}
+}
+
+#define PIX_R(pix)	(((pix) >> 16) & 0xff)
+#define PIX_G(pix)	(((pix) >> 8) & 0xff)
+#define PIX_B(pix)	((pix) & 0xff)
+
+/* Shift of the color of the two pixels of a pair, on even and odd rows */
+static const u8 bayer_shift[4][2][2] = {
+	{ { 0, 8 }, { 8, 16 } },	/* SBGGR8 */
+	{ { 8, 0 }, { 16, 8 } },	/* SGBRG8 */
+	{ { 8, 16 }, { 0, 8 } },	/* SGRBG8 */
+	{ { 16, 8 }, { 8, 0 } },	/* SRGGB8 */
+};
+
+static void encode_row(u32 fourcc, const u32 *row, u8 *dst,
+		       unsigned int width, unsigned int ypos)
+{
+	const u8 *shift;
+	unsigned int x;
+	u32 p0, p1;
+	u16 pix;
+
+	switch (fourcc) {
+	case V4L2_PIX_FMT_RGB565:
+		for (x = 0; x < width; x++) {
+			pix = ((PIX_R(row[x]) << 8) & 0xf800) |
+			      ((PIX_G(row[x]) << 3) & 0x07e0) |
+			      (PIX_B(row[x]) >> 3);
+			((__le16 *)dst)[x] = cpu_to_le16(pix);
+		}
+		return;
+	case V4L2_PIX_FMT_RGB565X:
+		for (x = 0; x < width; x++) {
+			pix = ((PIX_R(row[x]) << 8) & 0xf800) |
+			      ((PIX_G(row[x]) << 3) & 0x07e0) |
+			      (PIX_B(row[x]) >> 3);
+			((__be16 *)dst)[x] = cpu_to_be16(pix);
+		}
+		return;
+	case V4L2_PIX_FMT_RGB24:
+		for (x = 0; x < width; x++) {
+			*dst++ = PIX_R(row[x]);
+			*dst++ = PIX_G(row[x]);
+			*dst++ = PIX_B(row[x]);
+		}
+		return;
+	case V4L2_PIX_FMT_BGR24:
+		for (x = 0; x < width; x++) {
+			*dst++ = PIX_B(row[x]);
+			*dst++ = PIX_G(row[x]);
+			*dst++ = PIX_R(row[x]);
+		}
+		return;
+	case V4L2_PIX_FMT_SBGGR8:
+	case V4L2_PIX_FMT_SGBRG8:
+	case V4L2_PIX_FMT_SGRBG8:
+	case V4L2_PIX_FMT_SRGGB8:
+		if (fourcc == V4L2_PIX_FMT_SBGGR8)
+			shift = bayer_shift[0][ypos & 1];
+		else if (fourcc == V4L2_PIX_FMT_SGBRG8)
+			shift = bayer_shift[1][ypos & 1];
+		else if (fourcc == V4L2_PIX_FMT_SGRBG8)
+			shift = bayer_shift[2][ypos & 1];
+		else
+			shift = bayer_shift[3][ypos & 1];
+		for (x = 0; x < width; x += 2) {
+			*dst++ = row[x] >> shift[0];
+			*dst++ = row[x + 1] >> shift[1];
+		}
+		return;
+	case V4L2_PIX_FMT_YUYV:
+	default:
+		for (x = 0; x < width; x += 2) {
+			p0 = row[x];
+			p1 = row[x + 1];
+			*dst++ = (8453 * PIX_R(p0) + 16594 * PIX_G(p0) +
+				  3223 * PIX_B(p0) + 524288) >> 15;
+			*dst++ = (-4878 * (int)PIX_R(p0) - 9578 * (int)PIX_G(p0) +
+				  14456 * (int)PIX_B(p0) + 4210688) >> 15;
+			*dst++ = (8453 * PIX_R(p1) + 16594 * PIX_G(p1) +
+				  3223 * PIX_B(p1) + 524288) >> 15;
+			*dst++ = (14456 * (int)PIX_R(p0) - 12105 * (int)PIX_G(p0) -
+				  2351 * (int)PIX_B(p0) + 4210688) >> 15;
+		}
+		return;
+	}
+}
+
+static void vim2m_band_process(struct vim2m_band *band)
+{
+	struct vim2m_ctx *ctx = band->ctx;
+	struct vim2m_q_data *q_data_in = &ctx->q_data[V4L2_M2M_SRC];
+	struct vim2m_q_data *q_data_out = &ctx->q_data[V4L2_M2M_DST];
+	unsigned int in_bpl = (q_data_in->width * q_data_in->fmt->depth) >> 3;
+	unsigned int out_bpl = (q_data_out->width * q_data_out->fmt->depth) >> 3;
+	unsigned int height = q_data_out->height;
+	unsigned int width = q_data_out->width;
+	bool copy = q_data_in->fmt->fourcc == q_data_out->fmt->fourcc &&
+		    q_data_in->width == q_data_out->width &&
+		    !(ctx->mode & MEM2MEM_HFLIP);
+	unsigned int y, y_in, y_out;
+	u8 *src;
+
+	for (y_out = band->y_start; y_out < band->y_end; y_out++) {
+		y = (ctx->mode & MEM2MEM_VFLIP) ? height - 1 - y_out : y_out;
+		y_in = (y * q_data_in->height) / height;
+		src = band->p_in + y_in * in_bpl;
+
+		if (copy) {
+			memcpy(band->p_out + y_out * out_bpl, src, out_bpl);
+			continue;
+		}
+
+		decode_row(q_data_in->fmt->fourcc, src, ctx->xmap, band->row,
+			   width);
+		encode_row(q_data_out->fmt->fourcc, band->row,
+			   band->p_out + y_out * out_bpl, width, y_out);
+	}
+}
+
+static void vim2m_band_work(struct kthread_work *work)
+{
+	struct vim2m_band *band = container_of(work, struct vim2m_band, work);
+	struct vim2m_ctx *ctx = band->ctx;
+
+	vim2m_band_process(band);
+	if (atomic_dec_and_test(&ctx->bands_left))
+		complete(&ctx->bands_done);
+}
+
+static int device_process_fast(struct vim2m_ctx *ctx,
+			       struct vb2_v4l2_buffer *in_vb,
+			       struct vb2_v4l2_buffer *out_vb)
+{
+	struct vim2m_dev *dev = ctx->dev;
+	struct vim2m_q_data *q_data_in = &ctx->q_data[V4L2_M2M_SRC];
+	struct vim2m_q_data *q_data_out = &ctx->q_data[V4L2_M2M_DST];
+	unsigned int height = q_data_out->height;
+	unsigned int width = q_data_out->width;
+	unsigned int x, i, nbands, rows;
+	u8 *p_in, *p_out;
+
+	p_in = vb2_plane_vaddr(&in_vb->vb2_buf, 0);
+	p_out = vb2_plane_vaddr(&out_vb->vb2_buf, 0);
+	if (!p_in || !p_out) {
+		v4l2_err(&dev->v4l2_dev,
+			 "Acquiring kernel pointers to buffers failed\n");
+		return -EFAULT;
+	}
+
+	out_vb->sequence = q_data_out->sequence++;
+	in_vb->sequence = q_data_in->sequence++;
+	v4l2_m2m_buf_copy_metadata(in_vb, out_vb, true);
+
+	for (x = 0; x < width; x++) {
+		ctx->xmap[x] = (x * q_data_in->width) / width;
+		if (ctx->mode & MEM2MEM_HFLIP)
+			ctx->xmap[x] = q_data_in->width - 1 - ctx->xmap[x];
+	}
+
+	nbands = min(dev->num_bands, height);
+	rows = DIV_ROUND_UP(height, nbands);
+	nbands = DIV_ROUND_UP(height, rows);
+
+	atomic_set(&ctx->bands_left, nbands);
+	reinit_completion(&ctx->bands_done);
+	for (i = 0; i < nbands; i++) {
+		struct vim2m_band *band = &ctx->bands[i];
+
+		band->p_in = p_in;
+		band->p_out = p_out;
+		band->y_start = i * rows;
+		band->y_end = min(band->y_start + rows, height);
+		if (i)
+			kthread_queue_work(dev->band_workers[i - 1], &band->work);
+	}
+
+	/* The first band is processed here, while the others go on */
+	vim2m_band_work(&ctx->bands[0].work);
+	wait_for_completion(&ctx->bands_done);
+
+	return 0;
+}
+
+static void vim2m_stat_add(struct vim2m_dev *dev, unsigned int stage, u64 ns)
+{
+	struct vim2m_stage_stat *stat = &dev->stat[stage];
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->stat_lock, flags);
+	stat->count++;
+	stat->total_ns += ns;
+	stat->max_ns = max(stat->max_ns, ns);
+	spin_unlock_irqrestore(&dev->stat_lock, flags);
+}
+
 /*
  * mem2mem callbacks
  */
@@ -583,6 +914,26 @@ static void job_abort(void *priv)
 	ctx->aborting = 1;
 }
 
+/* device_prepare() - prepares the next job while the workers are busy
+ *
+ * This simulates loading the registers of a device for the next job, while
+ * the jobs of the other instances are still running.
+ */
+static void device_prepare(void *priv)
+{
+	struct vim2m_ctx *ctx = priv;
+	struct vb2_v4l2_buffer *src_buf;
+
+	src_buf = v4l2_m2m_next_src_buf(ctx->fh.m2m_ctx);
+	if (!src_buf)
+		return;
+
+	/* Apply request controls if any */
+	v4l2_ctrl_request_setup(src_buf->vb2_buf.req_obj.req,
+				&ctx->hdl);
+	ctx->prepared_buf = src_buf;
+}
+
 /* device_run() - prepares and starts the device
  *
  * This simulates all the immediate preparations required before starting
@@ -592,23 +943,26 @@ static void job_abort(void *priv)
 static void device_run(void *priv)
 {
 	struct vim2m_ctx *ctx = priv;
-	struct vb2_v4l2_buffer *src_buf, *dst_buf;
+	struct vb2_v4l2_buffer *src_buf;
 
 	src_buf = v4l2_m2m_next_src_buf(ctx->fh.m2m_ctx);
-	dst_buf = v4l2_m2m_next_dst_buf(ctx->fh.m2m_ctx);
-
-	/* Apply request controls if any */
-	v4l2_ctrl_request_setup(src_buf->vb2_buf.req_obj.req,
-				&ctx->hdl);
 
-	device_process(ctx, src_buf, dst_buf);
+	ctx->run_ns = ktime_get_ns();
+	vim2m_stat_add(ctx->dev, VIM2M_STAGE_QUEUE,
+		       ctx->run_ns - to_vim2m_buf(src_buf)->queued_ns);
 
-	/* Complete request controls if any */
-	v4l2_ctrl_request_complete(src_buf->vb2_buf.req_obj.req,
-				   &ctx->hdl);
+	/* Apply request controls if any, unless done by device_prepare() */
+	if (ctx->prepared_buf != src_buf)
+		v4l2_ctrl_request_setup(src_buf->vb2_buf.req_obj.req,
+					&ctx->hdl);
+	ctx->prepared_buf = NULL;
 
-	/* Run delayed work, which simulates a hardware irq  */
-	schedule_delayed_work(&ctx->work_run, msecs_to_jiffies(ctx->transtime));
+	/*
+	 * The processing is done by one of the workers, which completes
+	 * the job after the transaction time as a hardware irq would.
+	 */
+	queue_delayed_work(ctx->dev->workqueue, &ctx->work_run,
+			   ctx->fast ? 0 : msecs_to_jiffies(ctx->transtime));
 }
 
 static void device_work(struct work_struct *w)
@@ -616,6 +970,7 @@ static void device_work(struct work_struct *w)
 	struct vim2m_ctx *curr_ctx;
 	struct vim2m_dev *vim2m_dev;
 	struct vb2_v4l2_buffer *src_vb, *dst_vb;
+	u64 done_ns;
 
 	curr_ctx = container_of(w, struct vim2m_ctx, work_run.work);
 
@@ -624,6 +979,18 @@ static void device_work(struct work_struct *w)
 	src_vb = v4l2_m2m_src_buf_remove(curr_ctx->fh.m2m_ctx);
 	dst_vb = v4l2_m2m_dst_buf_remove(curr_ctx->fh.m2m_ctx);
 
+	if (curr_ctx->fast)
+		device_process_fast(curr_ctx, src_vb, dst_vb);
+	else
+		device_process(curr_ctx, src_vb, dst_vb);
+
+	done_ns = ktime_get_ns();
+	vim2m_stat_add(vim2m_dev, VIM2M_STAGE_RUN, done_ns - curr_ctx->run_ns);
+
+	/* Complete request controls if any */
+	v4l2_ctrl_request_complete(src_vb->vb2_buf.req_obj.req,
+				   &curr_ctx->hdl);
+
 	curr_ctx->num_processed++;
 
 	v4l2_m2m_buf_done(src_vb, VB2_BUF_STATE_DONE);
@@ -633,8 +1000,12 @@ static void device_work(struct work_struct *w)
 	    || curr_ctx->aborting) {
 		dprintk(curr_ctx->dev, 2, "Finishing capture buffer fill\n");
 		curr_ctx->num_processed = 0;
+		vim2m_stat_add(vim2m_dev, VIM2M_STAGE_DONE,
+			       ktime_get_ns() - done_ns);
 		v4l2_m2m_job_finish(vim2m_dev->m2m_dev, curr_ctx->fh.m2m_ctx);
 	} else {
+		vim2m_stat_add(vim2m_dev, VIM2M_STAGE_DONE,
+			       ktime_get_ns() - done_ns);
 		device_run(curr_ctx);
 	}
 }
@@ -928,6 +1299,10 @@ static int vim2m_s_ctrl(struct v4l2_ctrl *ctrl)
 		ctx->translen = ctrl->val;
 		break;
 
+	case V4L2_CID_TRANS_FAST:
+		ctx->fast = ctrl->val;
+		break;
+
 	default:
 		v4l2_err(&ctx->dev->v4l2_dev, "Invalid control\n");
 		return -EINVAL;
@@ -1048,6 +1423,7 @@ static void vim2m_buf_queue(struct vb2_buffer *vb)
 	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
 	struct vim2m_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
 
+	to_vim2m_buf(vbuf)->queued_ns = ktime_get_ns();
 	v4l2_m2m_buf_queue(ctx->fh.m2m_ctx, vbuf);
 }
 
@@ -1072,6 +1448,7 @@ static void vim2m_stop_streaming(struct vb2_queue *q)
 	struct vb2_v4l2_buffer *vbuf;
 
 	cancel_delayed_work_sync(&ctx->work_run);
+	ctx->prepared_buf = NULL;
 
 	for (;;) {
 		if (V4L2_TYPE_IS_OUTPUT(q->type))
@@ -1114,7 +1491,7 @@ static int queue_init(void *priv, struct vb2_queue *src_vq,
 	src_vq->type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
 	src_vq->io_modes = VB2_MMAP | VB2_USERPTR | VB2_DMABUF;
 	src_vq->drv_priv = ctx;
-	src_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
+	src_vq->buf_struct_size = sizeof(struct vim2m_buffer);
 	src_vq->ops = &vim2m_qops;
 	src_vq->mem_ops = &vb2_vmalloc_memops;
 	src_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
@@ -1128,7 +1505,7 @@ static int queue_init(void *priv, struct vb2_queue *src_vq,
 	dst_vq->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 	dst_vq->io_modes = VB2_MMAP | VB2_USERPTR | VB2_DMABUF;
 	dst_vq->drv_priv = ctx;
-	dst_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
+	dst_vq->buf_struct_size = sizeof(struct vim2m_buffer);
 	dst_vq->ops = &vim2m_qops;
 	dst_vq->mem_ops = &vb2_vmalloc_memops;
 	dst_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
@@ -1158,6 +1535,98 @@ static const struct v4l2_ctrl_config vim2m_ctrl_trans_num_bufs = {
 	.step = 1,
 };
 
+static const struct v4l2_ctrl_config vim2m_ctrl_trans_fast = {
+	.ops = &vim2m_ctrl_ops,
+	.id = V4L2_CID_TRANS_FAST,
+	.name = "Fast Processing",
+	.type = V4L2_CTRL_TYPE_BOOLEAN,
+	.def = 0,
+	.min = 0,
+	.max = 1,
+	.step = 1,
+};
+
+/*
+ * Per-stage timings, in debugfs
+ */
+static int vim2m_stats_show(struct seq_file *s, void *data)
+{
+	struct vim2m_dev *dev = s->private;
+	struct vim2m_stage_stat stat[VIM2M_STAGE_NUM];
+	unsigned int i;
+
+	spin_lock_irq(&dev->stat_lock);
+	memcpy(stat, dev->stat, sizeof(stat));
+	spin_unlock_irq(&dev->stat_lock);
+
+	seq_printf(s, "%-8s %12s %12s %12s\n", "stage", "count",
+		   "avg (ns)", "max (ns)");
+	for (i = 0; i < VIM2M_STAGE_NUM; i++)
+		seq_printf(s, "%-8s %12llu %12llu %12llu\n",
+			   vim2m_stage_name[i], stat[i].count,
+			   stat[i].count ?
+			   div64_u64(stat[i].total_ns, stat[i].count) : 0,
+			   stat[i].max_ns);
+
+	return 0;
+}
+
+static int vim2m_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, vim2m_stats_show, inode->i_private);
+}
+
+/* Any write resets the timings */
+static ssize_t vim2m_stats_write(struct file *file, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct vim2m_dev *dev = s->private;
+
+	spin_lock_irq(&dev->stat_lock);
+	memset(dev->stat, 0, sizeof(dev->stat));
+	spin_unlock_irq(&dev->stat_lock);
+
+	return count;
+}
+
+static const struct file_operations vim2m_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= vim2m_stats_open,
+	.read		= seq_read,
+	.write		= vim2m_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void vim2m_band_workers_destroy(struct vim2m_dev *dev)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(dev->band_workers); i++) {
+		if (dev->band_workers[i])
+			kthread_destroy_worker(dev->band_workers[i]);
+		dev->band_workers[i] = NULL;
+	}
+}
+
+static int vim2m_band_workers_create(struct vim2m_dev *dev)
+{
+	struct kthread_worker *worker;
+	unsigned int i;
+
+	for (i = 0; i < dev->num_bands - 1; i++) {
+		worker = kthread_create_worker(0, MEM2MEM_NAME "-band%u", i + 1);
+		if (IS_ERR(worker)) {
+			vim2m_band_workers_destroy(dev);
+			return PTR_ERR(worker);
+		}
+		dev->band_workers[i] = worker;
+	}
+
+	return 0;
+}
+
 /*
  * File operations
  */
@@ -1166,6 +1635,7 @@ static int vim2m_open(struct file *file)
 	struct vim2m_dev *dev = video_drvdata(file);
 	struct vim2m_ctx *ctx = NULL;
 	struct v4l2_ctrl_handler *hdl;
+	unsigned int i;
 	int rc = 0;
 
 	if (mutex_lock_interruptible(&dev->dev_mutex))
@@ -1180,13 +1650,14 @@ static int vim2m_open(struct file *file)
 	file->private_data = &ctx->fh;
 	ctx->dev = dev;
 	hdl = &ctx->hdl;
-	v4l2_ctrl_handler_init(hdl, 4);
+	v4l2_ctrl_handler_init(hdl, 5);
 	v4l2_ctrl_new_std(hdl, &vim2m_ctrl_ops, V4L2_CID_HFLIP, 0, 1, 1, 0);
 	v4l2_ctrl_new_std(hdl, &vim2m_ctrl_ops, V4L2_CID_VFLIP, 0, 1, 1, 0);
 
 	vim2m_ctrl_trans_time_msec.def = default_transtime;
 	v4l2_ctrl_new_custom(hdl, &vim2m_ctrl_trans_time_msec, NULL);
 	v4l2_ctrl_new_custom(hdl, &vim2m_ctrl_trans_num_bufs, NULL);
+	v4l2_ctrl_new_custom(hdl, &vim2m_ctrl_trans_fast, NULL);
 	if (hdl->error) {
 		rc = hdl->error;
 		v4l2_ctrl_handler_free(hdl);
@@ -1210,6 +1681,11 @@ static int vim2m_open(struct file *file)
 
 	mutex_init(&ctx->vb_mutex);
 	INIT_DELAYED_WORK(&ctx->work_run, device_work);
+	init_completion(&ctx->bands_done);
+	for (i = 0; i < MEM2MEM_MAX_BANDS; i++) {
+		ctx->bands[i].ctx = ctx;
+		kthread_init_work(&ctx->bands[i].work, vim2m_band_work);
+	}
 
 	if (IS_ERR(ctx->fh.m2m_ctx)) {
 		rc = PTR_ERR(ctx->fh.m2m_ctx);
@@ -1257,6 +1733,8 @@ static void vim2m_device_release(struct video_device *vdev)
 
 	v4l2_device_unregister(&dev->v4l2_dev);
 	v4l2_m2m_release(dev->m2m_dev);
+	vim2m_band_workers_destroy(dev);
+	destroy_workqueue(dev->workqueue);
 #ifdef CONFIG_MEDIA_CONTROLLER
 	media_device_cleanup(&dev->mdev);
 #endif
@@ -1286,6 +1764,7 @@ static const struct v4l2_m2m_ops m2m_ops = {
 	.device_run	= device_run,
 	.job_ready	= job_ready,
 	.job_abort	= job_abort,
+	.device_prepare	= device_prepare,
 };
 
 static const struct media_device_ops m2m_media_ops = {
@@ -1309,6 +1788,7 @@ static int vim2m_probe(struct platform_device *pdev)
 
 	atomic_set(&dev->num_inst, 0);
 	mutex_init(&dev->dev_mutex);
+	spin_lock_init(&dev->stat_lock);
 
 	dev->vfd = vim2m_videodev;
 	vfd = &dev->vfd;
@@ -1321,13 +1801,28 @@ static int vim2m_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, dev);
 
+	dev->num_workers = clamp_t(unsigned int, num_workers, 1, MEM2MEM_MAX_WORKERS);
+	dev->workqueue = alloc_workqueue(MEM2MEM_NAME, WQ_UNBOUND, dev->num_workers);
+	if (!dev->workqueue) {
+		ret = -ENOMEM;
+		goto error_dev;
+	}
+
+	dev->num_bands = clamp_t(unsigned int, num_bands, 1, MEM2MEM_MAX_BANDS);
+	ret = vim2m_band_workers_create(dev);
+	if (ret) {
+		v4l2_err(&dev->v4l2_dev, "Failed to create band workers\n");
+		goto error_wq;
+	}
+
 	dev->m2m_dev = v4l2_m2m_init(&m2m_ops);
 	if (IS_ERR(dev->m2m_dev)) {
 		v4l2_err(&dev->v4l2_dev, "Failed to init mem2mem device\n");
 		ret = PTR_ERR(dev->m2m_dev);
 		dev->m2m_dev = NULL;
-		goto error_dev;
+		goto error_band;
 	}
+	v4l2_m2m_set_max_jobs(dev->m2m_dev, dev->num_workers);
 
 #ifdef CONFIG_MEDIA_CONTROLLER
 	dev->mdev.dev = &pdev->dev;
@@ -1359,6 +1854,11 @@ static int vim2m_probe(struct platform_device *pdev)
 		goto error_m2m_mc;
 	}
 #endif
+
+	dev->debugfs_root = debugfs_create_dir(dev_name(&pdev->dev), NULL);
+	debugfs_create_file("stats", 0644, dev->debugfs_root, dev,
+			    &vim2m_stats_fops);
+
 	return 0;
 
 #ifdef CONFIG_MEDIA_CONTROLLER
@@ -1371,6 +1871,10 @@ static int vim2m_probe(struct platform_device *pdev)
 	return ret;
 error_m2m:
 	v4l2_m2m_release(dev->m2m_dev);
+error_band:
+	vim2m_band_workers_destroy(dev);
+error_wq:
+	destroy_workqueue(dev->workqueue);
 error_dev:
 	v4l2_device_unregister(&dev->v4l2_dev);
 error_free:
@@ -1385,6 +1889,8 @@ static int vim2m_remove(struct platform_device *pdev)
 
 	v4l2_info(&dev->v4l2_dev, "Removing " MEM2MEM_NAME);
 
+	debugfs_remove_recursive(dev->debugfs_root);
+
 #ifdef CONFIG_MEDIA_CONTROLLER
 	media_device_unregister(&dev->mdev);
 	v4l2_m2m_unregister_media_controller(dev->m2m_dev);
@@ -893,6 +893,114 @@ int __v4l2_ctrl_s_ctrl_int64(struct v4l2_ctrl *ctrl, s64 val)
 }
 EXPORT_SYMBOL(__v4l2_ctrl_s_ctrl_int64);
 
+/* Store a batched value as the new value of the control */
+static void batch_val_to_new(struct v4l2_ctrl *ctrl, s64 val)
+{
+	if (ctrl->type == V4L2_CTRL_TYPE_INTEGER64)
+		*ctrl->p_new.p_s64 = val;
+	else
+		ctrl->val = val;
+	ctrl->is_new = 1;
+}
+
+/* Load the batched values of the cluster of @master as its new values */
+static void batch_cluster_to_new(struct v4l2_ctrl *master,
+				 struct v4l2_ctrl_batch_val *vals,
+				 unsigned int num)
+{
+	s32 new_auto_val = master->manual_mode_value + 1;
+	unsigned int i;
+
+	/* Reset the 'is_new' flags of the cluster */
+	for (i = 0; i < master->ncontrols; i++)
+		if (master->cluster[i])
+			master->cluster[i]->is_new = 0;
+
+	/*
+	 * As for VIDIOC_S_EXT_CTRLS, copy the current volatile values
+	 * first if the autocluster is switched to manual mode.
+	 */
+	if (master->is_auto && master->has_volatiles &&
+	    !is_cur_manual(master)) {
+		for (i = 0; i < num; i++)
+			if (vals[i].ctrl == master)
+				new_auto_val = vals[i].val;
+		if (new_auto_val == master->manual_mode_value)
+			update_from_auto_cluster(master);
+	}
+
+	for (i = 0; i < num; i++)
+		if (vals[i].ctrl->cluster[0] == master)
+			batch_val_to_new(vals[i].ctrl, vals[i].val);
+}
+
+int __v4l2_ctrl_s_ctrls_batch(struct v4l2_ctrl_handler *hdl,
+			      struct v4l2_ctrl_batch_val *vals,
+			      unsigned int num)
+{
+	unsigned int i;
+	int pass;
+	int ret = 0;
+
+	lockdep_assert_held(hdl->lock);
+
+	/* Validate all values first: nothing is applied if one is invalid */
+	for (i = 0; i < num; i++) {
+		struct v4l2_ctrl *ctrl = vals[i].ctrl;
+		union v4l2_ctrl_ptr p;
+		s32 val32;
+
+		/* It's a driver bug if this happens. */
+		if (WARN_ON(ctrl->handler != hdl || ctrl->snap_idx < 0))
+			return -EINVAL;
+		if (ctrl->flags & V4L2_CTRL_FLAG_READ_ONLY)
+			return -EACCES;
+		if (ctrl->flags & V4L2_CTRL_FLAG_GRABBED)
+			return -EBUSY;
+
+		if (ctrl->type == V4L2_CTRL_TYPE_INTEGER64) {
+			p.p_s64 = &vals[i].val;
+		} else {
+			if (vals[i].val < S32_MIN || vals[i].val > S32_MAX)
+				return -ERANGE;
+			val32 = vals[i].val;
+			p.p_s32 = &val32;
+		}
+		ret = validate_new(ctrl, p);
+		if (ret)
+			return ret;
+		if (ctrl->type != V4L2_CTRL_TYPE_INTEGER64)
+			vals[i].val = val32;
+	}
+
+	/*
+	 * Try every touched cluster before setting any of them, so a value
+	 * rejected by try_ctrl leaves all the controls unchanged. Then set
+	 * each cluster once, and publish the snapshot once at the end.
+	 */
+	hdl->snap_batch = true;
+	for (pass = 0; pass < 2 && !ret; pass++) {
+		for (i = 0; i < num; i++)
+			vals[i].ctrl->cluster[0]->done = false;
+
+		for (i = 0; i < num && !ret; i++) {
+			struct v4l2_ctrl *master = vals[i].ctrl->cluster[0];
+
+			if (master->done)
+				continue;
+			master->done = true;
+
+			batch_cluster_to_new(master, vals + i, num - i);
+			ret = try_or_set_cluster(NULL, master, pass > 0, 0);
+		}
+	}
+	hdl->snap_batch = false;
+	publish_snapshot(hdl);
+
+	return ret;
+}
+EXPORT_SYMBOL(__v4l2_ctrl_s_ctrls_batch);
+
 int __v4l2_ctrl_s_ctrl_string(struct v4l2_ctrl *ctrl, const char *s)
 {
 	lockdep_assert_held(ctrl->handler->lock);
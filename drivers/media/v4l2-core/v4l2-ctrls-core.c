@@ -1075,6 +1075,8 @@ void new_to_cur(struct v4l2_fh *fh, struct v4l2_ctrl *ctrl, u32 ch_flags)
 		if (ctrl->is_dyn_array)
 			ctrl->elems = ctrl->new_elems;
 		ptr_to_ptr(ctrl, ctrl->p_new, ctrl->p_cur, ctrl->elems);
+		if (ctrl->snap_idx >= 0)
+			ctrl->handler->snap_dirty = true;
 	}
 
 	if (ch_flags & V4L2_EVENT_CTRL_CH_FLAGS) {
@@ -1100,6 +1102,121 @@ void new_to_cur(struct v4l2_fh *fh, struct v4l2_ctrl *ctrl, u32 ch_flags)
 	}
 }
 
+/*
+ * Publish a new snapshot of the current integer values of the handler's
+ * controls for the lockless readers. If the allocation fails the readers
+ * keep the previous snapshot, which is stale but consistent, and the next
+ * change retries. Must be called with hdl->lock held.
+ */
+static int __publish_snapshot(struct v4l2_ctrl_handler *hdl)
+{
+	struct v4l2_ctrl_snapshot *snap, *old;
+	struct v4l2_ctrl *ctrl;
+
+	snap = kmalloc(struct_size(snap, vals, hdl->nr_of_snap_vals),
+		       GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+
+	snap->nr_of_vals = hdl->nr_of_snap_vals;
+	list_for_each_entry(ctrl, &hdl->ctrls, node) {
+		if (ctrl->snap_idx < 0)
+			continue;
+		if (ctrl->type == V4L2_CTRL_TYPE_INTEGER64)
+			snap->vals[ctrl->snap_idx] = *ctrl->p_cur.p_s64;
+		else
+			snap->vals[ctrl->snap_idx] = ctrl->cur.val;
+	}
+	old = rcu_replace_pointer(hdl->snapshot, snap,
+				  lockdep_is_held(hdl->lock));
+	if (old)
+		kfree_rcu(old, rcu);
+	hdl->snap_dirty = false;
+	return 0;
+}
+
+/* Only the handlers with snapshots enabled pay for the copy */
+void publish_snapshot(struct v4l2_ctrl_handler *hdl)
+{
+	if (hdl->snap_enabled && hdl->snap_dirty && !hdl->snap_batch)
+		__publish_snapshot(hdl);
+}
+
+static s64 snapshot_val(const struct v4l2_ctrl_snapshot *snap,
+			struct v4l2_ctrl *ctrl)
+{
+	/* It's a driver bug if the handler has no snapshot enabled. */
+	if (WARN_ON_ONCE(!snap))
+		return ctrl->default_value;
+	/*
+	 * Added after the last snapshot that could be allocated: the current
+	 * value cannot be read without the lock, as a 64-bit one may tear.
+	 */
+	if (ctrl->snap_idx >= snap->nr_of_vals)
+		return ctrl->default_value;
+	return snap->vals[ctrl->snap_idx];
+}
+
+int v4l2_ctrl_handler_enable_snapshot(struct v4l2_ctrl_handler *hdl)
+{
+	int ret = 0;
+
+	if (READ_ONCE(hdl->snap_enabled))
+		return 0;
+
+	mutex_lock(hdl->lock);
+	if (!hdl->snap_enabled) {
+		ret = __publish_snapshot(hdl);
+		if (!ret)
+			WRITE_ONCE(hdl->snap_enabled, true);
+	}
+	mutex_unlock(hdl->lock);
+	return ret;
+}
+EXPORT_SYMBOL(v4l2_ctrl_handler_enable_snapshot);
+
+s64 v4l2_ctrl_g_ctrl_snapshot(struct v4l2_ctrl *ctrl)
+{
+	s64 val;
+
+	/* It's a driver bug if this happens. */
+	if (WARN_ON(ctrl->snap_idx < 0))
+		return 0;
+
+	rcu_read_lock();
+	val = snapshot_val(rcu_dereference(ctrl->handler->snapshot), ctrl);
+	rcu_read_unlock();
+	return val;
+}
+EXPORT_SYMBOL(v4l2_ctrl_g_ctrl_snapshot);
+
+void v4l2_ctrl_g_ctrls_snapshot(struct v4l2_ctrl * const *ctrls, s64 *vals,
+				unsigned int num)
+{
+	const struct v4l2_ctrl_snapshot *snap = NULL;
+	struct v4l2_ctrl_handler *hdl = NULL;
+	unsigned int i;
+
+	rcu_read_lock();
+	for (i = 0; i < num; i++) {
+		struct v4l2_ctrl *ctrl = ctrls[i];
+
+		/* It's a driver bug if this happens. */
+		if (WARN_ON(ctrl->snap_idx < 0)) {
+			vals[i] = 0;
+			continue;
+		}
+		/* Use a single snapshot per handler for a consistent view */
+		if (ctrl->handler != hdl) {
+			hdl = ctrl->handler;
+			snap = rcu_dereference(hdl->snapshot);
+		}
+		vals[i] = snapshot_val(snap, ctrl);
+	}
+	rcu_read_unlock();
+}
+EXPORT_SYMBOL(v4l2_ctrl_g_ctrls_snapshot);
+
 /* Copy the current value to the new value */
 void cur_to_new(struct v4l2_ctrl *ctrl)
 {
@@ -1291,6 +1408,11 @@ int v4l2_ctrl_handler_init_class(struct v4l2_ctrl_handler *hdl,
 	hdl->buckets = kvcalloc(hdl->nr_of_buckets, sizeof(hdl->buckets[0]),
 				GFP_KERNEL);
 	hdl->error = hdl->buckets ? 0 : -ENOMEM;
+	RCU_INIT_POINTER(hdl->snapshot, NULL);
+	hdl->nr_of_snap_vals = 0;
+	hdl->snap_enabled = false;
+	hdl->snap_dirty = false;
+	hdl->snap_batch = false;
 	v4l2_ctrl_handler_init_request(hdl);
 	return hdl->error;
 }
@@ -1302,6 +1424,7 @@ void v4l2_ctrl_handler_free(struct v4l2_ctrl_handler *hdl)
 	struct v4l2_ctrl_ref *ref, *next_ref;
 	struct v4l2_ctrl *ctrl, *next_ctrl;
 	struct v4l2_subscribed_event *sev, *next_sev;
+	struct v4l2_ctrl_snapshot *snap;
 
 	if (hdl == NULL || hdl->buckets == NULL)
 		return;
@@ -1324,6 +1447,12 @@ void v4l2_ctrl_handler_free(struct v4l2_ctrl_handler *hdl)
 		kvfree(ctrl->p_array);
 		kvfree(ctrl);
 	}
+	snap = rcu_replace_pointer(hdl->snapshot, NULL,
+				   lockdep_is_held(hdl->lock));
+	if (snap)
+		kfree_rcu(snap, rcu);
+	hdl->nr_of_snap_vals = 0;
+	hdl->snap_enabled = false;
 	kvfree(hdl->buckets);
 	hdl->buckets = NULL;
 	hdl->cached = NULL;
@@ -1735,6 +1864,14 @@ static struct v4l2_ctrl *v4l2_ctrl_new(struct v4l2_ctrl_handler *hdl,
 	}
 	mutex_lock(hdl->lock);
 	list_add_tail(&ctrl->node, &hdl->ctrls);
+	/* Only plain integer values are part of the lockless snapshot */
+	ctrl->snap_idx = -1;
+	if (!ctrl->is_ptr && type != V4L2_CTRL_TYPE_BUTTON &&
+	    type != V4L2_CTRL_TYPE_CTRL_CLASS) {
+		ctrl->snap_idx = hdl->nr_of_snap_vals++;
+		hdl->snap_dirty = true;
+		publish_snapshot(hdl);
+	}
 	mutex_unlock(hdl->lock);
 	return ctrl;
 }
@@ -2140,6 +2277,7 @@ int try_or_set_cluster(struct v4l2_fh *fh, struct v4l2_ctrl *master,
 		new_to_cur(fh, master->cluster[i], ch_flags |
 			((update_flag && i > 0) ? V4L2_EVENT_CTRL_CH_FLAGS : 0));
 	}
+	publish_snapshot(master->handler);
 	return 0;
 }
 
@@ -2220,6 +2358,8 @@ int __v4l2_ctrl_handler_setup(struct v4l2_ctrl_handler *hdl)
 			break;
 	}
 
+	/* Publish the initial values for the lockless readers */
+	publish_snapshot(hdl);
 	return ret;
 }
 EXPORT_SYMBOL_GPL(__v4l2_ctrl_handler_setup);
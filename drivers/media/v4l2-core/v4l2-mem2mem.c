@@ -41,6 +41,10 @@ module_param(debug, bool, 0644);
 #define TRANS_RUNNING		(1 << 1)
 /* Instance is currently aborting */
 #define TRANS_ABORT		(1 << 2)
+/* Job of the instance has been prepared by the driver */
+#define TRANS_PREPARED		(1 << 3)
+/* Job of the instance is being prepared by the driver */
+#define TRANS_PREPARING		(1 << 4)
 
 
 /* The job queue is not running new jobs */
@@ -84,11 +88,14 @@ static const char * const m2m_entity_name[] = {
  *			v4l2_m2m_unregister_media_controller().
  * @intf_devnode:	&struct media_intf devnode pointer with the interface
  *			with controls the M2M device.
- * @curr_ctx:		currently running instance
+ * @curr_ctx:		last started instance
  * @job_queue:		instances queued to run
  * @job_spinlock:	protects job_queue
  * @job_work:		worker to run queued jobs.
  * @job_queue_flags:	flags of the queue status, %QUEUE_PAUSED.
+ * @max_jobs:		number of jobs which may run at a time
+ * @num_running:	number of running jobs
+ * @finished:		wait queue for the running jobs to finish
  * @m2m_ops:		driver callbacks
  */
 struct v4l2_m2m_dev {
@@ -107,6 +114,9 @@ struct v4l2_m2m_dev {
 	spinlock_t		job_spinlock;
 	struct work_struct	job_work;
 	unsigned long		job_queue_flags;
+	unsigned int		max_jobs;
+	unsigned int		num_running;
+	wait_queue_head_t	finished;
 
 	const struct v4l2_m2m_ops *m2m_ops;
 };
@@ -243,45 +253,86 @@ void *v4l2_m2m_get_curr_priv(struct v4l2_m2m_dev *m2m_dev)
 }
 EXPORT_SYMBOL(v4l2_m2m_get_curr_priv);
 
+/*
+ * Assumes job_spinlock is held. Returns the first queued instance which is
+ * not running yet, nor being prepared, as device_run() must wait for
+ * device_prepare() to return.
+ */
+static struct v4l2_m2m_ctx *v4l2_m2m_next_job(struct v4l2_m2m_dev *m2m_dev)
+{
+	struct v4l2_m2m_ctx *m2m_ctx;
+
+	list_for_each_entry(m2m_ctx, &m2m_dev->job_queue, queue) {
+		if (!(m2m_ctx->job_flags & (TRANS_RUNNING | TRANS_PREPARING)))
+			return m2m_ctx;
+	}
+
+	return NULL;
+}
+
 /**
- * v4l2_m2m_try_run() - select next job to perform and run it if possible
+ * v4l2_m2m_try_run() - select next jobs to perform and run them if possible
  * @m2m_dev: per-device context
  *
- * Get next transaction (if present) from the waiting jobs list and run it.
+ * Get next transactions (if present) from the waiting jobs list and run them
+ * until all the job slots of the device are busy. Then let the driver
+ * prepare the next waiting job, if it supports it.
  *
  * Note that this function can run on a given v4l2_m2m_ctx context,
  * but call .device_run for another context.
  */
 static void v4l2_m2m_try_run(struct v4l2_m2m_dev *m2m_dev)
 {
+	struct v4l2_m2m_ctx *m2m_ctx;
 	unsigned long flags;
 
-	spin_lock_irqsave(&m2m_dev->job_spinlock, flags);
-	if (NULL != m2m_dev->curr_ctx) {
-		spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
-		dprintk("Another instance is running, won't run now\n");
-		return;
-	}
+	for (;;) {
+		spin_lock_irqsave(&m2m_dev->job_spinlock, flags);
+		if (m2m_dev->job_queue_flags & QUEUE_PAUSED) {
+			spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
+			dprintk("Running new jobs is paused\n");
+			return;
+		}
 
-	if (list_empty(&m2m_dev->job_queue)) {
+		m2m_ctx = v4l2_m2m_next_job(m2m_dev);
+		if (!m2m_ctx) {
+			spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
+			dprintk("No job pending\n");
+			return;
+		}
+
+		if (m2m_dev->num_running >= m2m_dev->max_jobs)
+			break;
+
+		m2m_ctx->job_flags |= TRANS_RUNNING;
+		m2m_dev->num_running++;
+		m2m_dev->curr_ctx = m2m_ctx;
 		spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
-		dprintk("No job pending\n");
-		return;
+
+		dprintk("Running job on m2m_ctx: %p\n", m2m_ctx);
+		m2m_dev->m2m_ops->device_run(m2m_ctx->priv);
 	}
 
-	if (m2m_dev->job_queue_flags & QUEUE_PAUSED) {
+	if (!m2m_dev->m2m_ops->device_prepare ||
+	    (m2m_ctx->job_flags & TRANS_PREPARED)) {
 		spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
-		dprintk("Running new jobs is paused\n");
+		dprintk("Another instance is running, won't run now\n");
 		return;
 	}
 
-	m2m_dev->curr_ctx = list_first_entry(&m2m_dev->job_queue,
-				   struct v4l2_m2m_ctx, queue);
-	m2m_dev->curr_ctx->job_flags |= TRANS_RUNNING;
+	m2m_ctx->job_flags |= TRANS_PREPARED | TRANS_PREPARING;
 	spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
 
-	dprintk("Running job on m2m_ctx: %p\n", m2m_dev->curr_ctx);
-	m2m_dev->m2m_ops->device_run(m2m_dev->curr_ctx->priv);
+	dprintk("Preparing job on m2m_ctx: %p\n", m2m_ctx);
+	m2m_dev->m2m_ops->device_prepare(m2m_ctx->priv);
+
+	spin_lock_irqsave(&m2m_dev->job_spinlock, flags);
+	m2m_ctx->job_flags &= ~TRANS_PREPARING;
+	wake_up(&m2m_ctx->finished);
+	/* a job slot freed meanwhile was not given to the prepared job */
+	if (m2m_dev->num_running < m2m_dev->max_jobs)
+		schedule_work(&m2m_dev->job_work);
+	spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
 }
 
 /*
@@ -422,6 +473,14 @@ static void v4l2_m2m_cancel_job(struct v4l2_m2m_ctx *m2m_ctx)
 	spin_lock_irqsave(&m2m_dev->job_spinlock, flags);
 
 	m2m_ctx->job_flags |= TRANS_ABORT;
+	if (m2m_ctx->job_flags & TRANS_PREPARING) {
+		spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
+		dprintk("m2m_ctx %p being prepared, will wait to complete\n",
+			m2m_ctx);
+		wait_event(m2m_ctx->finished,
+			   !(m2m_ctx->job_flags & TRANS_PREPARING));
+		spin_lock_irqsave(&m2m_dev->job_spinlock, flags);
+	}
 	if (m2m_ctx->job_flags & TRANS_RUNNING) {
 		spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
 		if (m2m_dev->m2m_ops->job_abort)
@@ -431,7 +490,8 @@ static void v4l2_m2m_cancel_job(struct v4l2_m2m_ctx *m2m_ctx)
 				!(m2m_ctx->job_flags & TRANS_RUNNING));
 	} else if (m2m_ctx->job_flags & TRANS_QUEUED) {
 		list_del(&m2m_ctx->queue);
-		m2m_ctx->job_flags &= ~(TRANS_QUEUED | TRANS_RUNNING);
+		m2m_ctx->job_flags &= ~(TRANS_QUEUED | TRANS_RUNNING |
+					TRANS_PREPARED);
 		spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
 		dprintk("m2m_ctx: %p had been on queue and was removed\n",
 			m2m_ctx);
@@ -469,15 +529,18 @@ static void v4l2_m2m_schedule_next_job(struct v4l2_m2m_dev *m2m_dev,
 static bool _v4l2_m2m_job_finish(struct v4l2_m2m_dev *m2m_dev,
 				 struct v4l2_m2m_ctx *m2m_ctx)
 {
-	if (!m2m_dev->curr_ctx || m2m_dev->curr_ctx != m2m_ctx) {
+	if (!(m2m_ctx->job_flags & TRANS_RUNNING)) {
 		dprintk("Called by an instance not currently running\n");
 		return false;
 	}
 
-	list_del(&m2m_dev->curr_ctx->queue);
-	m2m_dev->curr_ctx->job_flags &= ~(TRANS_QUEUED | TRANS_RUNNING);
-	wake_up(&m2m_dev->curr_ctx->finished);
-	m2m_dev->curr_ctx = NULL;
+	list_del(&m2m_ctx->queue);
+	m2m_ctx->job_flags &= ~(TRANS_QUEUED | TRANS_RUNNING | TRANS_PREPARED);
+	m2m_dev->num_running--;
+	wake_up(&m2m_ctx->finished);
+	wake_up(&m2m_dev->finished);
+	if (m2m_dev->curr_ctx == m2m_ctx)
+		m2m_dev->curr_ctx = NULL;
 	return true;
 }
 
@@ -544,16 +607,12 @@ EXPORT_SYMBOL(v4l2_m2m_buf_done_and_job_finish);
 void v4l2_m2m_suspend(struct v4l2_m2m_dev *m2m_dev)
 {
 	unsigned long flags;
-	struct v4l2_m2m_ctx *curr_ctx;
 
 	spin_lock_irqsave(&m2m_dev->job_spinlock, flags);
 	m2m_dev->job_queue_flags |= QUEUE_PAUSED;
-	curr_ctx = m2m_dev->curr_ctx;
 	spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
 
-	if (curr_ctx)
-		wait_event(curr_ctx->finished,
-			   !(curr_ctx->job_flags & TRANS_RUNNING));
+	wait_event(m2m_dev->finished, !READ_ONCE(m2m_dev->num_running));
 }
 EXPORT_SYMBOL(v4l2_m2m_suspend);
 
@@ -887,6 +946,10 @@ int v4l2_m2m_streamoff(struct file *file, struct v4l2_m2m_ctx *m2m_ctx,
 	/* We should not be scheduled anymore, since we're dropping a queue. */
 	if (m2m_ctx->job_flags & TRANS_QUEUED)
 		list_del(&m2m_ctx->queue);
+	if (m2m_ctx->job_flags & TRANS_RUNNING) {
+		m2m_dev->num_running--;
+		wake_up(&m2m_dev->finished);
+	}
 	m2m_ctx->job_flags = 0;
 
 	spin_lock_irqsave(&q_ctx->rdy_spinlock, flags);
@@ -1198,14 +1261,29 @@ struct v4l2_m2m_dev *v4l2_m2m_init(const struct v4l2_m2m_ops *m2m_ops)
 
 	m2m_dev->curr_ctx = NULL;
 	m2m_dev->m2m_ops = m2m_ops;
+	m2m_dev->max_jobs = 1;
 	INIT_LIST_HEAD(&m2m_dev->job_queue);
 	spin_lock_init(&m2m_dev->job_spinlock);
+	init_waitqueue_head(&m2m_dev->finished);
 	INIT_WORK(&m2m_dev->job_work, v4l2_m2m_device_run_work);
 
 	return m2m_dev;
 }
 EXPORT_SYMBOL_GPL(v4l2_m2m_init);
 
+void v4l2_m2m_set_max_jobs(struct v4l2_m2m_dev *m2m_dev, unsigned int max_jobs)
+{
+	unsigned long flags;
+
+	if (WARN_ON(!max_jobs))
+		max_jobs = 1;
+
+	spin_lock_irqsave(&m2m_dev->job_spinlock, flags);
+	m2m_dev->max_jobs = max_jobs;
+	spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
+}
+EXPORT_SYMBOL_GPL(v4l2_m2m_set_max_jobs);
+
 void v4l2_m2m_release(struct v4l2_m2m_dev *m2m_dev)
 {
 	kfree(m2m_dev);
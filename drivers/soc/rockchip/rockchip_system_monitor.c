@@ -11,6 +11,7 @@
 #include <linux/device.h>
 #include <linux/ebc.h>
 #include <linux/fb.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/notifier.h>
@@ -80,6 +81,15 @@ struct system_monitor {
 	int temp_hysteresis;
 	unsigned int delay;
 	bool is_temp_offline;
+
+	/* no device needs adjustment while the temperature is inside */
+	int temp_win_low;
+	int temp_win_high;
+	/* the last sample, for the rate of temperature change */
+	int prev_temp;
+	unsigned long prev_jiffies;
+	unsigned int min_delay;
+	unsigned int max_delay;
 };
 
 static unsigned long system_status;
@@ -1088,6 +1098,16 @@ static void rockchip_high_temp_adjust(struct monitor_dev_info *info,
 	}
 }
 
+static void rockchip_system_monitor_reset_temp_window(void)
+{
+	if (!system_monitor)
+		return;
+
+	/* an empty window makes the next check walk all the devices */
+	WRITE_ONCE(system_monitor->temp_win_low, INT_MAX);
+	WRITE_ONCE(system_monitor->temp_win_high, INT_MIN);
+}
+
 int rockchip_monitor_suspend_low_temp_adjust(int cpu)
 {
 	struct monitor_dev_info *info = NULL, *tmp;
@@ -1112,6 +1132,7 @@ int rockchip_monitor_suspend_low_temp_adjust(int cpu)
 	}
 	if (!info->is_low_temp)
 		rockchip_low_temp_adjust(info, true);
+	rockchip_system_monitor_reset_temp_window();
 
 	return 0;
 }
@@ -1391,6 +1412,7 @@ rockchip_system_monitor_register(struct device *dev,
 
 	down_write(&mdev_list_sem);
 	list_add(&info->node, &monitor_dev_list);
+	rockchip_system_monitor_reset_temp_window();
 	up_write(&mdev_list_sem);
 
 	return info;
@@ -1452,6 +1474,23 @@ static int rockchip_system_monitor_temp_notify(int temp)
 
 static int notify_dummy(struct thermal_zone_device *tz, int trip)
 {
+	int temp;
+
+	if (!system_monitor || tz != system_monitor->tz ||
+	    atomic_read(&monitor_in_suspend))
+		return 0;
+
+	/*
+	 * The zone is updated on every poll of the thermal core, only check
+	 * it at once when the temperature leaves the window where nothing
+	 * changes, the regular poll handles the rest.
+	 */
+	temp = READ_ONCE(tz->temperature);
+	if (temp <= READ_ONCE(system_monitor->temp_win_low) ||
+	    temp >= READ_ONCE(system_monitor->temp_win_high))
+		mod_delayed_work(system_freezable_wq,
+				 &system_monitor->thermal_work, 0);
+
 	return 0;
 }
 
@@ -1485,6 +1524,8 @@ static int rockchip_system_monitor_parse_dt(struct system_monitor *monitor)
 	if (of_property_read_u32(np, "rockchip,polling-delay",
 				 &monitor->delay))
 		monitor->delay = THERMAL_POLLING_DELAY;
+	monitor->min_delay = max(monitor->delay / 4, 1U);
+	monitor->max_delay = monitor->delay * 4;
 
 	if (of_property_read_string(np, "rockchip,temp-offline-cpus",
 				    &buf))
@@ -1567,10 +1608,87 @@ static void rockchip_system_monitor_temp_cpu_on_off(int temp)
 	rockchip_system_monitor_cpu_on_off();
 }
 
+/*
+ * Narrow [low, high] to the temperatures where the state of the device
+ * flips next, it is conservative at the bounds.
+ */
+static void
+rockchip_system_monitor_temp_window(struct monitor_dev_info *info, int temp,
+				    int *low, int *high)
+{
+	int i, t;
+
+	if (info->is_low_temp)
+		*high = min(*high, info->low_temp + info->temp_hysteresis);
+	else
+		*low = max(*low, info->low_temp);
+
+	if (info->high_limit_table) {
+		for (i = 0; info->high_limit_table[i].freq != UINT_MAX; i++) {
+			t = info->high_limit_table[i].temp;
+			if (t < temp)
+				*low = max(*low, t);
+			else
+				*high = min(*high, t);
+		}
+	} else if (info->is_high_temp) {
+		*low = max(*low, info->high_temp - info->temp_hysteresis);
+	} else {
+		*high = min(*high, info->high_temp);
+	}
+}
+
+/* the cpus taken offline by temperature flip at the same bounds */
+static void rockchip_system_monitor_offline_temp_window(int *low, int *high)
+{
+	if (cpumask_empty(&system_monitor->temp_offline_cpus))
+		return;
+
+	if (system_monitor->is_temp_offline)
+		*low = max(*low, system_monitor->offline_cpus_temp -
+			   system_monitor->temp_hysteresis);
+	else
+		*high = min(*high, system_monitor->offline_cpus_temp);
+}
+
+/*
+ * Poll slower while the temperature is steady and far from the window
+ * bounds, and sooner when it moves quickly towards them.
+ */
+static unsigned int rockchip_system_monitor_next_delay(int temp)
+{
+	struct system_monitor *monitor = system_monitor;
+	unsigned long elapsed_ms;
+	s64 margin, delta, reach_ms;
+
+	elapsed_ms = jiffies_to_msecs(jiffies - monitor->prev_jiffies);
+	delta = abs(temp - monitor->prev_temp);
+	if (monitor->prev_temp == THERMAL_TEMP_INVALID)
+		delta = -1;
+	monitor->prev_temp = temp;
+	monitor->prev_jiffies = jiffies;
+
+	if (temp <= monitor->temp_win_low || temp >= monitor->temp_win_high)
+		return monitor->delay;
+	if (delta < 0)
+		return monitor->delay;
+	if (!delta || !elapsed_ms)
+		return monitor->max_delay;
+
+	margin = min((s64)temp - monitor->temp_win_low,
+		     (s64)monitor->temp_win_high - temp);
+	/* half of the time to reach the nearest bound at the current rate */
+	reach_ms = div64_s64(margin * elapsed_ms, delta) / 2;
+
+	return clamp_t(s64, reach_ms, monitor->min_delay, monitor->max_delay);
+}
+
 static void rockchip_system_monitor_thermal_update(void)
 {
 	int temp, ret;
 	struct monitor_dev_info *info;
+	unsigned int delay = system_monitor->delay;
+	int low = INT_MIN, high = INT_MAX;
 
 	ret = thermal_zone_get_temp(system_monitor->tz, &temp);
 	if (ret || temp == THERMAL_TEMP_INVALID)
@@ -1580,21 +1698,35 @@ static void rockchip_system_monitor_thermal_update(void)
 
 	if (temp < system_monitor->last_temp &&
 	    system_monitor->last_temp - temp <= 2000)
-		goto out;
+		goto next;
 	system_monitor->last_temp = temp;
 
 	rockchip_system_monitor_temp_notify(temp);
 
-	down_read(&mdev_list_sem);
-	list_for_each_entry(info, &monitor_dev_list, node)
-		rockchip_system_monitor_wide_temp_adjust(info, temp);
-	up_read(&mdev_list_sem);
-
-	rockchip_system_monitor_temp_cpu_on_off(temp);
+	/* all the device adjustments of one event are done in one pass */
+	if (temp <= system_monitor->temp_win_low ||
+	    temp >= system_monitor->temp_win_high) {
+		rockchip_system_monitor_temp_cpu_on_off(temp);
+		rockchip_system_monitor_offline_temp_window(&low, &high);
+
+		down_read(&mdev_list_sem);
+		list_for_each_entry(info, &monitor_dev_list, node) {
+			rockchip_system_monitor_wide_temp_adjust(info, temp);
+			rockchip_system_monitor_temp_window(info, temp,
+							    &low, &high);
+		}
+		WRITE_ONCE(system_monitor->temp_win_low, low);
+		WRITE_ONCE(system_monitor->temp_win_high, high);
+		up_read(&mdev_list_sem);
+		dev_dbg(system_monitor->dev, "temperature window (%d, %d)\n",
+			low, high);
+	}
 
+next:
+	delay = rockchip_system_monitor_next_delay(temp);
 out:
 	mod_delayed_work(system_freezable_wq, &system_monitor->thermal_work,
-			 msecs_to_jiffies(system_monitor->delay));
+			 msecs_to_jiffies(delay));
 }
 
 static void rockchip_system_monitor_thermal_check(struct work_struct *work)
@@ -1722,6 +1854,7 @@ static int monitor_pm_notify(struct notifier_block *nb,
 		atomic_set(&monitor_in_suspend, 0);
 		rockchip_system_monitor_set_cpu_uevent_suppress(false);
 		system_monitor->last_temp = INT_MAX;
+		rockchip_system_monitor_reset_temp_window();
 		break;
 	default:
 		break;
@@ -1848,11 +1981,15 @@ static int rockchip_system_monitor_probe(struct platform_device *pdev)
 	cpumask_clear(&system_monitor->status_offline_cpus);
 	cpumask_clear(&system_monitor->offline_cpus);
 
+	/* the dummy governor may kick the work once it is set in parse dt */
+	INIT_DELAYED_WORK(&system_monitor->thermal_work,
+			  rockchip_system_monitor_thermal_check);
+	rockchip_system_monitor_reset_temp_window();
+	system_monitor->prev_temp = THERMAL_TEMP_INVALID;
+
 	rockchip_system_monitor_parse_dt(system_monitor);
 	if (system_monitor->tz) {
 		system_monitor->last_temp = INT_MAX;
-		INIT_DELAYED_WORK(&system_monitor->thermal_work,
-				  rockchip_system_monitor_thermal_check);
 		mod_delayed_work(system_freezable_wq,
 				 &system_monitor->thermal_work,
 				 msecs_to_jiffies(system_monitor->delay));
@@ -23,6 +23,7 @@
 #include <linux/module.h>
 #include <linux/scatterlist.h>
 #include <linux/sched/signal.h>
+#include <linux/sizes.h>
 #include <linux/uio.h>
 #include <linux/vmalloc.h>
 #include <asm/unaligned.h>
@@ -197,6 +198,8 @@ struct ffs_epfile {
 	unsigned char			isoc;	/* P: ffs->eps_lock */
 
 	unsigned char			_pad;
+
+	atomic_t			pools;	/* mmap()ed buffer pools */
 };
 
 struct ffs_buffer {
@@ -205,6 +208,24 @@ struct ffs_buffer {
 	char storage[];
 };
 
+/*
+ * Buffer pool mapped into user space by mmap() on an endpoint file.
+ *
+ * Transfers whose user buffer lies entirely within the mapping are queued
+ * straight from the pool pages, without the bounce buffer and the copy.  The
+ * pool is freed once it is unmapped and no request uses it any more.
+ */
+struct ffs_pool {
+	struct kref ref;
+	struct ffs_epfile *epfile;
+	void *vaddr;
+	unsigned int n_pages;
+	struct page **pages;
+};
+
+#define FFS_POOL_MAX_SIZE	SZ_64M
+#define FFS_POOL_MAX_PER_EP	8
+
 /*  ffs_io_data structure ***************************************************/
 
 struct ffs_io_data {
@@ -217,13 +238,16 @@ struct ffs_io_data {
 	char *buf;
 
 	struct mm_struct *mm;
-	struct work_struct work;
+	struct llist_node node;
 
 	struct usb_ep *ep;
 	struct usb_request *req;
 	struct sg_table sgt;
 	bool use_sg;
 
+	/* Set if buf points into an mmap()ed buffer pool, see ffs_pool */
+	struct ffs_pool *pool;
+
 	struct ffs_data *ffs;
 
 	int status;
@@ -813,8 +837,30 @@ static inline void *ffs_alloc_buffer(struct ffs_io_data *io_data,
 	return kmalloc(ALIGN(data_len, cache_line_size()), GFP_KERNEL);
 }
 
+static void ffs_pool_release(struct kref *ref)
+{
+	struct ffs_pool *pool = container_of(ref, struct ffs_pool, ref);
+
+	atomic_dec(&pool->epfile->pools);
+	kvfree(pool->pages);
+	vfree(pool->vaddr);
+	kfree(pool);
+}
+
+static void ffs_pool_put(struct ffs_pool *pool)
+{
+	kref_put(&pool->ref, ffs_pool_release);
+}
+
 static inline void ffs_free_buffer(struct ffs_io_data *io_data)
 {
+	if (io_data->pool) {
+		sg_free_table(&io_data->sgt);
+		ffs_pool_put(io_data->pool);
+		io_data->pool = NULL;
+		return;
+	}
+
 	if (!io_data->buf)
 		return;
 
@@ -826,31 +872,129 @@ static inline void ffs_free_buffer(struct ffs_io_data *io_data)
 	}
 }
 
-static void ffs_user_copy_worker(struct work_struct *work)
+static void ffs_pool_vm_open(struct vm_area_struct *vma)
 {
-	struct ffs_io_data *io_data = container_of(work, struct ffs_io_data,
-						   work);
-	int ret = io_data->req->status ? io_data->req->status :
-					 io_data->req->actual;
-	bool kiocb_has_eventfd = io_data->kiocb->ki_flags & IOCB_EVENTFD;
+	struct ffs_pool *pool = vma->vm_private_data;
 
-	if (io_data->read && ret > 0) {
-		kthread_use_mm(io_data->mm);
-		ret = ffs_copy_to_iter(io_data->buf, ret, &io_data->data);
-		kthread_unuse_mm(io_data->mm);
+	kref_get(&pool->ref);
+}
+
+static void ffs_pool_vm_close(struct vm_area_struct *vma)
+{
+	ffs_pool_put(vma->vm_private_data);
+}
+
+static const struct vm_operations_struct ffs_pool_vm_ops = {
+	.open =		ffs_pool_vm_open,
+	.close =	ffs_pool_vm_close,
+};
+
+/*
+ * If the user buffer of @io_data is a single range inside a pool mapped from
+ * @file, point a scatterlist at the pool pages backing it and take a pool
+ * reference for the request.  Returns the kernel address of the range, or
+ * NULL if the transfer has to go through a bounce buffer.
+ */
+static void *ffs_epfile_pool_map(struct file *file,
+				 struct ffs_io_data *io_data, size_t data_len)
+{
+	struct iov_iter *iter = &io_data->data;
+	struct mm_struct *mm = current->mm;
+	struct vm_area_struct *vma;
+	struct ffs_pool *pool = NULL;
+	unsigned long addr, offset;
+	unsigned int first, n_pages;
+
+	if (!mm || !data_len || iov_iter_count(iter) != data_len ||
+	    iov_iter_single_seg_count(iter) != data_len)
+		return NULL;
+
+	if (iter_is_ubuf(iter))
+		addr = (unsigned long)iter->ubuf + iter->iov_offset;
+	else if (iter_is_iovec(iter))
+		addr = (unsigned long)iter->iov->iov_base + iter->iov_offset;
+	else
+		return NULL;
+
+	mmap_read_lock(mm);
+	vma = vma_lookup(mm, addr);
+	if (vma && vma->vm_ops == &ffs_pool_vm_ops &&
+	    vma->vm_file->private_data == file->private_data &&
+	    data_len <= vma->vm_end - addr) {
+		pool = vma->vm_private_data;
+		offset = addr - vma->vm_start + (vma->vm_pgoff << PAGE_SHIFT);
+		kref_get(&pool->ref);
 	}
+	mmap_read_unlock(mm);
 
-	io_data->kiocb->ki_complete(io_data->kiocb, ret);
+	if (!pool)
+		return NULL;
 
-	if (io_data->ffs->ffs_eventfd && !kiocb_has_eventfd)
-		eventfd_signal(io_data->ffs->ffs_eventfd, 1);
+	first = offset >> PAGE_SHIFT;
+	n_pages = PAGE_ALIGN(offset + data_len) / PAGE_SIZE - first;
+	if (sg_alloc_table_from_pages(&io_data->sgt, pool->pages + first,
+				      n_pages, offset_in_page(offset),
+				      data_len, GFP_KERNEL)) {
+		ffs_pool_put(pool);
+		return NULL;
+	}
 
-	usb_ep_free_request(io_data->ep, io_data->req);
+	/* Consume the buffer like copy_from_iter_full() would */
+	if (!io_data->read)
+		iov_iter_advance(iter, data_len);
 
-	if (io_data->read)
-		kfree(io_data->to_free);
-	ffs_free_buffer(io_data);
-	kfree(io_data);
+	io_data->pool = pool;
+	return pool->vaddr + offset;
+}
+
+static void ffs_user_copy_worker(struct work_struct *work)
+{
+	struct ffs_data *ffs = container_of(work, struct ffs_data,
+					    io_completion_work);
+	struct ffs_io_data *io_data, *next;
+	struct llist_node *done;
+	struct mm_struct *mm = NULL;
+	unsigned int events = 0;
+
+	done = llist_reverse_order(llist_del_all(&ffs->io_completions));
+
+	/*
+	 * Reap everything the UDC completed since the last run and signal
+	 * the eventfd once for the whole batch.
+	 */
+	llist_for_each_entry_safe(io_data, next, done, node) {
+		int ret = io_data->req->status ? io_data->req->status :
+						 io_data->req->actual;
+		bool kiocb_has_eventfd = io_data->kiocb->ki_flags & IOCB_EVENTFD;
+
+		if (io_data->read && ret > 0 && !io_data->pool) {
+			if (mm != io_data->mm) {
+				if (mm)
+					kthread_unuse_mm(mm);
+				mm = io_data->mm;
+				kthread_use_mm(mm);
+			}
+			ret = ffs_copy_to_iter(io_data->buf, ret, &io_data->data);
+		}
+
+		io_data->kiocb->ki_complete(io_data->kiocb, ret);
+
+		if (!kiocb_has_eventfd)
+			events++;
+
+		usb_ep_free_request(io_data->ep, io_data->req);
+
+		if (io_data->read)
+			kfree(io_data->to_free);
+		ffs_free_buffer(io_data);
+		kfree(io_data);
+	}
+
+	if (mm)
+		kthread_unuse_mm(mm);
+
+	if (ffs->ffs_eventfd && events)
+		eventfd_signal(ffs->ffs_eventfd, events);
 }
 
 static void ffs_epfile_async_io_complete(struct usb_ep *_ep,
@@ -861,8 +1005,8 @@ static void ffs_epfile_async_io_complete(struct usb_ep *_ep,
 
 	ENTER();
 
-	INIT_WORK(&io_data->work, ffs_user_copy_worker);
-	queue_work(ffs->io_completion_wq, &io_data->work);
+	if (llist_add(&io_data->node, &ffs->io_completions))
+		queue_work(ffs->io_completion_wq, &ffs->io_completion_work);
 }
 
 static void __ffs_epfile_read_buffer_free(struct ffs_epfile *epfile)
@@ -1023,15 +1167,23 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 		io_data->use_sg = gadget->sg_supported && data_len > PAGE_SIZE;
 		spin_unlock_irq(&epfile->ffs->eps_lock);
 
-		data = ffs_alloc_buffer(io_data, data_len);
-		if (!data) {
-			ret = -ENOMEM;
-			goto error_mutex;
+		/* Pool pages are not contiguous, so they need an sg capable UDC */
+		if (gadget->sg_supported) {
+			data = ffs_epfile_pool_map(file, io_data, data_len);
+			if (data)
+				io_data->use_sg = true;
 		}
-		if (!io_data->read &&
-		    !copy_from_iter_full(data, data_len, &io_data->data)) {
-			ret = -EFAULT;
-			goto error_mutex;
+		if (!data) {
+			data = ffs_alloc_buffer(io_data, data_len);
+			if (!data) {
+				ret = -ENOMEM;
+				goto error_mutex;
+			}
+			if (!io_data->read &&
+			    !copy_from_iter_full(data, data_len, &io_data->data)) {
+				ret = -EFAULT;
+				goto error_mutex;
+			}
 		}
 	}
 
@@ -1102,13 +1254,19 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 			interrupted = io_data->status < 0;
 		}
 
-		if (interrupted)
+		if (interrupted) {
 			ret = -EINTR;
-		else if (io_data->read && io_data->status > 0)
+		} else if (io_data->read && io_data->status > 0 &&
+			   io_data->pool) {
+			/* The data is already in the user's pool mapping */
+			ret = io_data->status;
+			iov_iter_advance(&io_data->data, ret);
+		} else if (io_data->read && io_data->status > 0) {
 			ret = __ffs_epfile_read_data(epfile, data, io_data->status,
 						     &io_data->data);
-		else
+		} else {
 			ret = io_data->status;
+		}
 		goto error_mutex;
 	} else if (!(req = usb_ep_alloc_request(ep->ep, GFP_ATOMIC))) {
 		ret = -ENOMEM;
@@ -1292,6 +1450,61 @@ ffs_epfile_release(struct inode *inode, struct file *file)
 	return 0;
 }
 
+static int ffs_epfile_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct ffs_epfile *epfile = file->private_data;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	struct ffs_pool *pool;
+	unsigned int i;
+	int ret;
+
+	ENTER();
+
+	if (!(vma->vm_flags & VM_SHARED) || vma->vm_pgoff)
+		return -EINVAL;
+	if (size > FFS_POOL_MAX_SIZE)
+		return -ENOMEM;
+
+	if (atomic_inc_return(&epfile->pools) > FFS_POOL_MAX_PER_EP) {
+		atomic_dec(&epfile->pools);
+		return -ENOMEM;
+	}
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL_ACCOUNT);
+	if (!pool) {
+		atomic_dec(&epfile->pools);
+		return -ENOMEM;
+	}
+	kref_init(&pool->ref);
+	pool->epfile = epfile;
+	pool->n_pages = size >> PAGE_SHIFT;
+
+	/* charged to the memcg of the mapping task */
+	pool->vaddr = __vmalloc(size, GFP_KERNEL_ACCOUNT | __GFP_ZERO);
+	pool->pages = kvmalloc_array(pool->n_pages, sizeof(*pool->pages),
+				     GFP_KERNEL_ACCOUNT);
+	if (!pool->vaddr || !pool->pages) {
+		ret = -ENOMEM;
+		goto error;
+	}
+	for (i = 0; i < pool->n_pages; i++)
+		pool->pages[i] = vmalloc_to_page(pool->vaddr + i * PAGE_SIZE);
+
+	ret = vm_map_pages_zero(vma, pool->pages, pool->n_pages);
+	if (ret)
+		goto error;
+
+	vma->vm_flags |= VM_DONTCOPY | VM_DONTEXPAND;
+	vma->vm_private_data = pool;
+	vma->vm_ops = &ffs_pool_vm_ops;
+
+	return 0;
+
+error:
+	ffs_pool_put(pool);
+	return ret;
+}
+
 static long ffs_epfile_ioctl(struct file *file, unsigned code,
 			     unsigned long value)
 {
@@ -1379,6 +1592,7 @@ static const struct file_operations ffs_epfile_operations = {
 	.write_iter =	ffs_epfile_write_iter,
 	.read_iter =	ffs_epfile_read_iter,
 	.release =	ffs_epfile_release,
+	.mmap =		ffs_epfile_mmap,
 	.unlocked_ioctl =	ffs_epfile_ioctl,
 	.compat_ioctl = compat_ptr_ioctl,
 };
@@ -1781,6 +1995,8 @@ static struct ffs_data *ffs_data_new(const char *dev_name)
 	init_waitqueue_head(&ffs->ev.waitq);
 	init_waitqueue_head(&ffs->wait);
 	init_completion(&ffs->ep0req_completion);
+	init_llist_head(&ffs->io_completions);
+	INIT_WORK(&ffs->io_completion_work, ffs_user_copy_worker);
 
 	/* XXX REVISIT need to update it in some places, or do we? */
 	ffs->ev.can_stall = 1;
@@ -173,6 +173,7 @@
 #include <linux/dcache.h>
 #include <linux/delay.h>
 #include <linux/device.h>
+#include <linux/fadvise.h>
 #include <linux/fcntl.h>
 #include <linux/file.h>
 #include <linux/fs.h>
@@ -586,6 +587,43 @@ static int sleep_thread(struct fsg_common *common, bool can_freeze,
 
 /*-------------------------------------------------------------------------*/
 
+/*
+ * Hosts copying a large file issue back-to-back READs, each starting where
+ * the previous one ended.  The file's own readahead only sees the FSG_BUFLEN
+ * chunks of the current command, so once a stream is detected prefetch well
+ * beyond it, doubling the window while the stream goes on.  The next READ
+ * then finds its data in the page cache instead of waiting on the medium.
+ */
+static void fsg_lun_readahead(struct fsg_lun *curlun, loff_t offset, u32 len)
+{
+	loff_t	end = min(offset + len, curlun->file_length);
+	loff_t	start, stop;
+
+	if (offset != curlun->ra_next) {
+		/* Random access, start over */
+		curlun->ra_next = end;
+		curlun->ra_end = end;
+		curlun->ra_window = 0;
+		return;
+	}
+	curlun->ra_next = end;
+
+	if (curlun->ra_window)
+		curlun->ra_window = min(curlun->ra_window * 2, FSG_RA_MAX);
+	else
+		curlun->ra_window = clamp(len, FSG_RA_MIN, FSG_RA_MAX);
+
+	start = max(end, curlun->ra_end);
+	stop = min(end + curlun->ra_window, curlun->file_length);
+	if (stop <= start)
+		return;
+
+	VLDBG(curlun, "readahead %llu @ %llu\n",
+	      (unsigned long long)(stop - start), (unsigned long long)start);
+	vfs_fadvise(curlun->filp, start, stop - start, POSIX_FADV_WILLNEED);
+	curlun->ra_end = stop;
+}
+
 static int do_read(struct fsg_common *common)
 {
 	struct fsg_lun		*curlun = common->curlun;
@@ -630,6 +668,8 @@ static int do_read(struct fsg_common *common)
 	if (unlikely(amount_left == 0))
 		return -EIO;		/* No default reply */
 
+	fsg_lun_readahead(curlun, file_offset, amount_left);
+
 	for (;;) {
 		/*
 		 * Figure out how much we need to read:
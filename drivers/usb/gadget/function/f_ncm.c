@@ -73,6 +73,8 @@ struct f_ncm {
 	struct sk_buff			*skb_tx_ndp;
 	u16				ndp_dgram_count;
 	struct hrtimer			task_timer;
+	/* Current NTB aggregation delay, see ncm_tx_adapt() */
+	u32				tx_timeout_ns;
 };
 
 static inline struct f_ncm *func_to_ncm(struct usb_function *f)
@@ -115,8 +117,16 @@ static inline unsigned ncm_bitrate(struct usb_gadget *g)
  */
 #define TX_MAX_NUM_DPE		32
 
-/* Delay for the transmit to wait before sending an unfilled NTB frame. */
+/*
+ * Delay for the transmit to wait before sending an unfilled NTB frame.
+ * It adapts between the MIN and MAX values to the traffic: it grows while
+ * NTBs fill up before it expires, and shrinks when it expires with only a
+ * single datagram to send.
+ */
 #define TX_TIMEOUT_NSECS	300000
+#define TX_TIMEOUT_MIN_NSECS	50000
+#define TX_TIMEOUT_MAX_NSECS	1000000
+#define TX_TIMEOUT_STEP_NSECS	50000
 
 #define FORMATS_SUPPORTED	(USB_CDC_NCM_NTB16_SUPPORTED |	\
 				 USB_CDC_NCM_NTB32_SUPPORTED)
@@ -1006,6 +1016,24 @@ static struct sk_buff *package_for_tx(struct f_ncm *ncm)
 	return skb2;
 }
 
+/*
+ * A full NTB means the link is busy enough to aggregate, so allow more
+ * datagrams to gather in the next one.  A timer flush of a lone datagram
+ * means nothing else came along, and the delay was pure latency.
+ */
+static void ncm_tx_adapt(struct f_ncm *ncm, bool full)
+{
+	u32 timeout = ncm->tx_timeout_ns;
+
+	if (full)
+		timeout = min_t(u32, timeout + TX_TIMEOUT_STEP_NSECS,
+				TX_TIMEOUT_MAX_NSECS);
+	else if (ncm->ndp_dgram_count <= 2)	/* zero entry + one datagram */
+		timeout = max_t(u32, timeout / 2, TX_TIMEOUT_MIN_NSECS);
+
+	ncm->tx_timeout_ns = timeout;
+}
+
 static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 				    struct sk_buff *skb)
 {
@@ -1048,6 +1076,7 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		    div + rem + skb->len +
 		    ncm->skb_tx_ndp->len + ndp_align + (2 * dgram_idx_len))
 		    > max_size)) {
+			ncm_tx_adapt(ncm, true);
 			skb2 = package_for_tx(ncm);
 			if (!skb2)
 				goto err;
@@ -1095,7 +1124,7 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 			/* Note: we skip opts->next_ndp_index */
 
 			/* Start the timer. */
-			hrtimer_start(&ncm->task_timer, TX_TIMEOUT_NSECS,
+			hrtimer_start(&ncm->task_timer, ncm->tx_timeout_ns,
 				      HRTIMER_MODE_REL_SOFT);
 		}
 
@@ -1123,6 +1152,7 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		 * because eth_start_xmit() was called with NULL skb by
 		 * ncm_tx_timeout() - hence, this is our signal to flush/send.
 		 */
+		ncm_tx_adapt(ncm, false);
 		skb2 = package_for_tx(ncm);
 		if (!skb2)
 			goto err;
@@ -1550,6 +1580,7 @@ static int ncm_bind(struct usb_configuration *c, struct usb_function *f)
 
 	hrtimer_init(&ncm->task_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_SOFT);
 	ncm->task_timer.function = ncm_tx_timeout;
+	ncm->tx_timeout_ns = TX_TIMEOUT_NSECS;
 
 	DBG(cdev, "CDC Network: %s speed IN/%s OUT/%s NOTIFY/%s\n",
 			gadget_is_superspeed(c->cdev->gadget) ? "super" :
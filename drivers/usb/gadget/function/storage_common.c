@@ -265,6 +265,9 @@ int fsg_lun_open(struct fsg_lun *curlun, const char *filename)
 	curlun->filp = filp;
 	curlun->file_length = size;
 	curlun->num_sectors = num_sectors;
+	curlun->ra_next = 0;
+	curlun->ra_end = 0;
+	curlun->ra_window = 0;
 	LDBG(curlun, "open backing file: %s\n", filename);
 	return 0;
 
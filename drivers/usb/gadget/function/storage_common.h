@@ -116,6 +116,12 @@ struct fsg_lun {
 	unsigned int	blkbits; /* Bits of logical block size
 						       of bound block device */
 	unsigned int	blksize; /* logical block size of bound block device */
+
+	/* Sequential read detection, see fsg_lun_readahead() */
+	loff_t		ra_next;	/* where a sequential READ would start */
+	loff_t		ra_end;		/* end of the range already prefetched */
+	unsigned int	ra_window;
+
 	struct device	dev;
 	const char	*name;		/* "lun.name" */
 	const char	**name_pfx;	/* "function.name" */
@@ -130,6 +136,10 @@ static inline bool fsg_lun_is_open(struct fsg_lun *curlun)
 /* Default size of buffer length. */
 #define FSG_BUFLEN	((u32)16384)
 
+/* Bounds of the readahead window used for sequential READs */
+#define FSG_RA_MIN	((u32)131072)
+#define FSG_RA_MAX	((u32)2097152)
+
 /* Maximal number of LUNs supported in mass storage function */
 #define FSG_MAX_LUNS	16
 
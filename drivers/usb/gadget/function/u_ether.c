@@ -65,6 +65,7 @@ struct eth_dev {
 	atomic_t		tx_qlen;
 
 	struct sk_buff_head	rx_frames;
+	struct napi_struct	napi;
 
 	unsigned		qmult;
 
@@ -257,6 +258,7 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct sk_buff	*skb = req->context, *skb2;
 	struct eth_dev	*dev = ep->driver_data;
+	struct sk_buff_head frames;
 	int		status = req->status;
 
 	switch (status) {
@@ -265,6 +267,10 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 	case 0:
 		skb_put(skb, req->actual);
 
+		/* Unwrap into a private list, so a bad NTB can't take frames
+		 * still waiting for eth_napi_poll() with it.
+		 */
+		skb_queue_head_init(&frames);
 		if (dev->unwrap) {
 			unsigned long	flags;
 
@@ -272,38 +278,36 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 			if (dev->port_usb) {
 				status = dev->unwrap(dev->port_usb,
 							skb,
-							&dev->rx_frames);
+							&frames);
 			} else {
 				dev_kfree_skb_any(skb);
 				status = -ENOTCONN;
 			}
 			spin_unlock_irqrestore(&dev->lock, flags);
 		} else {
-			skb_queue_tail(&dev->rx_frames, skb);
+			skb_queue_tail(&frames, skb);
 		}
 		skb = NULL;
 
-		skb2 = skb_dequeue(&dev->rx_frames);
-		while (skb2) {
-			if (status < 0
-					|| ETH_HLEN > skb2->len
-					|| skb2->len > GETHER_MAX_ETH_FRAME_LEN) {
+		if (status < 0) {
+			while ((skb2 = __skb_dequeue(&frames))) {
 				dev->net->stats.rx_errors++;
 				dev->net->stats.rx_length_errors++;
-				DBG(dev, "rx length %d\n", skb2->len);
 				dev_kfree_skb_any(skb2);
-				goto next_frame;
 			}
-			skb2->protocol = eth_type_trans(skb2, dev->net);
-			dev->net->stats.rx_packets++;
-			dev->net->stats.rx_bytes += skb2->len;
+		} else if (!skb_queue_empty(&frames)) {
+			unsigned long	flags;
 
-			/* no buffer copies needed, unless hardware can't
-			 * use skb buffers.
+			/* Hand the whole batch to NAPI, so GRO sees it */
+			spin_lock_irqsave(&dev->rx_frames.lock, flags);
+			skb_queue_splice_tail_init(&frames, &dev->rx_frames);
+			spin_unlock_irqrestore(&dev->rx_frames.lock, flags);
+			/* From a threaded irq handler NET_RX would only be
+			 * raised and not run; local_bh_enable() runs it.
 			 */
-			status = netif_rx(skb2);
-next_frame:
-			skb2 = skb_dequeue(&dev->rx_frames);
+			local_bh_disable();
+			napi_schedule(&dev->napi);
+			local_bh_enable();
 		}
 		break;
 
@@ -345,6 +349,39 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 		rx_submit(dev, req, GFP_ATOMIC);
 }
 
+static int eth_napi_poll(struct napi_struct *napi, int budget)
+{
+	struct eth_dev	*dev = container_of(napi, struct eth_dev, napi);
+	struct sk_buff	*skb;
+	int		work_done = 0;
+
+	while (work_done < budget) {
+		skb = skb_dequeue(&dev->rx_frames);
+		if (!skb)
+			break;
+		work_done++;
+
+		if (ETH_HLEN > skb->len
+				|| skb->len > GETHER_MAX_ETH_FRAME_LEN) {
+			dev->net->stats.rx_errors++;
+			dev->net->stats.rx_length_errors++;
+			DBG(dev, "rx length %d\n", skb->len);
+			dev_kfree_skb_any(skb);
+			continue;
+		}
+		skb->protocol = eth_type_trans(skb, dev->net);
+		dev->net->stats.rx_packets++;
+		dev->net->stats.rx_bytes += skb->len;
+
+		napi_gro_receive(napi, skb);
+	}
+
+	if (work_done < budget)
+		napi_complete_done(napi, work_done);
+
+	return work_done;
+}
+
 static int prealloc(struct list_head *list, struct usb_ep *ep, unsigned n)
 {
 	unsigned		i;
@@ -629,6 +666,7 @@ static int eth_open(struct net_device *net)
 	struct gether	*link;
 
 	DBG(dev, "%s\n", __func__);
+	napi_enable(&dev->napi);
 	if (netif_carrier_ok(dev->net))
 		eth_start(dev, GFP_KERNEL);
 
@@ -648,6 +686,8 @@ static int eth_stop(struct net_device *net)
 
 	VDBG(dev, "%s\n", __func__);
 	netif_stop_queue(net);
+	napi_disable(&dev->napi);
+	skb_queue_purge(&dev->rx_frames);
 
 	DBG(dev, "stop stats: rx/tx %ld/%ld, errs %ld/%ld\n",
 		dev->net->stats.rx_packets, dev->net->stats.tx_packets,
@@ -769,6 +809,7 @@ struct eth_dev *gether_setup_name(struct usb_gadget *g,
 	INIT_LIST_HEAD(&dev->rx_reqs);
 
 	skb_queue_head_init(&dev->rx_frames);
+	netif_napi_add(net, &dev->napi, eth_napi_poll);
 
 	/* network device setup */
 	dev->net = net;
@@ -840,6 +881,7 @@ struct net_device *gether_setup_name_default(const char *netname)
 	INIT_LIST_HEAD(&dev->rx_reqs);
 
 	skb_queue_head_init(&dev->rx_frames);
+	netif_napi_add(net, &dev->napi, eth_napi_poll);
 
 	/* network device setup */
 	dev->net = net;
@@ -1066,6 +1108,7 @@ void gether_cleanup(struct eth_dev *dev)
 
 	unregister_netdev(dev->net);
 	flush_work(&dev->work);
+	skb_queue_purge(&dev->rx_frames);
 	free_netdev(dev->net);
 }
 EXPORT_SYMBOL_GPL(gether_cleanup);
@@ -1208,6 +1251,9 @@ void gether_disconnect(struct gether *link)
 	spin_unlock(&dev->req_lock);
 	link->out_ep->desc = NULL;
 
+	/* drop the frames NAPI has not delivered yet */
+	skb_queue_purge(&dev->rx_frames);
+
 	/* finish forgetting about this USB link episode */
 	dev->header_len = 0;
 	dev->unwrap = NULL;
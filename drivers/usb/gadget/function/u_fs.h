@@ -15,6 +15,7 @@
 
 #include <linux/usb/composite.h>
 #include <linux/list.h>
+#include <linux/llist.h>
 #include <linux/mutex.h>
 #include <linux/workqueue.h>
 #include <linux/refcount.h>
@@ -277,6 +278,9 @@ struct ffs_data {
 
 	struct eventfd_ctx *ffs_eventfd;
 	struct workqueue_struct *io_completion_wq;
+	/* AIO requests completed by the UDC, reaped by io_completion_work */
+	struct llist_head io_completions;
+	struct work_struct io_completion_work;
 	bool no_disconnect;
 	struct work_struct reset_work;
 
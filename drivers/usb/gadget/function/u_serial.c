@@ -73,14 +73,27 @@
  *	tty_struct->driver_data ... gserial
  */
 
-/* RX and TX queues can buffer QUEUE_SIZE packets before they hit the
- * next layer of buffering.  For TX that's a circular buffer; for RX
- * consider it a NOP.  A third layer is provided by the TTY code.
+/* RX and TX queues can buffer queue_size requests (QUEUE_SIZE unless set
+ * by the module parameter) before they hit the next layer of buffering.
+ * For TX that's a circular buffer; for RX consider it a NOP.  A third
+ * layer is provided by the TTY code.
  */
 #define QUEUE_SIZE		16
+#define QUEUE_SIZE_MAX		256
 #define WRITE_BUF_SIZE		8192		/* TX only */
 #define GS_CONSOLE_BUF_SIZE	8192
 
+/* TX requests carry up to this much of the circular buffer each, rather
+ * than a single packet.  RX requests stay at one packet, since hosts don't
+ * reliably end a transfer with a ZLP and a larger request could then hold
+ * back the data already received.
+ */
+#define TX_REQ_SIZE		4096
+
+static unsigned int queue_size = QUEUE_SIZE;
+module_param(queue_size, uint, 0444);
+MODULE_PARM_DESC(queue_size, "Number of RX and TX requests per port");
+
 /* Prevents race conditions while accessing gser->ioport */
 static DEFINE_SPINLOCK(serial_port_lock);
 
@@ -246,11 +259,12 @@ __acquires(&port->port_lock)
 		struct usb_request	*req;
 		int			len;
 
-		if (port->write_started >= QUEUE_SIZE)
+		if (port->write_started >= queue_size)
 			break;
 
 		req = list_entry(pool->next, struct usb_request, list);
-		len = gs_send_packet(port, req->buf, in->maxpacket);
+		len = gs_send_packet(port, req->buf,
+				     max_t(unsigned, TX_REQ_SIZE, in->maxpacket));
 		if (len == 0) {
 			wake_up_interruptible(&port->drain_wait);
 			break;
@@ -317,7 +331,7 @@ __acquires(&port->port_lock)
 		if (!tty)
 			break;
 
-		if (port->read_started >= QUEUE_SIZE)
+		if (port->read_started >= queue_size)
 			break;
 
 		req = list_entry(pool->next, struct usb_request, list);
@@ -353,7 +367,7 @@ __acquires(&port->port_lock)
  *
  * If the RX queue becomes full enough that no usb_request is queued,
  * the OUT endpoint may begin NAKing as soon as its FIFO fills up.
- * So QUEUE_SIZE packets plus however many the FIFO holds (usually two)
+ * So queue_size packets plus however many the FIFO holds (usually two)
  * can be buffered before the TTY layer's buffers (currently 64 KB).
  */
 static void gs_rx_push(struct work_struct *work)
@@ -503,19 +517,19 @@ static void gs_free_requests(struct usb_ep *ep, struct list_head *head,
 }
 
 static int gs_alloc_requests(struct usb_ep *ep, struct list_head *head,
-		void (*fn)(struct usb_ep *, struct usb_request *),
+		unsigned len, void (*fn)(struct usb_ep *, struct usb_request *),
 		int *allocated)
 {
 	int			i;
 	struct usb_request	*req;
-	int n = allocated ? QUEUE_SIZE - *allocated : QUEUE_SIZE;
+	int n = allocated ? queue_size - *allocated : queue_size;
 
-	/* Pre-allocate up to QUEUE_SIZE transfers, but if we can't
+	/* Pre-allocate up to queue_size transfers, but if we can't
 	 * do quite that many this time, don't fail ... we just won't
 	 * be as speedy as we might otherwise be.
 	 */
 	for (i = 0; i < n; i++) {
-		req = gs_alloc_req(ep, ep->maxpacket, GFP_ATOMIC);
+		req = gs_alloc_req(ep, len, GFP_ATOMIC);
 		if (!req)
 			return list_empty(head) ? -ENOMEM : 0;
 		req->complete = fn;
@@ -548,12 +562,13 @@ static int gs_start_io(struct gs_port *port)
 	 * configurations may use different endpoints with a given port;
 	 * and high speed vs full speed changes packet sizes too.
 	 */
-	status = gs_alloc_requests(ep, head, gs_read_complete,
+	status = gs_alloc_requests(ep, head, ep->maxpacket, gs_read_complete,
 		&port->read_allocated);
 	if (status)
 		return status;
 
 	status = gs_alloc_requests(port->port_usb->in, &port->write_pool,
+			max_t(unsigned, TX_REQ_SIZE, port->port_usb->in->maxpacket),
 			gs_write_complete, &port->write_allocated);
 	if (status) {
 		gs_free_requests(ep, head, &port->read_allocated);
@@ -1498,6 +1513,8 @@ static int __init userial_init(void)
 	driver->init_termios.c_ispeed = 9600;
 	driver->init_termios.c_ospeed = 9600;
 
+	queue_size = clamp_t(unsigned int, queue_size, 1, QUEUE_SIZE_MAX);
+
 	tty_set_operations(driver, &gs_tty_ops);
 	for (i = 0; i < MAX_U_SERIAL_PORTS; i++)
 		mutex_init(&ports[i].lock);
@@ -71,6 +71,8 @@ extern unsigned int uvc_gadget_trace_param;
 #define UVC_MAX_EVENTS				4
 
 #define UVCG_REQUEST_HEADER_LEN			12
+/* Size of the bulk requests when the video data is mapped with sg */
+#define UVCG_BULK_SG_REQ_SIZE			(64 * 1024)
 
 /* ------------------------------------------------------------------------
  * Structures
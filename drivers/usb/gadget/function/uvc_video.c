@@ -71,6 +71,16 @@ static inline void uvc_wait_req_complete(struct uvc_video *video, struct uvc_req
 { }
 #endif
 
+/*
+ * The bulk payload spans several requests, with a header only at its start.
+ * When the UDC supports sg, map the video buffer pages into the requests
+ * instead of copying the data.
+ */
+static bool uvc_video_bulk_use_sg(struct uvc_video *video)
+{
+	return video->queue.use_sg && !uvc_using_zero_copy(video);
+}
+
 /* --------------------------------------------------------------------------
  * Video codecs
  */
@@ -193,6 +203,79 @@ uvc_video_encode_bulk(struct usb_request *req, struct uvc_video *video,
 		video->payload_size = 0;
 }
 
+static void
+uvc_video_encode_bulk_sg(struct usb_request *req, struct uvc_video *video,
+		struct uvc_buffer *buf)
+{
+	unsigned int pending = buf->bytesused - video->queue.buf_used;
+	struct uvc_request *ureq = req->context;
+	struct scatterlist *sg = ureq->sgt.sgl;
+	unsigned int len = video->req_size;
+	unsigned int header_len = 0;
+	unsigned int sg_left, part;
+	unsigned int nbytes = 0;
+	unsigned int num_sgs = 0;
+
+	sg_init_table(sg, ureq->sgt.nents);
+
+	/* Add a header at the beginning of the payload. */
+	if (video->payload_size == 0) {
+		header_len = uvc_video_encode_header(video, buf, ureq->header,
+						     len);
+		sg_set_buf(sg, ureq->header, header_len);
+		video->payload_size += header_len;
+		len -= header_len;
+		sg = sg_next(sg);
+		num_sgs++;
+	}
+
+	len = min3(len, video->max_payload_size - video->payload_size, pending);
+
+	/* Map the video data, without copy. */
+	while (len && buf->sg && buf->sg->length && num_sgs < ureq->sgt.nents) {
+		sg_left = buf->sg->length - buf->offset;
+		part = min(len, sg_left);
+
+		sg_set_page(sg, sg_page(buf->sg), part, buf->offset);
+		sg = sg_next(sg);
+		num_sgs++;
+
+		if (part == sg_left) {
+			buf->offset = 0;
+			buf->sg = sg_next(buf->sg);
+		} else {
+			buf->offset += part;
+		}
+		nbytes += part;
+		len -= part;
+	}
+
+	req->buf = NULL;
+	req->sg = ureq->sgt.sgl;
+	req->num_sgs = num_sgs;
+	req->length = header_len + nbytes;
+
+	video->payload_size += nbytes;
+	video->queue.buf_used += nbytes;
+	req->zero = video->payload_size == video->max_payload_size;
+
+	if (buf->bytesused == video->queue.buf_used || !buf->sg) {
+		video->queue.buf_used = 0;
+		buf->state = UVC_BUF_STATE_DONE;
+		buf->offset = 0;
+		list_del(&buf->queue);
+		video->fid ^= UVC_STREAM_FID;
+		ureq->last_buf = buf;
+
+		video->payload_size = 0;
+		req->zero = 1;
+	}
+
+	if (video->payload_size == video->max_payload_size ||
+	    video->queue.flags & UVC_QUEUE_DROP_INCOMPLETE)
+		video->payload_size = 0;
+}
+
 static void
 uvc_video_encode_isoc_sg(struct usb_request *req, struct uvc_video *video,
 		struct uvc_buffer *buf)
@@ -410,6 +493,12 @@ uvc_video_alloc_requests(struct uvc_video *video)
 	} else {
 		req_size = video->ep->maxpacket
 			 * max_t(unsigned int, video->ep->maxburst, 1);
+		/*
+		 * Without a copy, larger requests only cost sg entries and
+		 * they complete less often.
+		 */
+		if (uvc_video_bulk_use_sg(video))
+			req_size = roundup(UVCG_BULK_SG_REQ_SIZE, req_size);
 	}
 
 	video->ureq = kcalloc(video->uvc_num_requests, sizeof(struct uvc_request), GFP_KERNEL);
@@ -417,9 +506,13 @@ uvc_video_alloc_requests(struct uvc_video *video)
 		return -ENOMEM;
 
 	for (i = 0; i < video->uvc_num_requests; ++i) {
-		video->ureq[i].req_buffer = kmalloc(req_size, GFP_KERNEL);
-		if (video->ureq[i].req_buffer == NULL)
-			goto error;
+		/* The bulk sg requests only point to the video buffers */
+		if (!usb_endpoint_xfer_bulk(video->ep->desc) ||
+		    !uvc_video_bulk_use_sg(video)) {
+			video->ureq[i].req_buffer = kmalloc(req_size, GFP_KERNEL);
+			if (video->ureq[i].req_buffer == NULL)
+				goto error;
+		}
 
 		video->ureq[i].req = usb_ep_alloc_request(video->ep, GFP_KERNEL);
 		if (video->ureq[i].req == NULL)
@@ -596,7 +689,8 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
 		return ret;
 
 	if (video->max_payload_size) {
-		video->encode = uvc_video_encode_bulk;
+		video->encode = uvc_video_bulk_use_sg(video) ?
+			uvc_video_encode_bulk_sg : uvc_video_encode_bulk;
 		video->payload_size = 0;
 	} else
 		video->encode = video->queue.use_sg ?
@@ -338,7 +338,7 @@ static int av1dec_extract_task_msg(struct av1dec_task *task,
 				base = task->reg_class[class].base;
 				regs = (u32 *)task->reg_class[class].data;
 				regs += MPP_BASE_TO_IDX(req->offset - base);
-				if (copy_from_user(regs, wreq->data, wreq->size)) {
+				if (mpp_msgs_copy_from_user(msgs, regs, wreq->data, wreq->size)) {
 					mpp_err("copy_from_user fail, offset %08x\n", wreq->offset);
 					ret = -EIO;
 					goto fail;
@@ -360,7 +360,7 @@ static int av1dec_extract_task_msg(struct av1dec_task *task,
 			}
 		} break;
 		case MPP_CMD_SET_REG_ADDR_OFFSET: {
-			mpp_extract_reg_offset_info(&task->off_inf, req);
+			mpp_extract_reg_offset_info(msgs, &task->off_inf, req);
 		} break;
 		default:
 			break;
@@ -11,10 +11,14 @@
 
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
+#include <linux/capability.h>
 #include <linux/clk.h>
 #include <linux/delay.h>
+#include <linux/eventfd.h>
 #include <linux/interrupt.h>
 #include <linux/iopoll.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
@@ -29,6 +33,7 @@
 #include <linux/slab.h>
 #include <linux/uaccess.h>
 #include <linux/nospec.h>
+#include <linux/overflow.h>
 
 #include <soc/rockchip/pm_domains.h>
 
@@ -36,6 +41,9 @@
 #include "mpp_common.h"
 #include "mpp_iommu.h"
 
+#define CREATE_TRACE_POINTS
+#include "mpp_trace.h"
+
 /* input parmater structure for version 1 */
 struct mpp_msg_v1 {
 	__u32 cmd;
@@ -64,6 +72,7 @@ const char *mpp_device_name[MPP_DEVICE_BUTT] = {
 	[MPP_DEVICE_VEPU22]		= "VEPU22",
 	[MPP_DEVICE_IEP2]		= "IEP2",
 	[MPP_DEVICE_VDPP]		= "VDPP",
+	[MPP_DEVICE_NULL]		= "NULL",
 };
 
 const char *enc_info_item_name[ENC_INFO_BUTT] = {
@@ -94,12 +103,62 @@ mpp_taskqueue_pop_pending(struct mpp_taskqueue *queue,
 
 	mutex_lock(&queue->pending_lock);
 	list_del_init(&task->queue_link);
+	mpp_taskqueue_unqueue_core(queue, task);
 	mutex_unlock(&queue->pending_lock);
 	kref_put(&task->ref, mpp_free_task);
 
 	return 0;
 }
 
+/* slack added to submission time for tasks without deadline, in us */
+static const u32 mpp_session_prio_slack_us[MPP_SESSION_PRIO_BUTT] = {
+	[MPP_SESSION_PRIO_RT]		= 0,
+	[MPP_SESSION_PRIO_NORMAL]	= 16000,
+	[MPP_SESSION_PRIO_BULK]		= 100000,
+};
+
+/*
+ * Set the key of earliest deadline first pick, caller holds pending_lock.
+ * The key never goes back within a session, so tasks of one session keep
+ * the submission order, which the codec reference and result pop rely on.
+ */
+static void
+mpp_taskqueue_set_sched_key(struct mpp_session *session, struct mpp_task *task,
+			    u32 deadline_us)
+{
+	ktime_t key;
+
+	task->on_queue = ktime_get();
+	if (!deadline_us)
+		deadline_us = mpp_session_prio_slack_us[session->prio];
+	key = ktime_add_us(task->on_queue, deadline_us);
+
+	if (ktime_before(key, session->sched_key))
+		key = session->sched_key;
+	session->sched_key = key;
+	task->sched_key = key;
+}
+
+/*
+ * Insert the task into the pending list kept sorted by key, equal keys in
+ * fifo order, so that every dispatcher taking the list head picks earliest
+ * deadline first. Keys mostly grow, so the walk from the tail is short.
+ * Caller holds pending_lock.
+ */
+static void
+mpp_taskqueue_add_pending(struct mpp_taskqueue *queue, struct mpp_task *task)
+{
+	struct mpp_task *loop;
+
+	list_for_each_entry_reverse(loop, &queue->pending_list, queue_link) {
+		if (!ktime_before(task->sched_key, loop->sched_key)) {
+			list_add(&task->queue_link, &loop->queue_link);
+			return;
+		}
+	}
+	list_add(&task->queue_link, &queue->pending_list);
+}
+
 static struct mpp_task *
 mpp_taskqueue_get_pending_task(struct mpp_taskqueue *queue)
 {
@@ -114,6 +173,21 @@ mpp_taskqueue_get_pending_task(struct mpp_taskqueue *queue)
 	return task;
 }
 
+static void mpp_session_sched_account(struct mpp_session *session,
+				      struct mpp_task *task)
+{
+	u64 delay_us;
+
+	if (!task->on_queue)
+		return;
+
+	delay_us = ktime_us_delta(ktime_get(), task->on_queue);
+	session->sched_cnt++;
+	session->sched_delay_sum_us += delay_us;
+	if (delay_us > session->sched_delay_max_us)
+		session->sched_delay_max_us = delay_us;
+}
+
 static bool
 mpp_taskqueue_is_running(struct mpp_taskqueue *queue)
 {
@@ -131,7 +205,10 @@ int mpp_taskqueue_pending_to_run(struct mpp_taskqueue *queue, struct mpp_task *t
 {
 	unsigned long flags;
 
+	trace_mpp_task_dispatch(mpp_get_task_used_device(task, task->session), task);
+
 	mutex_lock(&queue->pending_lock);
+	mpp_taskqueue_unqueue_core(queue, task);
 	spin_lock_irqsave(&queue->running_lock, flags);
 	list_move_tail(&task->queue_link, &queue->running_list);
 	spin_unlock_irqrestore(&queue->running_lock, flags);
@@ -215,6 +292,12 @@ static void task_msgs_reset(struct mpp_task_msgs *msgs)
 	msgs->req_cnt = 0;
 	msgs->set_cnt = 0;
 	msgs->poll_cnt = 0;
+
+	msgs->payload = NULL;
+	msgs->payload_usr = NULL;
+	msgs->payload_size = 0;
+	msgs->result = NULL;
+	msgs->deadline_us = 0;
 }
 
 static void task_msgs_init(struct mpp_task_msgs *msgs, struct mpp_session *session)
@@ -385,6 +468,11 @@ static struct mpp_session *mpp_session_init(void)
 	INIT_LIST_HEAD(&session->list_msgs_idle);
 	spin_lock_init(&session->lock_msgs);
 
+	init_waitqueue_head(&session->wait);
+	spin_lock_init(&session->lock_event);
+
+	session->prio = MPP_SESSION_PRIO_NORMAL;
+
 	mpp_dbg_session("session %p init\n", session);
 	return session;
 }
@@ -418,6 +506,42 @@ static void mpp_session_deinit_default(struct mpp_session *session)
 	list_del_init(&session->session_link);
 }
 
+static int mpp_session_set_eventfd(struct mpp_session *session, int fd)
+{
+	struct eventfd_ctx *ctx = NULL;
+	struct eventfd_ctx *old;
+	unsigned long flags;
+
+	if (fd >= 0) {
+		ctx = eventfd_ctx_fdget(fd);
+		if (IS_ERR(ctx))
+			return PTR_ERR(ctx);
+	}
+
+	spin_lock_irqsave(&session->lock_event, flags);
+	old = session->eventfd;
+	session->eventfd = ctx;
+	spin_unlock_irqrestore(&session->lock_event, flags);
+
+	if (old)
+		eventfd_ctx_put(old);
+
+	return 0;
+}
+
+/* Called on task done, may be in irq context */
+void mpp_session_notify_done(struct mpp_session *session)
+{
+	unsigned long flags;
+
+	wake_up_interruptible(&session->wait);
+
+	spin_lock_irqsave(&session->lock_event, flags);
+	if (session->eventfd)
+		eventfd_signal(session->eventfd, 1);
+	spin_unlock_irqrestore(&session->lock_event, flags);
+}
+
 void mpp_session_deinit(struct mpp_session *session)
 {
 	mpp_dbg_session("session %d:%d task %d deinit\n", session->pid,
@@ -429,6 +553,7 @@ void mpp_session_deinit(struct mpp_session *session)
 		pr_err("invalid NULL session deinit function\n");
 
 	clear_task_msgs(session);
+	mpp_session_set_eventfd(session, -1);
 
 	kfree(session);
 }
@@ -522,6 +647,8 @@ void mpp_free_task(struct kref *ref)
 		       task->state, atomic_read(&task->abort_request));
 
 	mpp = mpp_get_task_used_device(task, session);
+	if (task->mpp)
+		mpp_core_load_end(task->mpp, task);
 	if (mpp->dev_ops->free_task)
 		mpp->dev_ops->free_task(session, task);
 
@@ -548,7 +675,7 @@ static void mpp_task_timeout_work(struct work_struct *work_s)
 		mpp_err("session %d:%d mpp is null\n", session->device_type, session->index);
 		return;
 	}
-	disable_irq(mpp->irq);
+	mpp_dev_disable_irq(mpp);
 	if (test_and_set_bit(TASK_STATE_HANDLE, &task->state)) {
 		mpp_err("task has been handled\n");
 		return;
@@ -559,7 +686,7 @@ static void mpp_task_timeout_work(struct work_struct *work_s)
 	mpp_task_dump_timing(task, ktime_us_delta(ktime_get(), task->on_create));
 	set_bit(TASK_STATE_TIMEOUT, &task->state);
 
-	enable_irq(mpp->irq);
+	mpp_dev_enable_irq(mpp);
 	mpp_taskqueue_trigger_work(mpp);
 }
 
@@ -688,7 +815,7 @@ int mpp_dev_reset(struct mpp_dev *mpp)
 {
 	dev_info(mpp->dev, "resetting...\n");
 
-	disable_irq(mpp->irq);
+	mpp_dev_disable_irq(mpp);
 	if (mpp->iommu_info && mpp->iommu_info->got_irq)
 		disable_irq(mpp->iommu_info->irq);
 	/*
@@ -719,7 +846,7 @@ int mpp_dev_reset(struct mpp_dev *mpp)
 	mpp_reset_up_write(mpp->reset_group);
 	mpp_iommu_up_write(mpp->iommu_info);
 
-	enable_irq(mpp->irq);
+	mpp_dev_enable_irq(mpp);
 	if (mpp->iommu_info && mpp->iommu_info->got_irq)
 		enable_irq(mpp->iommu_info->irq);
 
@@ -735,6 +862,8 @@ void mpp_task_run_begin(struct mpp_task *task, u32 timing_en, u32 timeout)
 	set_bit(TASK_STATE_START, &task->state);
 
 	mpp_time_record(task);
+	task->on_hw = ktime_get();
+	trace_mpp_task_hw_start(mpp_get_task_used_device(task, task->session), task);
 	schedule_delayed_work(&task->timeout_work, msecs_to_jiffies(timeout));
 
 	if (timing_en) {
@@ -827,9 +956,9 @@ static void try_process_running_task(struct mpp_dev *mpp)
 	/* try process running task */
 	list_for_each_entry_safe(mpp_task, n, &queue->running_list, queue_link) {
 		mpp = mpp_get_task_used_device(mpp_task, mpp_task->session);
-		disable_irq(mpp->irq);
+		mpp_dev_disable_irq(mpp);
 		if (!test_bit(TASK_STATE_HANDLE, &mpp_task->state)) {
-			enable_irq(mpp->irq);
+			mpp_dev_enable_irq(mpp);
 			continue;
 		}
 
@@ -845,7 +974,7 @@ static void try_process_running_task(struct mpp_dev *mpp)
 
 		if (mpp->dev_ops->isr)
 			mpp->dev_ops->isr(mpp);
-		enable_irq(mpp->irq);
+		mpp_dev_enable_irq(mpp);
 	}
 }
 
@@ -894,6 +1023,7 @@ static void mpp_task_worker_default(struct kthread_work *work_s)
 		struct mpp_dev *task_mpp = mpp_get_task_used_device(task, task->session);
 
 		atomic_inc(&task_mpp->task_count);
+		mpp_session_sched_account(task->session, task);
 		mpp_taskqueue_pending_to_run(queue, task);
 		set_bit(TASK_STATE_RUNNING, &task->state);
 		if (mpp_task_run(task_mpp, task))
@@ -1018,6 +1148,8 @@ struct mpp_taskqueue *mpp_taskqueue_init(struct device *dev)
 {
 	struct mpp_taskqueue *queue = devm_kzalloc(dev, sizeof(*queue),
 						   GFP_KERNEL);
+	int i;
+
 	if (!queue)
 		return NULL;
 
@@ -1032,6 +1164,8 @@ struct mpp_taskqueue *mpp_taskqueue_init(struct device *dev)
 	INIT_LIST_HEAD(&queue->running_list);
 	INIT_LIST_HEAD(&queue->mmu_list);
 	INIT_LIST_HEAD(&queue->dev_list);
+	for (i = 0; i < MPP_MAX_CORE_NUM; i++)
+		INIT_LIST_HEAD(&queue->core_list[i]);
 
 	/* default taskqueue has max 16 task capacity */
 	queue->task_capacity = MPP_MAX_TASK_CAPACITY;
@@ -1083,6 +1217,8 @@ static void mpp_attach_workqueue(struct mpp_dev *mpp,
 
 	mpp->core_id = core_id;
 	mpp->queue = queue;
+	atomic_set(&mpp->load, 0);
+	atomic64_set(&mpp->load_since, ktime_get_ns());
 
 	mpp_dbg_core("%s attach queue as core %d\n",
 			dev_name(mpp->dev), mpp->core_id);
@@ -1097,6 +1233,7 @@ static void mpp_attach_workqueue(struct mpp_dev *mpp,
 static void mpp_detach_workqueue(struct mpp_dev *mpp)
 {
 	struct mpp_taskqueue *queue = mpp->queue;
+	struct mpp_task *task, *n;
 
 	if (queue) {
 		mutex_lock(&queue->dev_lock);
@@ -1107,12 +1244,167 @@ static void mpp_detach_workqueue(struct mpp_dev *mpp)
 		clear_bit(mpp->core_id, &queue->core_idle);
 		list_del_init(&mpp->queue_link);
 
+		/* tasks queued to the core are queued again to the others */
+		mutex_lock(&queue->pending_lock);
+		list_for_each_entry_safe(task, n, &queue->core_list[mpp->core_id],
+					 core_link)
+			mpp_taskqueue_unqueue_core(queue, task);
+		mutex_unlock(&queue->pending_lock);
+
 		mpp->queue = NULL;
 
 		mutex_unlock(&queue->dev_lock);
 	}
 }
 
+/*
+ * Cost of a task in units of 16x16 macroblocks scaled by a codec weight,
+ * a task without resolution info counts as one unit.
+ */
+u32 mpp_task_calc_cost(u32 width, u32 height, u32 weight)
+{
+	u32 mbs = DIV_ROUND_UP(width, 16) * DIV_ROUND_UP(height, 16);
+
+	return max_t(u32, mbs, 1) * max_t(u32, weight, 1);
+}
+
+/*
+ * Multi-core dispatch keeps a short queue of pending tasks for each core.
+ * The tasks stay on the pending list and are queued ahead to the core with
+ * the least cost in flight plus queued, where the cost estimate matters as
+ * the cores are busy by then. Tasks are started in the pending order: the
+ * next one runs on its own core back to back when that core is idle, or is
+ * stolen by an idle core otherwise.
+ */
+
+/* Unlink the task from the queue of its core, caller holds pending_lock */
+void mpp_taskqueue_unqueue_core(struct mpp_taskqueue *queue,
+				struct mpp_task *task)
+{
+	struct mpp_dev *core = task->core_queued;
+
+	if (!core)
+		return;
+
+	list_del_init(&task->core_link);
+	queue->core_queued_cnt[core->core_id]--;
+	queue->core_queued_cost[core->core_id] -= task->cost;
+	task->core_queued = NULL;
+}
+
+/*
+ * Fill the core queues from the head of the pending list. Only queued
+ * tasks are skipped on the way, so the walk is bounded by the total core
+ * queue depth whatever the pending list length. Caller holds pending_lock.
+ */
+static void mpp_taskqueue_queue_cores(struct mpp_taskqueue *queue)
+{
+	struct mpp_task *task;
+	u32 room = 0;
+	u32 i;
+
+	for (i = 0; i <= queue->core_id_max; i++) {
+		struct mpp_dev *mpp = queue->cores[i];
+
+		if (mpp && !mpp->disable &&
+		    queue->core_queued_cnt[i] < MPP_CORE_QUEUE_DEPTH)
+			room += MPP_CORE_QUEUE_DEPTH - queue->core_queued_cnt[i];
+	}
+
+	list_for_each_entry(task, &queue->pending_list, queue_link) {
+		struct mpp_dev *core = NULL;
+
+		if (!room)
+			break;
+		if (task->core_queued)
+			continue;
+
+		for (i = 0; i <= queue->core_id_max; i++) {
+			struct mpp_dev *mpp = queue->cores[i];
+
+			if (!mpp || mpp->disable ||
+			    queue->core_queued_cnt[i] >= MPP_CORE_QUEUE_DEPTH)
+				continue;
+			if (!core ||
+			    atomic_read(&mpp->load) + queue->core_queued_cost[i] <
+			    atomic_read(&core->load) +
+			    queue->core_queued_cost[core->core_id])
+				core = mpp;
+		}
+
+		task->core_queued = core;
+		list_add_tail(&task->core_link, &queue->core_list[core->core_id]);
+		queue->core_queued_cnt[core->core_id]++;
+		queue->core_queued_cost[core->core_id] += task->cost;
+		room--;
+	}
+}
+
+/*
+ * Pick the core to run the next pending task on from the idle mask, or
+ * NULL when all cores are busy.
+ */
+struct mpp_dev *mpp_taskqueue_dispatch(struct mpp_taskqueue *queue,
+				       struct mpp_task *task,
+				       unsigned long core_idle)
+{
+	struct mpp_dev *core;
+	u32 i;
+
+	mutex_lock(&queue->pending_lock);
+
+	mpp_taskqueue_queue_cores(queue);
+
+	core = task->core_queued;
+	if (!core || core->disable || !test_bit(core->core_id, &core_idle)) {
+		/* the idle core with the least work queued takes it */
+		core = NULL;
+		for_each_set_bit(i, &core_idle, queue->core_id_max + 1) {
+			struct mpp_dev *mpp = queue->cores[i];
+			u64 queued, best;
+
+			if (!mpp || mpp->disable)
+				continue;
+			if (!core) {
+				core = mpp;
+				continue;
+			}
+			queued = queue->core_queued_cost[i];
+			best = queue->core_queued_cost[core->core_id];
+			if (queued < best ||
+			    (queued == best &&
+			     atomic64_read(&mpp->load_cost) <
+			     atomic64_read(&core->load_cost)))
+				core = mpp;
+		}
+		if (core && task->core_queued)
+			atomic64_inc(&core->load_steals);
+	}
+	if (core)
+		mpp_taskqueue_unqueue_core(queue, task);
+
+	mutex_unlock(&queue->pending_lock);
+
+	return core;
+}
+
+void mpp_core_load_begin(struct mpp_dev *mpp, struct mpp_task *task)
+{
+	atomic_add(task->cost, &mpp->load);
+	set_bit(TASK_STATE_ON_CORE, &task->state);
+}
+
+/* a task leaves its core once, by irq, timeout, abort, reset or free */
+void mpp_core_load_end(struct mpp_dev *mpp, struct mpp_task *task)
+{
+	if (!test_and_clear_bit(TASK_STATE_ON_CORE, &task->state))
+		return;
+
+	atomic_sub(task->cost, &mpp->load);
+	atomic64_add(task->cost, &mpp->load_cost);
+	atomic64_inc(&mpp->load_tasks);
+}
+
 static int mpp_check_cmd_v1(__u32 cmd)
 {
 	bool found;
@@ -1298,6 +1590,17 @@ static int mpp_process_request(struct mpp_session *session,
 		msgs->flags |= req->flags;
 		msgs->set_cnt++;
 	} break;
+	case MPP_CMD_SET_TASK_DEADLINE: {
+		u32 slack;
+
+		if (mpp_msgs_copy_from_user(msgs, &msgs->deadline_us, req->data,
+					    sizeof(msgs->deadline_us)))
+			return -EFAULT;
+		/* a deadline below the class slack jumps the queue like a higher prio */
+		slack = mpp_session_prio_slack_us[session->prio];
+		if (msgs->deadline_us < slack && !capable(CAP_SYS_NICE))
+			msgs->deadline_us = slack;
+	} break;
 	case MPP_CMD_POLL_HW_FINISH: {
 		msgs->flags |= req->flags;
 		msgs->poll_cnt++;
@@ -1378,6 +1681,29 @@ static int mpp_process_request(struct mpp_session *session,
 			return -EINVAL;
 		}
 	} break;
+	case MPP_CMD_SET_SESSION_PRIO: {
+		u32 prio;
+
+		if (get_user(prio, (u32 __user *)req->data))
+			return -EFAULT;
+		if (prio >= MPP_SESSION_PRIO_BUTT) {
+			mpp_err("session prio %d must less than %d\n",
+				prio, MPP_SESSION_PRIO_BUTT);
+			return -EINVAL;
+		}
+		/* realtime sessions can starve every other user of the queue */
+		if (prio < MPP_SESSION_PRIO_NORMAL && !capable(CAP_SYS_NICE))
+			return -EPERM;
+		session->prio = array_index_nospec(prio, MPP_SESSION_PRIO_BUTT);
+	} break;
+	case MPP_CMD_SET_EVENTFD: {
+		s32 fd;
+
+		if (get_user(fd, (s32 __user *)req->data))
+			return -EFAULT;
+
+		return mpp_session_set_eventfd(session, fd);
+	} break;
 	case MPP_CMD_RELEASE_FD: {
 		u32 i;
 		int ret;
@@ -1604,7 +1930,9 @@ static void mpp_msgs_trigger(struct list_head *msgs_list)
 			pr_info("try to trigger abort task %d\n", task->task_id);
 
 		set_bit(TASK_STATE_PENDING, &task->state);
-		list_add_tail(&task->queue_link, &queue->pending_list);
+		mpp_taskqueue_set_sched_key(msgs->session, task, msgs->deadline_us);
+		mpp_taskqueue_add_pending(queue, task);
+		trace_mpp_task_enqueue(mpp, task);
 	}
 
 	if (mpp_prev && queue_prev) {
@@ -1628,6 +1956,8 @@ static void mpp_msgs_wait(struct list_head *msgs_list)
 				mpp_err("session %d wait result ret %d\n",
 					session->index, ret);
 			}
+			if (msgs->result)
+				msgs->result->ret = ret;
 		}
 
 		put_task_msgs(msgs);
@@ -1635,6 +1965,202 @@ static void mpp_msgs_wait(struct list_head *msgs_list)
 	}
 }
 
+static int mpp_batch_collect_task(struct list_head *head,
+				  struct mpp_session *session,
+				  const struct mpp_batch_task *btask,
+				  struct mpp_task_msgs *msgs)
+{
+	u32 i;
+	int ret;
+
+	for (i = 0; i < btask->req_cnt; i++) {
+		const struct mpp_batch_req *breq = &btask->reqs[i];
+		struct mpp_request *req;
+
+		/* only task messages, session switch is not allowed in batch */
+		if (breq->cmd < MPP_CMD_SEND_BASE ||
+		    breq->cmd >= MPP_CMD_POLL_BUTT ||
+		    breq->cmd == MPP_CMD_SET_SESSION_FD ||
+		    mpp_check_cmd_v1(breq->cmd)) {
+			mpp_err("mpp cmd %x is not supported in batch.\n", breq->cmd);
+			return -EINVAL;
+		}
+
+		if ((breq->flags & ~MPP_BATCH_REQ_FLAGS) || breq->reserved) {
+			mpp_err("cmd %x invalid flags %x reserved %x\n",
+				breq->cmd, breq->flags, breq->reserved);
+			return -EINVAL;
+		}
+
+		if (breq->data_offset > msgs->payload_size ||
+		    breq->size > msgs->payload_size - breq->data_offset) {
+			mpp_err("cmd %x data offset %x size %x out of payload %x\n",
+				breq->cmd, breq->data_offset, breq->size,
+				msgs->payload_size);
+			return -EINVAL;
+		}
+
+		req = &msgs->reqs[msgs->req_cnt++];
+		req->cmd = breq->cmd;
+		req->flags = breq->flags;
+		req->size = breq->size;
+		req->offset = breq->offset;
+		req->data = (void __user *)(msgs->payload_usr + breq->data_offset);
+
+		ret = mpp_process_request(session, session->srv, req, msgs);
+		if (ret) {
+			mpp_err("session %d process cmd %x ret %d\n",
+				session->index, req->cmd, ret);
+			return ret;
+		}
+	}
+
+	if (msgs->set_cnt) {
+		/* NOTE: update msg_flags for fd over 1024 */
+		session->msg_flags = msgs->flags;
+		ret = mpp_process_task(session, msgs);
+		if (ret)
+			return ret;
+		if (msgs->task)
+			msgs->result->task_id = msgs->task->task_id;
+	}
+
+	INIT_LIST_HEAD(&msgs->list);
+	list_add_tail(&msgs->list, head);
+
+	return 0;
+}
+
+static int mpp_batch_collect(struct list_head *head, struct mpp_session *session,
+			     struct mpp_batch *batch, const u8 *payload,
+			     struct mpp_batch_result *results)
+{
+	u32 pos = 0;
+	u32 i;
+	int ret = 0;
+
+	for (i = 0; i < batch->task_cnt; i++) {
+		const struct mpp_batch_task *btask;
+		struct mpp_task_msgs *msgs;
+		size_t len;
+
+		if (batch->size - pos < sizeof(*btask)) {
+			ret = -EINVAL;
+			goto cancel;
+		}
+
+		btask = (const struct mpp_batch_task *)(payload + pos);
+		results[i].user_data = btask->user_data;
+
+		/* no task flag is defined yet, keep them for extension */
+		if (btask->flags) {
+			mpp_err("session %d invalid batch task flags %x\n",
+				session->index, btask->flags);
+			ret = -EINVAL;
+			goto cancel;
+		}
+		if (btask->req_cnt > MPP_MAX_MSG_NUM) {
+			mpp_err("session %d message count %d more than %d.\n",
+				session->index, btask->req_cnt, MPP_MAX_MSG_NUM);
+			ret = -EINVAL;
+			goto cancel;
+		}
+		len = struct_size(btask, reqs, btask->req_cnt);
+		if (batch->size - pos < len) {
+			ret = -EINVAL;
+			goto cancel;
+		}
+		pos += len;
+
+		msgs = get_task_msgs(session);
+		msgs->payload = payload;
+		msgs->payload_usr = u64_to_user_ptr(batch->data_ptr);
+		msgs->payload_size = batch->size;
+		msgs->result = &results[i];
+
+		ret = mpp_batch_collect_task(head, session, btask, msgs);
+		if (ret) {
+			put_task_msgs(msgs);
+			goto cancel;
+		}
+	}
+
+	return 0;
+
+cancel:
+	/* the failed task and all tasks after it are never submitted */
+	results[i].ret = ret;
+	while (++i < batch->task_cnt)
+		results[i].ret = -ECANCELED;
+
+	return ret;
+}
+
+/*
+ * Submit a batch of tasks with one copy of all the task messages and
+ * register data, then wait them in order and return the results at once.
+ */
+static int mpp_batch_submit(struct mpp_session *session, void __user *arg)
+{
+	struct mpp_batch batch;
+	struct mpp_batch_result *results;
+	struct list_head msgs_list;
+	u8 *payload;
+	int ret;
+
+	if (copy_from_user(&batch, arg, sizeof(batch)))
+		return -EFAULT;
+
+	if (!batch.task_cnt || batch.task_cnt > MPP_MAX_BATCH_TASKS ||
+	    !batch.size || batch.size > MPP_MAX_BATCH_SIZE) {
+		mpp_err("invalid batch task_cnt %d size %d\n",
+			batch.task_cnt, batch.size);
+		return -EINVAL;
+	}
+	if (batch.flags || batch.reserved) {
+		mpp_err("invalid batch flags %x reserved %x\n",
+			batch.flags, batch.reserved);
+		return -EINVAL;
+	}
+
+	payload = kvmalloc(batch.size, GFP_KERNEL);
+	if (!payload)
+		return -ENOMEM;
+
+	results = kcalloc(batch.task_cnt, sizeof(*results), GFP_KERNEL);
+	if (!results) {
+		ret = -ENOMEM;
+		goto free_payload;
+	}
+
+	if (copy_from_user(payload, u64_to_user_ptr(batch.data_ptr), batch.size)) {
+		ret = -EFAULT;
+		goto free_results;
+	}
+
+	INIT_LIST_HEAD(&msgs_list);
+
+	ret = mpp_batch_collect(&msgs_list, session, &batch, payload, results);
+	if (ret)
+		mpp_err("collect batch failed %d\n", ret);
+
+	mpp_msgs_trigger(&msgs_list);
+
+	mpp_msgs_wait(&msgs_list);
+
+	if (batch.result_ptr &&
+	    copy_to_user(u64_to_user_ptr(batch.result_ptr), results,
+			 batch.task_cnt * sizeof(*results)))
+		ret = -EFAULT;
+
+free_results:
+	kfree(results);
+free_payload:
+	kvfree(payload);
+
+	return ret;
+}
+
 static long mpp_dev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	struct mpp_service *srv;
@@ -1660,6 +2186,9 @@ static long mpp_dev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg
 		return -EBUSY;
 	}
 
+	if (cmd == MPP_IOC_CFG_BATCH)
+		return mpp_batch_submit(session, (void __user *)arg);
+
 	INIT_LIST_HEAD(&msgs_list);
 
 	ret = mpp_collect_msgs(&msgs_list, session, cmd, (void __user *)arg);
@@ -1675,6 +2204,129 @@ static long mpp_dev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg
 	return ret;
 }
 
+/*
+ * Get the oldest pending task if it is done. The task is returned with a
+ * reference, as it can be popped and freed by the result path as soon as
+ * the pending lock is released.
+ */
+static struct mpp_task *mpp_session_get_done_task(struct mpp_session *session)
+{
+	struct mpp_task *task;
+
+	mutex_lock(&session->pending_lock);
+	task = list_first_entry_or_null(&session->pending_list,
+					struct mpp_task,
+					pending_link);
+	if (task && test_bit(TASK_STATE_DONE, &task->state))
+		kref_get(&task->ref);
+	else
+		task = NULL;
+	mutex_unlock(&session->pending_lock);
+
+	return task;
+}
+
+static bool mpp_session_done_ready(struct mpp_session *session)
+{
+	struct mpp_task *task;
+	bool ready;
+
+	mutex_lock(&session->pending_lock);
+	task = list_first_entry_or_null(&session->pending_list,
+					struct mpp_task,
+					pending_link);
+	ready = task && test_bit(TASK_STATE_DONE, &task->state);
+	mutex_unlock(&session->pending_lock);
+
+	return ready;
+}
+
+/* the ready check takes a mutex, so it cannot be a wait_event() condition */
+static int mpp_session_wait_done(struct mpp_session *session)
+{
+	DEFINE_WAIT_FUNC(wait, woken_wake_function);
+	int ret = 0;
+
+	add_wait_queue(&session->wait, &wait);
+	while (!mpp_session_done_ready(session)) {
+		if (signal_pending(current)) {
+			ret = -ERESTARTSYS;
+			break;
+		}
+		wait_woken(&wait, TASK_INTERRUPTIBLE, MAX_SCHEDULE_TIMEOUT);
+	}
+	remove_wait_queue(&session->wait, &wait);
+
+	return ret;
+}
+
+static __poll_t mpp_dev_poll(struct file *filp, poll_table *wait)
+{
+	struct mpp_session *session = filp->private_data;
+	__poll_t mask = 0;
+
+	if (!session || !session->mpp)
+		return EPOLLERR;
+
+	poll_wait(filp, &session->wait, wait);
+
+	if (mpp_session_done_ready(session))
+		mask |= EPOLLIN | EPOLLRDNORM;
+
+	return mask;
+}
+
+/*
+ * Read the finished tasks in submission order, the registers requested
+ * by the task are written back as MPP_CMD_POLL_HW_FINISH does.
+ */
+static ssize_t mpp_dev_read(struct file *filp, char __user *buf,
+			    size_t count, loff_t *ppos)
+{
+	struct mpp_session *session = filp->private_data;
+	struct mpp_task_msgs *msgs;
+	struct mpp_task_done done;
+	struct mpp_task *task;
+	size_t len = 0;
+	int ret = 0;
+
+	if (!session || !session->mpp)
+		return -EINVAL;
+
+	if (count < sizeof(done))
+		return -EINVAL;
+
+	if (!mpp_session_done_ready(session)) {
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		ret = mpp_session_wait_done(session);
+		if (ret)
+			return ret;
+	}
+
+	msgs = get_task_msgs(session);
+	if (!msgs)
+		return -ENOMEM;
+
+	while (count - len >= sizeof(done) &&
+	       (task = mpp_session_get_done_task(session))) {
+		done.task_id = task->task_id;
+		done.ret = mpp_wait_result(session, msgs);
+		kref_put(&task->ref, mpp_free_task);
+
+		if (copy_to_user(buf + len, &done, sizeof(done))) {
+			ret = -EFAULT;
+			break;
+		}
+		len += sizeof(done);
+	}
+
+	put_task_msgs(msgs);
+
+	return len ? len : ret;
+}
+
 static int mpp_dev_open(struct inode *inode, struct file *filp)
 {
 	struct mpp_session *session = NULL;
@@ -1732,6 +2384,8 @@ static int mpp_dev_release(struct inode *inode, struct file *filp)
 const struct file_operations rockchip_mpp_fops = {
 	.open		= mpp_dev_open,
 	.release	= mpp_dev_release,
+	.read		= mpp_dev_read,
+	.poll		= mpp_dev_poll,
 	.unlocked_ioctl = mpp_dev_ioctl,
 #ifdef CONFIG_COMPAT
 	.compat_ioctl   = mpp_dev_ioctl,
@@ -1881,7 +2535,33 @@ int mpp_check_req(struct mpp_request *req, int base,
 	return 0;
 }
 
-int mpp_extract_reg_offset_info(struct reg_offset_info *off_inf,
+/*
+ * Copy the request data of a task message. For the batch submission the
+ * data has been copied into kernel with the whole payload, so take it from
+ * there instead of another copy_from_user.
+ */
+int mpp_msgs_copy_from_user(struct mpp_task_msgs *msgs, void *dst,
+			    const void __user *src, u32 size)
+{
+	if (msgs->payload) {
+		const u8 __user *usr = src;
+
+		if (usr >= msgs->payload_usr &&
+		    usr - msgs->payload_usr <= msgs->payload_size &&
+		    size <= msgs->payload_size - (usr - msgs->payload_usr)) {
+			memcpy(dst, msgs->payload + (usr - msgs->payload_usr), size);
+			return 0;
+		}
+	}
+
+	if (copy_from_user(dst, src, size))
+		return -EFAULT;
+
+	return 0;
+}
+
+int mpp_extract_reg_offset_info(struct mpp_task_msgs *msgs,
+				struct reg_offset_info *off_inf,
 				struct mpp_request *req)
 {
 	int max_size = ARRAY_SIZE(off_inf->elem);
@@ -1892,8 +2572,8 @@ int mpp_extract_reg_offset_info(struct reg_offset_info *off_inf,
 			cnt, off_inf->cnt, max_size);
 		return -EINVAL;
 	}
-	if (copy_from_user(&off_inf->elem[off_inf->cnt],
-			   req->data, req->size)) {
+	if (mpp_msgs_copy_from_user(msgs, &off_inf->elem[off_inf->cnt],
+				    req->data, req->size)) {
 		mpp_err("copy_from_user failed\n");
 		return -EINVAL;
 	}
@@ -1944,6 +2624,7 @@ int mpp_task_init(struct mpp_session *session, struct mpp_task *task)
 {
 	INIT_LIST_HEAD(&task->pending_link);
 	INIT_LIST_HEAD(&task->queue_link);
+	INIT_LIST_HEAD(&task->core_link);
 	INIT_LIST_HEAD(&task->mem_region_list);
 	task->state = 0;
 	task->mem_count = 0;
@@ -1952,6 +2633,38 @@ int mpp_task_init(struct mpp_session *session, struct mpp_task *task)
 	return 0;
 }
 
+static u32 mpp_hist_bucket(s64 us)
+{
+	u32 bucket;
+
+	if (us < 128)
+		return 0;
+
+	bucket = ilog2(us) - 6;
+
+	return min_t(u32, bucket, MPP_HIST_BUCKETS - 1);
+}
+
+/* account the always-on statistics and trace of a finished task */
+void mpp_task_stats_done(struct mpp_dev *mpp, struct mpp_task *task)
+{
+	ktime_t now = ktime_get();
+	s64 hw_us = 0;
+	s64 total_us = 0;
+
+	if (task->on_hw) {
+		hw_us = ktime_us_delta(now, task->on_hw);
+		atomic64_inc(&mpp->hist.hw[mpp_hist_bucket(hw_us)]);
+		atomic64_add(hw_us, &mpp->load_busy_us);
+	}
+	if (task->on_queue) {
+		total_us = ktime_us_delta(now, task->on_queue);
+		atomic64_inc(&mpp->hist.total[mpp_hist_bucket(total_us)]);
+	}
+
+	trace_mpp_task_finish(mpp, task, hw_us, total_us);
+}
+
 int mpp_task_finish(struct mpp_session *session,
 		    struct mpp_task *task)
 {
@@ -1980,8 +2693,11 @@ int mpp_task_finish(struct mpp_session *session,
 			mpp_task_dump_timing(task, time_diff);
 	}
 
+	mpp_task_stats_done(mpp, task);
+
 	/* Wake up the GET thread */
 	wake_up(&task->wait);
+	mpp_session_notify_done(session);
 	mpp_taskqueue_pop_running(mpp->queue, task);
 
 	return 0;
@@ -2138,6 +2854,13 @@ int mpp_dev_probe(struct mpp_dev *mpp,
 
 	device_init_wakeup(dev, true);
 	pm_runtime_enable(dev);
+
+	/* software device like mpp null has no register, irq or iommu */
+	if (!hw_info->reg_num) {
+		mpp->irq = -ENXIO;
+		return 0;
+	}
+
 	mpp->irq = platform_get_irq(pdev, 0);
 	if (mpp->irq < 0) {
 		dev_err(dev, "No interrupt resource found\n");
@@ -2256,6 +2979,8 @@ irqreturn_t mpp_dev_irq(int irq, void *param)
 		task->on_irq = ktime_get();
 		set_bit(TASK_TIMING_IRQ, &task->state);
 	}
+	if (task)
+		trace_mpp_task_irq(mpp, task);
 
 	if (mpp->dev_ops->irq)
 		irq_ret = mpp->dev_ops->irq(mpp);
@@ -2596,9 +3321,84 @@ mpp_procfs_create_u32(const char *name, umode_t mode,
 	return proc_create_data(name, mode, parent, &procfs_fops_u32, data);
 }
 
+static int mpp_show_core_load(struct seq_file *seq, void *offset)
+{
+	struct mpp_dev *mpp = seq->private;
+	s64 since = atomic64_read(&mpp->load_since);
+	u64 busy_us = atomic64_read(&mpp->load_busy_us);
+	s64 total_us = div_s64(ktime_get_ns() - since, NSEC_PER_USEC);
+
+	seq_printf(seq, "core: %d\n", mpp->core_id);
+	seq_printf(seq, "load: %d\n", atomic_read(&mpp->load));
+	seq_printf(seq, "tasks: %lld\n", atomic64_read(&mpp->load_tasks));
+	seq_printf(seq, "cost: %lld\n", atomic64_read(&mpp->load_cost));
+	seq_printf(seq, "steals: %lld\n", atomic64_read(&mpp->load_steals));
+	seq_printf(seq, "busy: %llu us\n", busy_us);
+	/* a task running across a reset is accounted in full to the new window */
+	seq_printf(seq, "util: %llu%%\n",
+		   total_us > 0 ? min_t(u64, div64_u64(busy_us * 100, total_us), 100) : 0);
+
+	return 0;
+}
+
+static int fops_show_latency(struct seq_file *seq, void *offset)
+{
+	struct mpp_dev *mpp = seq->private;
+	u32 i;
+
+	seq_printf(seq, "%-12s %12s %12s\n", "latency(us)", "hw", "total");
+	for (i = 0; i < MPP_HIST_BUCKETS; i++) {
+		if (i < MPP_HIST_BUCKETS - 1)
+			seq_printf(seq, "< %-10u", 128U << i);
+		else
+			seq_printf(seq, ">= %-9u", 64U << i);
+		seq_printf(seq, " %12lld %12lld\n",
+			   (s64)atomic64_read(&mpp->hist.hw[i]),
+			   (s64)atomic64_read(&mpp->hist.total[i]));
+	}
+
+	return 0;
+}
+
+static int fops_open_latency(struct inode *inode, struct file *file)
+{
+	return single_open(file, fops_show_latency, pde_data(inode));
+}
+
+/* any write clears the histograms and the busy time to start a new window */
+static ssize_t fops_write_latency(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	struct seq_file *priv = file->private_data;
+	struct mpp_dev *mpp = priv->private;
+	u32 i;
+
+	for (i = 0; i < MPP_HIST_BUCKETS; i++) {
+		atomic64_set(&mpp->hist.hw[i], 0);
+		atomic64_set(&mpp->hist.total[i], 0);
+	}
+	atomic64_set(&mpp->load_busy_us, 0);
+	atomic64_set(&mpp->load_since, ktime_get_ns());
+
+	return count;
+}
+
+static const struct proc_ops procfs_fops_latency = {
+	.proc_open = fops_open_latency,
+	.proc_read = seq_read,
+	.proc_release = single_release,
+	.proc_write = fops_write_latency,
+};
+
 void mpp_procfs_create_common(struct proc_dir_entry *parent, struct mpp_dev *mpp)
 {
 	mpp_procfs_create_u32("disable_work", 0644, parent, &mpp->disable);
 	mpp_procfs_create_u32("timing_check", 0644, parent, &mpp->timing_check);
+	proc_create_single_data("core_load", 0444, parent, mpp_show_core_load, mpp);
+	proc_create_data("latency", 0644, parent, &procfs_fops_latency, mpp);
 }
 #endif
+
+#ifdef CONFIG_ROCKCHIP_MPP_KUNIT_TEST
+#include "mpp_common_test.c"
+#endif
@@ -20,7 +20,9 @@
 #include <linux/workqueue.h>
 #include <linux/kthread.h>
 #include <linux/reset.h>
+#include <linux/sizes.h>
 #include <linux/irqreturn.h>
+#include <linux/interrupt.h>
 #include <linux/poll.h>
 #include <linux/platform_device.h>
 #include <soc/rockchip/pm_domains.h>
@@ -32,12 +34,21 @@
 #define MPP_MAX_MSG_NUM			(16)
 #define MPP_MAX_REG_TRANS_NUM		(80)
 #define MPP_MAX_TASK_CAPACITY		(16)
+#define MPP_MAX_BATCH_TASKS		(64)
+#define MPP_MAX_BATCH_SIZE		(SZ_1M)
+/* message flags a batch request may carry, same as MPP_IOC_CFG_V1 */
+#define MPP_BATCH_REQ_FLAGS		(MPP_FLAGS_MULTI_MSG | MPP_FLAGS_LAST_MSG | \
+					 MPP_FLAGS_REG_FD_NO_TRANS | \
+					 MPP_FLAGS_SCL_FD_NO_TRANS | \
+					 MPP_FLAGS_REG_NO_OFFSET | \
+					 MPP_FLAGS_SECURE_MODE)
 
 /* grf mask for get value */
 #define MPP_GRF_VAL_MASK		(0xFFFF)
 
 /* max 4 cores supported */
 #define MPP_MAX_CORE_NUM		(4)
+#define MPP_CORE_QUEUE_DEPTH		(2)
 
 /**
  * Device type: classified by hardware feature
@@ -63,6 +74,7 @@ enum MPP_DEVICE_TYPE {
 
 	MPP_DEVICE_IEP2		= 28, /* 0x10000000 */
 	MPP_DEVICE_VDPP		= 29, /* 0x20000000 */
+	MPP_DEVICE_NULL		= 30, /* 0x40000000 */
 	MPP_DEVICE_BUTT,
 };
 
@@ -86,6 +98,7 @@ enum MPP_DRIVER_TYPE {
 	MPP_DRIVER_AV1DEC,
 	MPP_DRIVER_VDPP,
 	MPP_DRIVER_JPGENC,
+	MPP_DRIVER_MPPNULL,
 	MPP_DRIVER_BUTT,
 };
 
@@ -174,6 +187,15 @@ struct mpp_task_msgs {
 
 	struct mpp_request reqs[MPP_MAX_MSG_NUM];
 	struct mpp_request *poll_req;
+
+	/* batch payload already copied into kernel, see MPP_IOC_CFG_BATCH */
+	const u8 *payload;
+	const u8 __user *payload_usr;
+	u32 payload_size;
+	struct mpp_batch_result *result;
+
+	/* deadline in us from submission, 0 for session priority slack */
+	u32 deadline_us;
 };
 
 struct mpp_grf_info {
@@ -265,6 +287,17 @@ struct mpp_mem_region {
 };
 
 
+#define MPP_HIST_BUCKETS		(16)
+
+/*
+ * Latency histogram with log2 buckets in us. Bucket 0 counts below 128us,
+ * bucket i counts [64us << i, 128us << i) and the last one all above.
+ */
+struct mpp_latency_hist {
+	atomic64_t hw[MPP_HIST_BUCKETS];
+	atomic64_t total[MPP_HIST_BUCKETS];
+};
+
 struct mpp_dev {
 	struct device *dev;
 	const struct mpp_dev_var *var;
@@ -318,6 +351,17 @@ struct mpp_dev {
 	/* multi-core data */
 	struct list_head queue_link;
 	s32 core_id;
+	/* cost of tasks on core and accumulated load statistics */
+	atomic_t load;
+	atomic64_t load_cost;
+	atomic64_t load_tasks;
+	atomic64_t load_busy_us;
+	atomic64_t load_steals;
+	/* base of the busy time in ns, both reset by the latency node */
+	atomic64_t load_since;
+
+	/* always-on task latency statistics */
+	struct mpp_latency_hist hist;
 
 	/* common per-device procfs */
 	u32 disable;
@@ -368,6 +412,20 @@ struct mpp_session {
 	struct list_head list_msgs;
 	struct list_head list_msgs_idle;
 	spinlock_t lock_msgs;
+
+	/* event for session poll and read */
+	wait_queue_head_t wait;
+	/* lock for eventfd bind and signal */
+	spinlock_t lock_event;
+	struct eventfd_ctx *eventfd;
+
+	/* scheduling in taskqueue, protected by queue pending_lock */
+	u32 prio;
+	ktime_t sched_key;
+	/* queueing delay statistics */
+	u64 sched_cnt;
+	u64 sched_delay_sum_us;
+	u64 sched_delay_max_us;
 };
 
 /* task state in work thread */
@@ -385,6 +443,7 @@ enum mpp_task_state {
 	TASK_STATE_ABORT	= 9,
 	TASK_STATE_ABORT_READY	= 10,
 	TASK_STATE_PROC_DONE	= 11,
+	TASK_STATE_ON_CORE	= 12,
 
 	/* timing debug state */
 	TASK_TIMING_CREATE	= 16,
@@ -421,6 +480,10 @@ struct mpp_task {
 	struct delayed_work timeout_work;
 	struct kref ref;
 
+	/* time pushed to taskqueue and the key to pick task by */
+	ktime_t on_queue;
+	ktime_t sched_key;
+
 	/* record context running start time */
 	ktime_t start;
 	ktime_t part;
@@ -448,6 +511,14 @@ struct mpp_task {
 	/* for multi-core */
 	struct mpp_dev *mpp;
 	s32 core_id;
+	/* estimated cost for core balance */
+	u32 cost;
+	/* core the task is queued to ahead of dispatch */
+	struct mpp_dev *core_queued;
+	/* link to taskqueue core_list of core_queued */
+	struct list_head core_link;
+	/* hardware start time for always-on statistics */
+	ktime_t on_hw;
 	/* hw cycles */
 	u32 hw_cycles;
 };
@@ -495,6 +566,10 @@ struct mpp_taskqueue {
 	u32 core_id_max;
 	u32 core_count;
 	unsigned long dev_active_flags;
+	/* tasks queued ahead to each core, under pending_lock */
+	struct list_head core_list[MPP_MAX_CORE_NUM];
+	u32 core_queued_cnt[MPP_MAX_CORE_NUM];
+	u64 core_queued_cost[MPP_MAX_CORE_NUM];
 };
 
 struct mpp_reset_group {
@@ -616,7 +691,10 @@ int mpp_translate_reg_address(struct mpp_session *session,
 
 int mpp_check_req(struct mpp_request *req, int base,
 		  int max_size, u32 off_s, u32 off_e);
-int mpp_extract_reg_offset_info(struct reg_offset_info *off_inf,
+int mpp_msgs_copy_from_user(struct mpp_task_msgs *msgs, void *dst,
+			    const void __user *src, u32 size);
+int mpp_extract_reg_offset_info(struct mpp_task_msgs *msgs,
+				struct reg_offset_info *off_inf,
 				struct mpp_request *req);
 int mpp_query_reg_offset_info(struct reg_offset_info *off_inf,
 			      u32 index);
@@ -636,6 +714,16 @@ int mpp_task_dump_mem_region(struct mpp_dev *mpp,
 int mpp_task_dump_reg(struct mpp_dev *mpp,
 		      struct mpp_task *task);
 int mpp_task_dump_hw_reg(struct mpp_dev *mpp);
+
+u32 mpp_task_calc_cost(u32 width, u32 height, u32 weight);
+void mpp_taskqueue_unqueue_core(struct mpp_taskqueue *queue,
+				struct mpp_task *task);
+struct mpp_dev *mpp_taskqueue_dispatch(struct mpp_taskqueue *queue,
+				       struct mpp_task *task,
+				       unsigned long core_idle);
+void mpp_core_load_begin(struct mpp_dev *mpp, struct mpp_task *task);
+void mpp_core_load_end(struct mpp_dev *mpp, struct mpp_task *task);
+void mpp_task_stats_done(struct mpp_dev *mpp, struct mpp_task *task);
 void mpp_task_dump_timing(struct mpp_task *task, s64 time_diff);
 
 void mpp_reg_show(struct mpp_dev *mpp, u32 offset);
@@ -643,6 +731,7 @@ void mpp_reg_show_range(struct mpp_dev *mpp, u32 start, u32 end);
 void mpp_free_task(struct kref *ref);
 
 void mpp_session_deinit(struct mpp_session *session);
+void mpp_session_notify_done(struct mpp_session *session);
 void mpp_session_cleanup_detach(struct mpp_taskqueue *queue,
 				struct kthread_work *work);
 
@@ -767,6 +856,19 @@ static inline int mpp_clk_safe_disable(struct clk *clk)
 	return 0;
 }
 
+/* software devices such as mpp null probe without an irq */
+static inline void mpp_dev_enable_irq(struct mpp_dev *mpp)
+{
+	if (mpp->irq >= 0)
+		enable_irq(mpp->irq);
+}
+
+static inline void mpp_dev_disable_irq(struct mpp_dev *mpp)
+{
+	if (mpp->irq >= 0)
+		disable_irq(mpp->irq);
+}
+
 static inline int mpp_reset_down_read(struct mpp_reset_group *group)
 {
 	if (group && group->rw_sem_on)
@@ -852,5 +954,6 @@ extern struct platform_driver rockchip_rkvenc2_driver;
 extern struct platform_driver rockchip_av1dec_driver;
 extern struct platform_driver rockchip_jpgenc_driver;
 extern struct platform_driver rockchip_vdpp_driver;
+extern struct platform_driver rockchip_null_driver;
 
 #endif
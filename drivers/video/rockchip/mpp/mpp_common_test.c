@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: (GPL-2.0+ OR MIT)
+/*
+ * KUnit tests of the task queue order, included by mpp_common.c
+ *
+ * Copyright (c) 2024 Rockchip Electronics Co., Ltd.
+ */
+#include <kunit/test.h>
+
+struct mpp_queue_test {
+	struct mpp_taskqueue queue;
+	struct mpp_session session[MPP_SESSION_PRIO_BUTT];
+	struct mpp_task task[4];
+};
+
+static int mpp_queue_test_init(struct kunit *test)
+{
+	struct mpp_queue_test *t;
+	int i;
+
+	t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, t);
+	test->priv = t;
+
+	mutex_init(&t->queue.pending_lock);
+	INIT_LIST_HEAD(&t->queue.pending_list);
+	for (i = 0; i < ARRAY_SIZE(t->session); i++)
+		t->session[i].prio = i;
+	for (i = 0; i < ARRAY_SIZE(t->task); i++)
+		INIT_LIST_HEAD(&t->task[i].queue_link);
+
+	return 0;
+}
+
+/* queue as mpp_msgs_trigger() does */
+static void mpp_test_queue(struct mpp_queue_test *t, struct mpp_task *task,
+			   u32 prio, u32 deadline_us)
+{
+	mutex_lock(&t->queue.pending_lock);
+	mpp_taskqueue_set_sched_key(&t->session[prio], task, deadline_us);
+	mpp_taskqueue_add_pending(&t->queue, task);
+	mutex_unlock(&t->queue.pending_lock);
+}
+
+static struct mpp_task *mpp_test_pop(struct mpp_queue_test *t)
+{
+	struct mpp_task *task = mpp_taskqueue_get_pending_task(&t->queue);
+
+	if (task)
+		list_del_init(&task->queue_link);
+
+	return task;
+}
+
+static void mpp_queue_test_prio(struct kunit *test)
+{
+	struct mpp_queue_test *t = test->priv;
+
+	mpp_test_queue(t, &t->task[0], MPP_SESSION_PRIO_BULK, 0);
+	mpp_test_queue(t, &t->task[1], MPP_SESSION_PRIO_NORMAL, 0);
+	mpp_test_queue(t, &t->task[2], MPP_SESSION_PRIO_RT, 0);
+
+	KUNIT_EXPECT_PTR_EQ(test, mpp_test_pop(t), &t->task[2]);
+	KUNIT_EXPECT_PTR_EQ(test, mpp_test_pop(t), &t->task[1]);
+	KUNIT_EXPECT_PTR_EQ(test, mpp_test_pop(t), &t->task[0]);
+	KUNIT_EXPECT_NULL(test, mpp_test_pop(t));
+}
+
+static void mpp_queue_test_deadline(struct kunit *test)
+{
+	struct mpp_queue_test *t = test->priv;
+
+	/* an explicit deadline overrides the slack of the session class */
+	mpp_test_queue(t, &t->task[0], MPP_SESSION_PRIO_NORMAL, 0);
+	mpp_test_queue(t, &t->task[1], MPP_SESSION_PRIO_BULK, 1000);
+
+	KUNIT_EXPECT_PTR_EQ(test, mpp_test_pop(t), &t->task[1]);
+	KUNIT_EXPECT_PTR_EQ(test, mpp_test_pop(t), &t->task[0]);
+}
+
+static void mpp_queue_test_session_order(struct kunit *test)
+{
+	struct mpp_queue_test *t = test->priv;
+
+	/* a later task of a session never overtakes an earlier one */
+	mpp_test_queue(t, &t->task[0], MPP_SESSION_PRIO_NORMAL, 50000);
+	mpp_test_queue(t, &t->task[1], MPP_SESSION_PRIO_NORMAL, 1000);
+	mpp_test_queue(t, &t->task[2], MPP_SESSION_PRIO_BULK, 20000);
+
+	KUNIT_EXPECT_FALSE(test, ktime_before(t->task[1].sched_key,
+					      t->task[0].sched_key));
+	KUNIT_EXPECT_PTR_EQ(test, mpp_test_pop(t), &t->task[2]);
+	KUNIT_EXPECT_PTR_EQ(test, mpp_test_pop(t), &t->task[0]);
+	KUNIT_EXPECT_PTR_EQ(test, mpp_test_pop(t), &t->task[1]);
+}
+
+static void mpp_queue_test_fifo(struct kunit *test)
+{
+	struct mpp_queue_test *t = test->priv;
+	int i;
+
+	/* equal keys keep the submission order */
+	for (i = 0; i < ARRAY_SIZE(t->task); i++) {
+		t->task[i].sched_key = i == 2 ? 100 : 200;
+		mpp_taskqueue_add_pending(&t->queue, &t->task[i]);
+	}
+
+	KUNIT_EXPECT_PTR_EQ(test, mpp_test_pop(t), &t->task[2]);
+	KUNIT_EXPECT_PTR_EQ(test, mpp_test_pop(t), &t->task[0]);
+	KUNIT_EXPECT_PTR_EQ(test, mpp_test_pop(t), &t->task[1]);
+	KUNIT_EXPECT_PTR_EQ(test, mpp_test_pop(t), &t->task[3]);
+}
+
+static struct kunit_case mpp_queue_test_cases[] = {
+	KUNIT_CASE(mpp_queue_test_prio),
+	KUNIT_CASE(mpp_queue_test_deadline),
+	KUNIT_CASE(mpp_queue_test_session_order),
+	KUNIT_CASE(mpp_queue_test_fifo),
+	{}
+};
+
+static struct kunit_suite mpp_queue_test_suite = {
+	.name = "rockchip_mpp_queue",
+	.init = mpp_queue_test_init,
+	.test_cases = mpp_queue_test_cases,
+};
+
+kunit_test_suite(mpp_queue_test_suite);
@@ -297,8 +297,8 @@ static int iep2_extract_task_msg(struct iep_task *task,
 
 		switch (req->cmd) {
 		case MPP_CMD_SET_REG_WRITE: {
-			if (copy_from_user(&task->params,
-					   req->data, req->size)) {
+			if (mpp_msgs_copy_from_user(msgs, &task->params,
+						    req->data, req->size)) {
 				mpp_err("copy_from_user params failed\n");
 				return -EIO;
 			}
@@ -308,7 +308,7 @@ static int iep2_extract_task_msg(struct iep_task *task,
 			       req, sizeof(*req));
 		} break;
 		case MPP_CMD_SET_REG_ADDR_OFFSET: {
-			mpp_extract_reg_offset_info(&task->off_inf, req);
+			mpp_extract_reg_offset_info(msgs, &task->off_inf, req);
 		} break;
 		default:
 			break;
@@ -27,48 +27,73 @@
 #include "mpp_iommu.h"
 #include "mpp_common.h"
 
+/*
+ * Lookup the import cache for dmabuf, caller must hold rcu read lock.
+ *
+ * Buffers live in the session dma_bufs array and are never freed while the
+ * session exists, so a stale hit can only be a slot recycled for another
+ * dmabuf, which is caught by the dmabuf check of the caller. A released
+ * slot is only hashed again after a grace period, see mpp_dma_import_dmabuf(),
+ * so a lookup never follows a node moved to another chain.
+ */
+static struct mpp_dma_buffer *
+mpp_dma_lookup_buffer(struct mpp_dma_session *dma, struct dma_buf *dmabuf)
+{
+	struct mpp_dma_buffer *buffer;
+
+	hash_for_each_possible_rcu(dma->buf_hash, buffer, node,
+				   (unsigned long)dmabuf) {
+		/*
+		 * fd may dup several and point the same dambuf.
+		 * thus, here should be distinguish with the dmabuf.
+		 */
+		if (READ_ONCE(buffer->dmabuf) == dmabuf) {
+			/* lru stamp, consumed by mpp_dma_remove_extra_buffer */
+			WRITE_ONCE(buffer->last_used, ktime_get());
+			return buffer;
+		}
+	}
+
+	return NULL;
+}
+
+/* Find and get the buffer imported for dmabuf, NULL if not in session */
+static struct mpp_dma_buffer *
+mpp_dma_get_buffer(struct mpp_dma_session *dma, struct dma_buf *dmabuf)
+{
+	struct mpp_dma_buffer *buffer;
+
+	rcu_read_lock();
+	buffer = mpp_dma_lookup_buffer(dma, dmabuf);
+	if (buffer && !kref_get_unless_zero(&buffer->ref))
+		buffer = NULL;
+	rcu_read_unlock();
+
+	/* slot recycled between lookup and get */
+	if (buffer && READ_ONCE(buffer->dmabuf) != dmabuf) {
+		mpp_dma_release(dma, buffer);
+		buffer = NULL;
+	}
+
+	return buffer;
+}
+
+/*
+ * Find the buffer imported for fd, with a reference the caller drops with
+ * mpp_dma_release().
+ */
 struct mpp_dma_buffer *
 mpp_dma_find_buffer_fd(struct mpp_dma_session *dma, int fd)
 {
 	struct dma_buf *dmabuf;
 	struct mpp_dma_buffer *out = NULL;
-	struct mpp_dma_buffer *buffer = NULL, *n;
-	int find = 0;
 
 	dmabuf = dma_buf_get(fd);
 	if (IS_ERR(dmabuf))
 		return NULL;
 
-	mutex_lock(&dma->list_mutex);
-	list_for_each_entry_safe(buffer, n,
-				 &dma->used_list, link) {
-		/*
-		 * fd may dup several and point the same dambuf.
-		 * thus, here should be distinguish with the dmabuf.
-		 */
-		if (buffer->dmabuf == dmabuf) {
-			out = buffer;
-			find = 1;
-			list_move_tail(&buffer->link, &buffer->dma->used_list);
-			break;
-		}
-	}
-	if (!find) {
-		list_for_each_entry_safe(buffer, n,
-					&dma->static_list, link) {
-			/*
-			 * fd may dup several and point the same dambuf.
-			 * thus, here should be distinguish with the dmabuf.
-			 */
-			if (buffer->dmabuf == dmabuf) {
-				out = buffer;
-				list_move_tail(&buffer->link, &buffer->dma->static_list);
-				break;
-			}
-		}
-	}
+	out = mpp_dma_get_buffer(dma, dmabuf);
 
-	mutex_unlock(&dma->list_mutex);
 	dma_buf_put(dmabuf);
 
 	return out;
@@ -79,15 +104,19 @@ static void mpp_dma_release_buffer(struct kref *ref)
 {
 	struct mpp_dma_buffer *buffer =
 		container_of(ref, struct mpp_dma_buffer, ref);
+	struct dma_buf *dmabuf = buffer->dmabuf;
 
 	buffer->dma->buffer_count--;
+	hash_del_rcu(&buffer->node);
+	WRITE_ONCE(buffer->dmabuf, NULL);
+	/* lookups may still walk the node until this grace period ends */
+	buffer->rcu_gp = get_state_synchronize_rcu();
 	list_move_tail(&buffer->link, &buffer->dma->unused_list);
 
 	dma_buf_unmap_attachment(buffer->attach, buffer->sgt, buffer->dir);
-	dma_buf_detach(buffer->dmabuf, buffer->attach);
-	dma_buf_put(buffer->dmabuf);
+	dma_buf_detach(dmabuf, buffer->attach);
+	dma_buf_put(dmabuf);
 	buffer->dma = NULL;
-	buffer->dmabuf = NULL;
 	buffer->attach = NULL;
 	buffer->sgt = NULL;
 	buffer->copy_sgt = NULL;
@@ -97,7 +126,11 @@ static void mpp_dma_release_buffer(struct kref *ref)
 	buffer->last_used = 0;
 }
 
-/* Remove the oldest buffer when count more than the setting */
+/*
+ * Remove the least recently used buffer when count more than the setting.
+ * Lookups only stamp last_used instead of reordering used_list, so that
+ * they can stay lockless, thus the lru buffer is picked by the stamp here.
+ */
 static int
 mpp_dma_remove_extra_buffer(struct mpp_dma_session *dma)
 {
@@ -109,10 +142,12 @@ mpp_dma_remove_extra_buffer(struct mpp_dma_session *dma)
 		list_for_each_entry_safe(buffer, n,
 					 &dma->used_list,
 					 link) {
-			if (kref_read(&buffer->ref) == 1) {
+			if (kref_read(&buffer->ref) != 1)
+				continue;
+			if (!removable ||
+			    ktime_before(READ_ONCE(buffer->last_used),
+					 READ_ONCE(removable->last_used)))
 				removable = buffer;
-				break;
-			}
 		}
 		if (removable)
 			kref_put(&removable->ref, mpp_dma_release_buffer);
@@ -144,8 +179,10 @@ int mpp_dma_release_fd(struct mpp_dma_session *dma, int fd)
 		return -EINVAL;
 	}
 
+	/* drop the reference of the lookup and the one of the import */
 	mutex_lock(&dma->list_mutex);
 	kref_put(&buffer->ref, mpp_dma_release_buffer);
+	kref_put(&buffer->ref, mpp_dma_release_buffer);
 	mutex_unlock(&dma->list_mutex);
 
 	return 0;
@@ -190,38 +227,21 @@ int mpp_dma_free(struct mpp_dma_buffer *buffer)
 	return 0;
 }
 
-struct mpp_dma_buffer *mpp_dma_import_fd(struct mpp_iommu_info *iommu_info,
-					 struct mpp_dma_session *dma,
-					 int fd, int static_use)
+/* Import dmabuf into the session, taking over the dmabuf reference */
+static struct mpp_dma_buffer *
+mpp_dma_import_dmabuf(struct mpp_dma_session *dma, struct dma_buf *dmabuf,
+		      int static_use)
 {
 	int ret = 0;
 	struct sg_table *sgt;
-	struct dma_buf *dmabuf;
 	struct mpp_dma_buffer *buffer;
 	struct dma_buf_attachment *attach;
 
-	if (!dma) {
-		mpp_err("dma session is null\n");
-		return ERR_PTR(-EINVAL);
-	}
-
-	/* remove the oldest before add buffer */
-	if (!IS_ENABLED(CONFIG_DMABUF_CACHE))
-		mpp_dma_remove_extra_buffer(dma);
-
 	/* Check whether in dma session */
-	buffer = mpp_dma_find_buffer_fd(dma, fd);
-	if (!IS_ERR_OR_NULL(buffer)) {
-		if (kref_get_unless_zero(&buffer->ref))
-			return buffer;
-		dev_dbg(dma->dev, "missing the fd %d\n", fd);
-	}
-
-	dmabuf = dma_buf_get(fd);
-	if (IS_ERR(dmabuf)) {
-		ret = PTR_ERR(dmabuf);
-		mpp_err("dma_buf_get fd %d failed(%d)\n", fd, ret);
-		return ERR_PTR(ret);
+	buffer = mpp_dma_get_buffer(dma, dmabuf);
+	if (buffer) {
+		dma_buf_put(dmabuf);
+		return buffer;
 	}
 	/* A new DMA buffer */
 	mutex_lock(&dma->list_mutex);
@@ -236,20 +256,22 @@ struct mpp_dma_buffer *mpp_dma_import_fd(struct mpp_iommu_info *iommu_info,
 	list_del_init(&buffer->link);
 	mutex_unlock(&dma->list_mutex);
 
-	buffer->dmabuf = dmabuf;
+	/* the slot may still be walked by lookups of its previous dmabuf */
+	cond_synchronize_rcu(buffer->rcu_gp);
+
 	buffer->dir = DMA_BIDIRECTIONAL;
 
-	attach = dma_buf_attach(buffer->dmabuf, dma->dev);
+	attach = dma_buf_attach(dmabuf, dma->dev);
 	if (IS_ERR(attach)) {
 		ret = PTR_ERR(attach);
-		mpp_err("dma_buf_attach fd %d failed(%d)\n", fd, ret);
+		mpp_err("dma_buf_attach failed(%d)\n", ret);
 		goto fail_attach;
 	}
 
 	sgt = dma_buf_map_attachment(attach, buffer->dir);
 	if (IS_ERR(sgt)) {
 		ret = PTR_ERR(sgt);
-		mpp_err("dma_buf_map_attachment fd %d failed(%d)\n", fd, ret);
+		mpp_err("dma_buf_map_attachment failed(%d)\n", ret);
 		goto fail_map;
 	}
 	buffer->iova = sg_dma_address(sgt->sgl);
@@ -257,6 +279,7 @@ struct mpp_dma_buffer *mpp_dma_import_fd(struct mpp_iommu_info *iommu_info,
 	buffer->attach = attach;
 	buffer->sgt = sgt;
 	buffer->dma = dma;
+	buffer->last_used = ktime_get();
 
 	kref_init(&buffer->ref);
 
@@ -270,12 +293,15 @@ struct mpp_dma_buffer *mpp_dma_import_fd(struct mpp_iommu_info *iommu_info,
 		list_add_tail(&buffer->link, &dma->static_list);
 	else
 		list_add_tail(&buffer->link, &dma->used_list);
+	/* publish after the buffer is fully set up */
+	WRITE_ONCE(buffer->dmabuf, dmabuf);
+	hash_add_rcu(dma->buf_hash, &buffer->node, (unsigned long)dmabuf);
 	mutex_unlock(&dma->list_mutex);
 
 	return buffer;
 
 fail_map:
-	dma_buf_detach(buffer->dmabuf, attach);
+	dma_buf_detach(dmabuf, attach);
 fail_attach:
 	mutex_lock(&dma->list_mutex);
 	list_add_tail(&buffer->link, &dma->unused_list);
@@ -285,6 +311,32 @@ struct mpp_dma_buffer *mpp_dma_import_fd(struct mpp_iommu_info *iommu_info,
 	return ERR_PTR(ret);
 }
 
+struct mpp_dma_buffer *mpp_dma_import_fd(struct mpp_iommu_info *iommu_info,
+					 struct mpp_dma_session *dma,
+					 int fd, int static_use)
+{
+	struct dma_buf *dmabuf;
+	int ret;
+
+	if (!dma) {
+		mpp_err("dma session is null\n");
+		return ERR_PTR(-EINVAL);
+	}
+
+	/* remove the oldest before add buffer */
+	if (!IS_ENABLED(CONFIG_DMABUF_CACHE))
+		mpp_dma_remove_extra_buffer(dma);
+
+	dmabuf = dma_buf_get(fd);
+	if (IS_ERR(dmabuf)) {
+		ret = PTR_ERR(dmabuf);
+		mpp_err("dma_buf_get fd %d failed(%d)\n", fd, ret);
+		return ERR_PTR(ret);
+	}
+
+	return mpp_dma_import_dmabuf(dma, dmabuf, static_use);
+}
+
 int mpp_dma_unmap_kernel(struct mpp_dma_session *dma,
 			 struct mpp_dma_buffer *buffer)
 {
@@ -376,6 +428,7 @@ mpp_dma_session_create(struct device *dev, u32 max_buffers)
 	INIT_LIST_HEAD(&dma->unused_list);
 	INIT_LIST_HEAD(&dma->used_list);
 	INIT_LIST_HEAD(&dma->static_list);
+	hash_init(dma->buf_hash);
 
 	if (max_buffers > MPP_SESSION_MAX_BUFFERS) {
 		mpp_debug(DEBUG_IOCTL, "session_max_buffer %d must less than %d\n",
@@ -389,6 +442,8 @@ mpp_dma_session_create(struct device *dev, u32 max_buffers)
 		buffer = &dma->dma_bufs[i];
 		buffer->dma = dma;
 		INIT_LIST_HEAD(&buffer->link);
+		INIT_HLIST_NODE(&buffer->node);
+		buffer->rcu_gp = get_completed_synchronize_rcu();
 		list_add_tail(&buffer->link, &dma->unused_list);
 	}
 	dma->dev = dev;
@@ -687,3 +742,7 @@ int mpp_iommu_reserve_iova(struct mpp_iommu_info *info, dma_addr_t iova, size_t
 	return 0;
 
 }
+
+#ifdef CONFIG_ROCKCHIP_MPP_KUNIT_TEST
+#include "mpp_iommu_test.c"
+#endif
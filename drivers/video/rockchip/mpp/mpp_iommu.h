@@ -13,6 +13,7 @@
 
 #include <linux/iommu.h>
 #include <linux/dma-mapping.h>
+#include <linux/hashtable.h>
 #include <linux/interrupt.h>
 #include <linux/iova.h>
 
@@ -31,6 +32,8 @@ struct mpp_iommu_dma_cookie {
 struct mpp_dma_buffer {
 	/* link to dma session buffer list */
 	struct list_head link;
+	/* link to dma session import cache, keyed by dmabuf */
+	struct hlist_node node;
 
 	/* dma session belong */
 	struct mpp_dma_session *dma;
@@ -47,11 +50,14 @@ struct mpp_dma_buffer {
 
 	struct kref ref;
 	ktime_t last_used;
+	/* rcu state at release, the slot is reused after its grace period */
+	unsigned long rcu_gp;
 	/* alloc by device */
 	struct device *dev;
 };
 
 #define MPP_SESSION_MAX_BUFFERS		60
+#define MPP_SESSION_BUF_HASH_BITS	6
 
 struct mpp_dma_session {
 	/* the buffer used in session */
@@ -64,6 +70,11 @@ struct mpp_dma_session {
 	 */
 	struct list_head static_list;
 	struct mpp_dma_buffer dma_bufs[MPP_SESSION_MAX_BUFFERS];
+	/*
+	 * Import cache for buffers on used_list and static_list.
+	 * Readers walk it under rcu, writers hold list_mutex.
+	 */
+	DECLARE_HASHTABLE(buf_hash, MPP_SESSION_BUF_HASH_BITS);
 	/* the mutex for the above buffer list */
 	struct mutex list_mutex;
 	/* the max buffer num for the buffer list */
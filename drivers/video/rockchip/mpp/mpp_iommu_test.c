@@ -0,0 +1,237 @@
+// SPDX-License-Identifier: (GPL-2.0+ OR MIT)
+/*
+ * KUnit tests of the dma-buf import cache, included by mpp_iommu.c
+ *
+ * Copyright (c) 2024 Rockchip Electronics Co., Ltd.
+ */
+#include <kunit/test.h>
+#include <linux/device.h>
+#include <linux/sizes.h>
+
+/* software exporter, its buffers are never accessed by a device */
+static struct sg_table *mpp_test_map_dma_buf(struct dma_buf_attachment *attach,
+					     enum dma_data_direction dir)
+{
+	struct sg_table *sgt;
+
+	sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
+	if (!sgt)
+		return ERR_PTR(-ENOMEM);
+	if (sg_alloc_table(sgt, 1, GFP_KERNEL)) {
+		kfree(sgt);
+		return ERR_PTR(-ENOMEM);
+	}
+	sg_dma_address(sgt->sgl) = (dma_addr_t)(uintptr_t)attach->dmabuf->priv;
+	sg_dma_len(sgt->sgl) = PAGE_SIZE;
+
+	return sgt;
+}
+
+static void mpp_test_unmap_dma_buf(struct dma_buf_attachment *attach,
+				   struct sg_table *sgt,
+				   enum dma_data_direction dir)
+{
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+static void mpp_test_release(struct dma_buf *dmabuf)
+{
+}
+
+static const struct dma_buf_ops mpp_test_dmabuf_ops = {
+	.map_dma_buf = mpp_test_map_dma_buf,
+	.unmap_dma_buf = mpp_test_unmap_dma_buf,
+	.release = mpp_test_release,
+};
+
+struct mpp_iommu_test {
+	struct device *dev;
+	struct mpp_dma_session *dma;
+	struct dma_buf *dmabuf[3];
+};
+
+static int mpp_iommu_test_init(struct kunit *test)
+{
+	struct mpp_iommu_test *t;
+	int i;
+
+	t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, t);
+	/* the exit op releases whatever was set up */
+	test->priv = t;
+
+	t->dev = root_device_register("mpp_iommu_test");
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, t->dev);
+	t->dma = mpp_dma_session_create(t->dev, 2);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, t->dma);
+
+	for (i = 0; i < ARRAY_SIZE(t->dmabuf); i++) {
+		DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+
+		exp_info.ops = &mpp_test_dmabuf_ops;
+		exp_info.size = PAGE_SIZE;
+		exp_info.flags = O_RDWR;
+		exp_info.priv = (void *)(uintptr_t)((i + 1) * SZ_1M);
+		t->dmabuf[i] = dma_buf_export(&exp_info);
+		KUNIT_ASSERT_NOT_ERR_OR_NULL(test, t->dmabuf[i]);
+	}
+
+	return 0;
+}
+
+static void mpp_iommu_test_exit(struct kunit *test)
+{
+	struct mpp_iommu_test *t = test->priv;
+	int i;
+
+	if (!t)
+		return;
+	if (!IS_ERR_OR_NULL(t->dma))
+		mpp_dma_session_destroy(t->dma);
+	for (i = 0; i < ARRAY_SIZE(t->dmabuf); i++)
+		if (!IS_ERR_OR_NULL(t->dmabuf[i]))
+			dma_buf_put(t->dmabuf[i]);
+	if (!IS_ERR_OR_NULL(t->dev))
+		root_device_unregister(t->dev);
+}
+
+/* import keeping the test reference, as dma_buf_get() does for an fd */
+static struct mpp_dma_buffer *
+mpp_test_import(struct mpp_iommu_test *t, int i, int static_use)
+{
+	get_dma_buf(t->dmabuf[i]);
+	return mpp_dma_import_dmabuf(t->dma, t->dmabuf[i], static_use);
+}
+
+static void mpp_iommu_test_import_hit(struct kunit *test)
+{
+	struct mpp_iommu_test *t = test->priv;
+	struct mpp_dma_buffer *buffer, *again;
+
+	buffer = mpp_test_import(t, 0, 0);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buffer);
+	KUNIT_EXPECT_EQ(test, buffer->iova, (dma_addr_t)SZ_1M);
+	/* the session reference and the one of the task */
+	KUNIT_EXPECT_EQ(test, kref_read(&buffer->ref), 2);
+
+	again = mpp_test_import(t, 0, 0);
+	KUNIT_EXPECT_PTR_EQ(test, again, buffer);
+	KUNIT_EXPECT_EQ(test, kref_read(&buffer->ref), 3);
+	KUNIT_EXPECT_EQ(test, t->dma->buffer_count, 1);
+
+	mpp_dma_release(t->dma, again);
+	mpp_dma_release(t->dma, buffer);
+}
+
+static void mpp_iommu_test_get_ref(struct kunit *test)
+{
+	struct mpp_iommu_test *t = test->priv;
+	struct mpp_dma_buffer *buffer, *found;
+
+	buffer = mpp_test_import(t, 0, 1);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buffer);
+	KUNIT_EXPECT_EQ(test, kref_read(&buffer->ref), 1);
+
+	found = mpp_dma_get_buffer(t->dma, t->dmabuf[0]);
+	KUNIT_EXPECT_PTR_EQ(test, found, buffer);
+	KUNIT_EXPECT_EQ(test, kref_read(&buffer->ref), 2);
+	KUNIT_EXPECT_NULL(test, mpp_dma_get_buffer(t->dma, t->dmabuf[1]));
+
+	mpp_dma_release(t->dma, found);
+	KUNIT_EXPECT_EQ(test, kref_read(&buffer->ref), 1);
+}
+
+static void mpp_iommu_test_release(struct kunit *test)
+{
+	struct mpp_iommu_test *t = test->priv;
+	struct mpp_dma_buffer *buffer, *found;
+
+	buffer = mpp_test_import(t, 0, 1);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buffer);
+	mpp_dma_release(t->dma, buffer);
+
+	KUNIT_EXPECT_EQ(test, t->dma->buffer_count, 0);
+	KUNIT_EXPECT_NULL(test, mpp_dma_get_buffer(t->dma, t->dmabuf[0]));
+
+	/* the released slot is found again once reimported */
+	buffer = mpp_test_import(t, 0, 1);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buffer);
+	found = mpp_dma_get_buffer(t->dma, t->dmabuf[0]);
+	KUNIT_EXPECT_PTR_EQ(test, found, buffer);
+	if (found)
+		mpp_dma_release(t->dma, found);
+	mpp_dma_release(t->dma, buffer);
+	KUNIT_EXPECT_EQ(test, t->dma->buffer_count, 0);
+}
+
+static void mpp_iommu_test_lru(struct kunit *test)
+{
+	struct mpp_iommu_test *t = test->priv;
+	struct mpp_dma_buffer *buffer[3], *found;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		buffer[i] = mpp_test_import(t, i, 0);
+		KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buffer[i]);
+		/* the task is done with it, the session keeps it cached */
+		mpp_dma_release(t->dma, buffer[i]);
+		udelay(1);
+	}
+	KUNIT_EXPECT_EQ(test, t->dma->buffer_count, 3);
+
+	/* use the oldest one again, so the second becomes the lru */
+	found = mpp_dma_get_buffer(t->dma, t->dmabuf[0]);
+	KUNIT_ASSERT_PTR_EQ(test, found, buffer[0]);
+	mpp_dma_release(t->dma, found);
+
+	mpp_dma_remove_extra_buffer(t->dma);
+	KUNIT_EXPECT_EQ(test, t->dma->buffer_count, 2);
+	KUNIT_EXPECT_NULL(test, mpp_dma_get_buffer(t->dma, t->dmabuf[1]));
+
+	for (i = 0; i < 3; i += 2) {
+		found = mpp_dma_get_buffer(t->dma, t->dmabuf[i]);
+		KUNIT_EXPECT_PTR_EQ(test, found, buffer[i]);
+		if (found)
+			mpp_dma_release(t->dma, found);
+	}
+}
+
+static void mpp_iommu_test_lru_busy(struct kunit *test)
+{
+	struct mpp_iommu_test *t = test->priv;
+	struct mpp_dma_buffer *buffer[3];
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		buffer[i] = mpp_test_import(t, i, 0);
+		KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buffer[i]);
+	}
+	/* only the last one is idle, the others are still used by tasks */
+	mpp_dma_release(t->dma, buffer[2]);
+
+	mpp_dma_remove_extra_buffer(t->dma);
+	KUNIT_EXPECT_EQ(test, t->dma->buffer_count, 2);
+	KUNIT_EXPECT_NULL(test, mpp_dma_get_buffer(t->dma, t->dmabuf[2]));
+
+	mpp_dma_release(t->dma, buffer[0]);
+	mpp_dma_release(t->dma, buffer[1]);
+}
+
+static struct kunit_case mpp_iommu_test_cases[] = {
+	KUNIT_CASE(mpp_iommu_test_import_hit),
+	KUNIT_CASE(mpp_iommu_test_get_ref),
+	KUNIT_CASE(mpp_iommu_test_release),
+	KUNIT_CASE(mpp_iommu_test_lru),
+	KUNIT_CASE(mpp_iommu_test_lru_busy),
+	{}
+};
+
+static struct kunit_suite mpp_iommu_test_suite = {
+	.name = "rockchip_mpp_iommu",
+	.init = mpp_iommu_test_init,
+	.exit = mpp_iommu_test_exit,
+	.test_cases = mpp_iommu_test_cases,
+};
+
+kunit_test_suite(mpp_iommu_test_suite);
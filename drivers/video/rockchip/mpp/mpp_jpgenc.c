@@ -189,7 +189,7 @@ static int jpgenc_extract_task_msg(struct jpgenc_task *task, struct mpp_task_msg
 			if (ret)
 				continue;
 
-			if (copy_from_user((u8 *)task->reg + req->offset, req->data, req->size)) {
+			if (mpp_msgs_copy_from_user(msgs, (u8 *)task->reg + req->offset, req->data, req->size)) {
 				mpp_err("copy_from_user reg failed\n");
 				return -EIO;
 			}
@@ -207,7 +207,7 @@ static int jpgenc_extract_task_msg(struct jpgenc_task *task, struct mpp_task_msg
 			memcpy(&task->r_reqs[task->r_req_cnt++], req, sizeof(*req));
 		} break;
 		case MPP_CMD_SET_REG_ADDR_OFFSET: {
-			mpp_extract_reg_offset_info(&task->off_inf, req);
+			mpp_extract_reg_offset_info(msgs, &task->off_inf, req);
 		} break;
 		default:
 			break;
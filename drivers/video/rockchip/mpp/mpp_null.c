@@ -0,0 +1,311 @@
+// SPDX-License-Identifier: (GPL-2.0+ OR MIT)
+/*
+ * Copyright (c) 2024 Rockchip Electronics Co., Ltd
+ *
+ * Null software device, which completes every task once it is run.
+ * It has no register, clock, irq or iommu, and is used to measure the
+ * overhead of the mpp service ioctl, message parsing and task queue.
+ *
+ */
+#include <linux/module.h>
+#include <linux/of_platform.h>
+#include <linux/proc_fs.h>
+#include <linux/slab.h>
+#include <linux/types.h>
+#include <linux/uaccess.h>
+
+#include "mpp_debug.h"
+#include "mpp_common.h"
+#include "mpp_iommu.h"
+
+#define NULL_DRIVER_NAME		"mpp_null"
+
+#define NULL_SESSION_MAX_BUFFERS	20
+/* registers buffered for the task, as much as a real codec */
+#define NULL_REG_NUM			512
+
+#define to_null_task(task)		\
+		container_of(task, struct null_task, mpp_task)
+#define to_null_dev(dev)		\
+		container_of(dev, struct null_dev, mpp)
+
+struct null_task {
+	struct mpp_task mpp_task;
+
+	u32 reg[NULL_REG_NUM];
+	/* req for current task */
+	u32 r_req_cnt;
+	struct mpp_request r_reqs[MPP_MAX_MSG_NUM];
+};
+
+struct null_dev {
+	struct mpp_dev mpp;
+
+#ifdef CONFIG_ROCKCHIP_MPP_PROC_FS
+	struct proc_dir_entry *procfs;
+#endif
+};
+
+static struct mpp_hw_info null_hw_info = {
+	/* no register space, see mpp_dev_probe */
+	.reg_num = 0,
+	.reg_id = -1,
+	.reg_start = 0,
+	.reg_end = NULL_REG_NUM - 1,
+	.reg_en = -1,
+};
+
+static int null_extract_task_msg(struct null_task *task,
+				 struct mpp_task_msgs *msgs)
+{
+	u32 i;
+	int ret;
+	struct mpp_request *req;
+
+	for (i = 0; i < msgs->req_cnt; i++) {
+		req = &msgs->reqs[i];
+		if (!req->size)
+			continue;
+
+		switch (req->cmd) {
+		case MPP_CMD_SET_REG_WRITE: {
+			ret = mpp_check_req(req, 0, sizeof(task->reg), 0, 0);
+			if (ret)
+				continue;
+			if (mpp_msgs_copy_from_user(msgs, (u8 *)task->reg + req->offset,
+						    req->data, req->size)) {
+				mpp_err("copy_from_user reg failed\n");
+				return -EIO;
+			}
+		} break;
+		case MPP_CMD_SET_REG_READ: {
+			ret = mpp_check_req(req, 0, sizeof(task->reg), 0, 0);
+			if (ret)
+				continue;
+			memcpy(&task->r_reqs[task->r_req_cnt++],
+			       req, sizeof(*req));
+		} break;
+		default:
+			break;
+		}
+	}
+	mpp_debug(DEBUG_TASK_INFO, "r_req_cnt %d\n", task->r_req_cnt);
+
+	return 0;
+}
+
+static void *null_alloc_task(struct mpp_session *session,
+			     struct mpp_task_msgs *msgs)
+{
+	int ret;
+	struct mpp_task *mpp_task = NULL;
+	struct null_task *task = NULL;
+	struct mpp_dev *mpp = session->mpp;
+
+	mpp_debug_enter();
+
+	task = kzalloc(sizeof(*task), GFP_KERNEL);
+	if (!task)
+		return NULL;
+
+	mpp_task = &task->mpp_task;
+	mpp_task_init(session, mpp_task);
+	mpp_task->hw_info = mpp->var->hw_info;
+	mpp_task->reg = task->reg;
+	/* extract reqs for current task */
+	ret = null_extract_task_msg(task, msgs);
+	if (ret) {
+		kfree(task);
+		return NULL;
+	}
+
+	mpp_debug_leave();
+
+	return mpp_task;
+}
+
+static int null_run(struct mpp_dev *mpp,
+		    struct mpp_task *mpp_task)
+{
+	u32 timing_en = mpp->srv->timing_en;
+
+	mpp_debug_enter();
+
+	if (timing_en) {
+		mpp_task->on_run_end = ktime_get();
+		set_bit(TASK_TIMING_RUN_END, &mpp_task->state);
+	}
+
+	/* nothing to run, the task is done at once */
+	set_bit(TASK_STATE_START, &mpp_task->state);
+	set_bit(TASK_STATE_HANDLE, &mpp_task->state);
+	set_bit(TASK_STATE_IRQ, &mpp_task->state);
+	mpp_task_finish(mpp_task->session, mpp_task);
+
+	mpp_debug_leave();
+
+	return 0;
+}
+
+static int null_result(struct mpp_dev *mpp,
+		       struct mpp_task *mpp_task,
+		       struct mpp_task_msgs *msgs)
+{
+	u32 i;
+	struct mpp_request *req;
+	struct null_task *task = to_null_task(mpp_task);
+
+	for (i = 0; i < task->r_req_cnt; i++) {
+		req = &task->r_reqs[i];
+
+		if (copy_to_user(req->data,
+				 (u8 *)task->reg + req->offset,
+				 req->size)) {
+			mpp_err("copy_to_user reg fail\n");
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+static int null_free_task(struct mpp_session *session,
+			  struct mpp_task *mpp_task)
+{
+	struct null_task *task = to_null_task(mpp_task);
+
+	mpp_task_finalize(session, mpp_task);
+	kfree(task);
+
+	return 0;
+}
+
+#ifdef CONFIG_ROCKCHIP_MPP_PROC_FS
+static int null_procfs_remove(struct mpp_dev *mpp)
+{
+	struct null_dev *dev = to_null_dev(mpp);
+
+	if (dev->procfs) {
+		proc_remove(dev->procfs);
+		dev->procfs = NULL;
+	}
+
+	return 0;
+}
+
+static int null_procfs_init(struct mpp_dev *mpp)
+{
+	struct null_dev *dev = to_null_dev(mpp);
+
+	dev->procfs = proc_mkdir(mpp->dev->of_node->name, mpp->srv->procfs);
+	if (IS_ERR_OR_NULL(dev->procfs)) {
+		mpp_err("failed on open procfs\n");
+		dev->procfs = NULL;
+		return -EIO;
+	}
+
+	/* for common mpp_dev options */
+	mpp_procfs_create_common(dev->procfs, mpp);
+
+	mpp_procfs_create_u32("session_buffers", 0644,
+			      dev->procfs, &mpp->session_max_buffers);
+
+	return 0;
+}
+#else
+static inline int null_procfs_remove(struct mpp_dev *mpp)
+{
+	return 0;
+}
+
+static inline int null_procfs_init(struct mpp_dev *mpp)
+{
+	return 0;
+}
+#endif
+
+static struct mpp_hw_ops null_hw_ops = {
+};
+
+static struct mpp_dev_ops null_dev_ops = {
+	.alloc_task = null_alloc_task,
+	.run = null_run,
+	.result = null_result,
+	.free_task = null_free_task,
+};
+
+static const struct mpp_dev_var null_data = {
+	.device_type = MPP_DEVICE_NULL,
+	.hw_info = &null_hw_info,
+	.hw_ops = &null_hw_ops,
+	.dev_ops = &null_dev_ops,
+};
+
+static const struct of_device_id mpp_null_dt_match[] = {
+	{
+		.compatible = "rockchip,mpp-null",
+		.data = &null_data,
+	},
+	{},
+};
+
+static int null_probe(struct platform_device *pdev)
+{
+	int ret = 0;
+	struct device *dev = &pdev->dev;
+	struct null_dev *null_dev = NULL;
+	struct mpp_dev *mpp = NULL;
+	const struct of_device_id *match = NULL;
+
+	dev_info(dev, "probe device\n");
+	null_dev = devm_kzalloc(dev, sizeof(struct null_dev), GFP_KERNEL);
+	if (!null_dev)
+		return -ENOMEM;
+	mpp = &null_dev->mpp;
+	platform_set_drvdata(pdev, mpp);
+
+	if (pdev->dev.of_node) {
+		match = of_match_node(mpp_null_dt_match, pdev->dev.of_node);
+		if (match)
+			mpp->var = (struct mpp_dev_var *)match->data;
+
+		mpp->core_id = -1;
+	}
+
+	ret = mpp_dev_probe(mpp, pdev);
+	if (ret) {
+		dev_err(dev, "probe sub driver failed\n");
+		return -EINVAL;
+	}
+
+	mpp->session_max_buffers = NULL_SESSION_MAX_BUFFERS;
+	null_procfs_init(mpp);
+	/* register current device to mpp service */
+	mpp_dev_register_srv(mpp, mpp->srv);
+	dev_info(dev, "probing finish\n");
+
+	return 0;
+}
+
+static int null_remove(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct mpp_dev *mpp = dev_get_drvdata(dev);
+
+	dev_info(dev, "remove device\n");
+	mpp_dev_remove(mpp);
+	null_procfs_remove(mpp);
+
+	return 0;
+}
+
+struct platform_driver rockchip_null_driver = {
+	.probe = null_probe,
+	.remove = null_remove,
+	.shutdown = mpp_dev_shutdown,
+	.driver = {
+		.name = NULL_DRIVER_NAME,
+		.of_match_table = of_match_ptr(mpp_null_dt_match),
+	},
+};
+EXPORT_SYMBOL(rockchip_null_driver);
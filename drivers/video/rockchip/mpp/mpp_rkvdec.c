@@ -674,8 +674,8 @@ static int rkvdec_extract_task_msg(struct rkvdec_task *task,
 					    off_s, off_e);
 			if (ret)
 				continue;
-			if (copy_from_user((u8 *)task->reg + req->offset,
-					   req->data, req->size)) {
+			if (mpp_msgs_copy_from_user(msgs, (u8 *)task->reg + req->offset,
+						    req->data, req->size)) {
 				mpp_err("copy_from_user reg failed\n");
 				return -EIO;
 			}
@@ -693,7 +693,7 @@ static int rkvdec_extract_task_msg(struct rkvdec_task *task,
 			       req, sizeof(*req));
 		} break;
 		case MPP_CMD_SET_REG_ADDR_OFFSET: {
-			mpp_extract_reg_offset_info(&task->off_inf, req);
+			mpp_extract_reg_offset_info(msgs, &task->off_inf, req);
 		} break;
 		default:
 			break;
@@ -190,7 +190,8 @@ static struct mpp_trans_info rkvdec_vdpu383_trans[] = {
 	}
 };
 
-static int mpp_extract_rcb_info(struct rkvdec2_rcb_info *rcb_inf,
+static int mpp_extract_rcb_info(struct mpp_task_msgs *msgs,
+				struct rkvdec2_rcb_info *rcb_inf,
 				struct mpp_request *req)
 {
 	u32 max_size = ARRAY_SIZE(rcb_inf->elem);
@@ -200,7 +201,7 @@ static int mpp_extract_rcb_info(struct rkvdec2_rcb_info *rcb_inf,
 		mpp_err("count %d,max_size %d\n", cnt, max_size);
 		return -EINVAL;
 	}
-	if (copy_from_user(rcb_inf->elem, req->data, req->size)) {
+	if (mpp_msgs_copy_from_user(msgs, rcb_inf->elem, req->data, req->size)) {
 		mpp_err("copy_from_user failed\n");
 		return -EINVAL;
 	}
@@ -232,8 +233,8 @@ static int rkvdec2_extract_task_msg(struct mpp_session *session,
 			ret = mpp_check_req(req, 0, sizeof(task->reg), off_s, off_e);
 			if (ret)
 				continue;
-			if (copy_from_user((u8 *)task->reg + req->offset,
-					   req->data, req->size)) {
+			if (mpp_msgs_copy_from_user(msgs, (u8 *)task->reg + req->offset,
+						    req->data, req->size)) {
 				mpp_err("copy_from_user reg failed\n");
 				return -EIO;
 			}
@@ -258,13 +259,13 @@ static int rkvdec2_extract_task_msg(struct mpp_session *session,
 			memcpy(&task->r_reqs[task->r_req_cnt++], req, sizeof(*req));
 		} break;
 		case MPP_CMD_SET_REG_ADDR_OFFSET: {
-			mpp_extract_reg_offset_info(&task->off_inf, req);
+			mpp_extract_reg_offset_info(msgs, &task->off_inf, req);
 		} break;
 		case MPP_CMD_SET_RCB_INFO: {
 			struct rkvdec2_session_priv *priv = session->priv;
 
 			if (priv)
-				mpp_extract_rcb_info(&priv->rcb_inf, req);
+				mpp_extract_rcb_info(msgs, &priv->rcb_inf, req);
 		} break;
 		default:
 			break;
@@ -314,10 +315,20 @@ int mpp_set_rcbbuf(struct mpp_dev *mpp, struct mpp_session *session,
 	return 0;
 }
 
+/* relative decoding cost per macroblock of each format */
+static const u32 rkvdec2_fmt_weight[] = {
+	[RKVDEC_FMT_H265D]	= 4,
+	[RKVDEC_FMT_H264D]	= 3,
+	[RKVDEC_FMT_VP9D]	= 4,
+	[RKVDEC_FMT_AVS2]	= 5,
+	[RKVDEC_FMT_AV1D]	= 6,
+};
+
 int rkvdec2_task_init(struct mpp_dev *mpp, struct mpp_session *session,
 		      struct rkvdec2_task *task, struct mpp_task_msgs *msgs)
 {
 	int ret;
+	u32 fmt, weight;
 	struct mpp_task *mpp_task = &task->mpp_task;
 
 	mpp_debug_enter();
@@ -359,6 +370,10 @@ int rkvdec2_task_init(struct mpp_dev *mpp, struct mpp_session *session,
 		mpp_debug(DEBUG_TASK_INFO, "width=%d, bitdepth=%d, height=%d\n",
 			  width, bitdepth, task->height);
 	}
+	/* estimated cost for multi-core balance */
+	fmt = RKVDEC_GET_FORMAT(task->reg[mpp_task->hw_info->reg_fmt]);
+	weight = fmt < ARRAY_SIZE(rkvdec2_fmt_weight) ? rkvdec2_fmt_weight[fmt] : 1;
+	mpp_task->cost = mpp_task_calc_cost(task->width, task->height, weight);
 
 	mpp_debug_leave();
 
@@ -2020,7 +2035,7 @@ static int __maybe_unused rkvdec2_runtime_suspend(struct device *dev)
 
 		if (mpp->is_irq_startup) {
 			/* disable core irq */
-			disable_irq(mpp->irq);
+			mpp_dev_disable_irq(mpp);
 			if (mpp->iommu_info && mpp->iommu_info->got_irq)
 				/* disable mmu irq */
 				disable_irq(mpp->iommu_info->irq);
@@ -2055,7 +2070,7 @@ static int __maybe_unused rkvdec2_runtime_resume(struct device *dev)
 			mpp->hw_ops->clk_on(mpp);
 		if (mpp->is_irq_startup) {
 			/* enable core irq */
-			enable_irq(mpp->irq);
+			mpp_dev_enable_irq(mpp);
 			/* enable mmu irq */
 			if (mpp->iommu_info && mpp->iommu_info->got_irq)
 				enable_irq(mpp->iommu_info->irq);
@@ -571,7 +571,7 @@ static int rkvdec2_link_reset(struct mpp_dev *mpp)
 
 	dev_info(mpp->dev, "resetting...\n");
 
-	disable_irq(mpp->irq);
+	mpp_dev_disable_irq(mpp);
 	mpp_iommu_disable_irq(mpp->iommu_info);
 
 	/* FIXME lock resource lock of the other devices in combo */
@@ -595,7 +595,7 @@ static int rkvdec2_link_reset(struct mpp_dev *mpp)
 	mpp_reset_up_write(mpp->reset_group);
 	mpp_iommu_up_write(mpp->iommu_info);
 
-	enable_irq(mpp->irq);
+	mpp_dev_enable_irq(mpp);
 	mpp_iommu_enable_irq(mpp->iommu_info);
 	dev_info(mpp->dev, "reset done\n");
 
@@ -880,7 +880,7 @@ static int rkvdec2_link_power_on(struct mpp_dev *mpp)
 			mpp->hw_ops->clk_on(mpp);
 
 		if (!link_dec->irq_enabled) {
-			enable_irq(mpp->irq);
+			mpp_dev_enable_irq(mpp);
 			mpp_iommu_enable_irq(mpp->iommu_info);
 			link_dec->irq_enabled = 1;
 		}
@@ -900,7 +900,7 @@ static void rkvdec2_link_power_off(struct mpp_dev *mpp)
 	struct rkvdec_link_dev *link_dec = dec->link_dec;
 
 	if (atomic_xchg(&link_dec->power_enabled, 0)) {
-		disable_irq(mpp->irq);
+		mpp_dev_disable_irq(mpp);
 		mpp_iommu_disable_irq(mpp->iommu_info);
 		link_dec->irq_enabled = 0;
 
@@ -1127,7 +1127,9 @@ static void rkvdec2_link_try_dequeue(struct mpp_dev *mpp)
 				atomic_inc(&mpp->reset_request);
 		}
 
+		mpp_task_stats_done(mpp, mpp_task);
 		wake_up(&mpp_task->wait);
+		mpp_session_notify_done(mpp_task->session);
 		kref_put(&mpp_task->ref, rkvdec2_link_free_task);
 	}
 
@@ -1660,17 +1662,22 @@ static int rkvdec2_soft_ccu_dequeue(struct mpp_taskqueue *queue)
 			set_bit(TASK_STATE_FINISH, &mpp_task->state);
 			set_bit(TASK_STATE_DONE, &mpp_task->state);
 
+			mpp_core_load_end(mpp, mpp_task);
 			set_bit(mpp->core_id, &queue->core_idle);
 			mpp_dbg_core("set core %d idle %lx\n", mpp->core_id, queue->core_idle);
+			mpp_task_stats_done(mpp, mpp_task);
 			/* Wake up the GET thread */
 			wake_up(&mpp_task->wait);
+			mpp_session_notify_done(mpp_task->session);
 			/* free task */
 			list_del_init(&mpp_task->queue_link);
 			kref_put(&mpp_task->ref, mpp_free_task);
-		} else {
-			/* NOTE: break when meet not finish */
-			break;
 		}
+		/*
+		 * NOTE: keep on when meet not finish, the cores run
+		 * independently and a finished core should be idle for
+		 * the pending tasks without waiting the earlier ones.
+		 */
 	}
 
 	mpp_debug_leave();
@@ -1692,7 +1699,8 @@ static int rkvdec2_soft_ccu_reset(struct mpp_taskqueue *queue,
 			continue;
 
 		dev_info(mpp->dev, "resetting for err %#x\n", mpp->irq_status);
-		disable_hardirq(mpp->irq);
+		if (mpp->irq >= 0)
+			disable_hardirq(mpp->irq);
 
 		/* foce idle, disconnect core and ccu */
 		writel(dec->core_mask, ccu->reg_base + RKVDEC_CCU_CORE_IDLE_BASE);
@@ -1727,7 +1735,7 @@ static int rkvdec2_soft_ccu_reset(struct mpp_taskqueue *queue,
 		mpp_iommu_refresh(mpp->iommu_info, mpp->dev);
 		atomic_set(&mpp->reset_request, 0);
 
-		enable_irq(mpp->irq);
+		mpp_dev_enable_irq(mpp);
 		dev_info(mpp->dev, "reset done\n");
 	}
 	atomic_set(&queue->reset_request, 0);
@@ -1959,35 +1967,23 @@ static int rkvdec2_soft_ccu_enqueue(struct mpp_dev *mpp, struct mpp_task *mpp_ta
 static struct mpp_dev *rkvdec2_get_idle_core(struct mpp_taskqueue *queue,
 					     struct mpp_task *mpp_task)
 {
-	u32 i = 0;
 	struct rkvdec2_dev *dec = NULL;
+	struct mpp_dev *mpp;
 
-	for (i = 0; i < queue->core_count; i++) {
-		struct mpp_dev *mpp = queue->cores[i];
-		struct rkvdec2_dev *core = to_rkvdec2_dev(mpp);
-
-		if (mpp->disable)
-			continue;
-
-		if (test_bit(i, &queue->core_idle)) {
-			if (!dec) {
-				dec = core;
-				continue;
-			}
-			/* set the less work core */
-			if (core->task_index < dec->task_index)
-				dec = core;
-		}
-	}
+	/* the core the task is queued to, or an idle one stealing it */
+	mpp = mpp_taskqueue_dispatch(queue, mpp_task, queue->core_idle);
 	/* if get core */
-	if (dec) {
-		mpp_task->mpp = &dec->mpp;
-		mpp_task->core_id = dec->mpp.core_id;
+	if (mpp) {
+		dec = to_rkvdec2_dev(mpp);
+		mpp_task->mpp = mpp;
+		mpp_task->core_id = mpp->core_id;
 		clear_bit(mpp_task->core_id, &queue->core_idle);
 		dec->task_index++;
-		atomic_inc(&dec->mpp.task_count);
-		mpp_dbg_core("clear core %d idle\n", mpp_task->core_id);
-		return mpp_task->mpp;
+		atomic_inc(&mpp->task_count);
+		mpp_core_load_begin(mpp, mpp_task);
+		mpp_dbg_core("clear core %d idle cost %u\n",
+			     mpp_task->core_id, mpp_task->cost);
+		return mpp;
 	}
 
 	return NULL;
@@ -2048,6 +2044,7 @@ void rkvdec2_soft_ccu_worker(struct kthread_work *work_s)
 		if (test_bit(TASK_STATE_ABORT, &mpp_task->state)) {
 			mutex_lock(&queue->pending_lock);
 			list_del_init(&mpp_task->queue_link);
+			mpp_taskqueue_unqueue_core(queue, mpp_task);
 
 			set_bit(TASK_STATE_ABORT_READY, &mpp_task->state);
 			set_bit(TASK_STATE_PROC_DONE, &mpp_task->state);
@@ -2263,8 +2260,11 @@ static int rkvdec2_hard_ccu_dequeue(struct mpp_taskqueue *queue,
 			list_move_tail(&task->table->link, &ccu->unused_list);
 			/* free task */
 			list_del_init(&mpp_task->queue_link);
+			mpp_task_stats_done(mpp_get_task_used_device(mpp_task, mpp_task->session),
+					    mpp_task);
 			/* Wake up the GET thread */
 			wake_up(&mpp_task->wait);
+			mpp_session_notify_done(mpp_task->session);
 			if ((irq_status & hw->err_mask) || timeout_flag) {
 				pr_err("session %d task %d irq_status %#x timeout=%u abort=%u\n",
 					mpp_task->session->index, mpp_task->task_index,
@@ -2304,7 +2304,8 @@ static int rkvdec2_hard_ccu_reset(struct mpp_taskqueue *queue, struct rkvdec2_cc
 		if (mpp->disable)
 			continue;
 		dev_info(mpp->dev, "resetting...\n");
-		disable_hardirq(mpp->irq);
+		if (mpp->irq >= 0)
+			disable_hardirq(mpp->irq);
 		/* force idle */
 		writel(dec->core_mask, ccu->reg_base + RKVDEC_CCU_CORE_IDLE_BASE);
 		writel(0, ccu->reg_base + RKVDEC_CCU_WORK_BASE);
@@ -2331,7 +2332,7 @@ static int rkvdec2_hard_ccu_reset(struct mpp_taskqueue *queue, struct rkvdec2_cc
 		rkvdec2_reset(mpp);
 #endif
 		mpp_iommu_refresh(mpp->iommu_info, mpp->dev);
-		enable_irq(mpp->irq);
+		mpp_dev_enable_irq(mpp);
 		atomic_set(&mpp->reset_request, 0);
 		val = mpp_read_relaxed(mpp, 272*4);
 		dev_info(mpp->dev, "reset done, idle %d\n", (val & 1));
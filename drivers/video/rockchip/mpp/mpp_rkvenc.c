@@ -283,7 +283,7 @@ static int rkvenc_extract_task_msg(struct rkvenc_task *task,
 				return ret;
 
 			dst += req->offset - req_base;
-			if (copy_from_user(dst, req->data, req->size)) {
+			if (mpp_msgs_copy_from_user(msgs, dst, req->data, req->size)) {
 				mpp_err("copy_from_user reg failed\n");
 				return -EIO;
 			}
@@ -311,7 +311,7 @@ static int rkvenc_extract_task_msg(struct rkvenc_task *task,
 			       req, sizeof(*req));
 		} break;
 		case MPP_CMD_SET_REG_ADDR_OFFSET: {
-			mpp_extract_reg_offset_info(&task->off_inf, req);
+			mpp_extract_reg_offset_info(msgs, &task->off_inf, req);
 		} break;
 		default:
 			break;
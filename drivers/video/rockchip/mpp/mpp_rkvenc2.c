@@ -793,7 +793,8 @@ static u32 *rkvenc_get_class_reg(struct rkvenc_task *task, u32 addr)
 	return (u32 *)reg;
 }
 
-static int rkvenc2_extract_rcb_info(struct rkvenc2_rcb_info *rcb_inf,
+static int rkvenc2_extract_rcb_info(struct mpp_task_msgs *msgs,
+				    struct rkvenc2_rcb_info *rcb_inf,
 				    struct mpp_request *req)
 {
 	int max_size = ARRAY_SIZE(rcb_inf->elem);
@@ -803,7 +804,7 @@ static int rkvenc2_extract_rcb_info(struct rkvenc2_rcb_info *rcb_inf,
 		mpp_err("count %d,max_size %d\n", cnt, max_size);
 		return -EINVAL;
 	}
-	if (copy_from_user(rcb_inf->elem, req->data, req->size)) {
+	if (mpp_msgs_copy_from_user(msgs, rcb_inf->elem, req->data, req->size)) {
 		mpp_err("copy_from_user failed\n");
 		return -EINVAL;
 	}
@@ -850,7 +851,7 @@ static int rkvenc_extract_task_msg(struct mpp_session *session,
 					ret = -EINVAL;
 					goto fail;
 				}
-				if (copy_from_user(data, wreq->data, wreq->size)) {
+				if (mpp_msgs_copy_from_user(msgs, data, wreq->data, wreq->size)) {
 					mpp_err("copy_from_user fail, offset %08x\n", wreq->offset);
 					ret = -EIO;
 					goto fail;
@@ -878,13 +879,13 @@ static int rkvenc_extract_task_msg(struct mpp_session *session,
 			}
 		} break;
 		case MPP_CMD_SET_REG_ADDR_OFFSET: {
-			mpp_extract_reg_offset_info(&task->off_inf, req);
+			mpp_extract_reg_offset_info(msgs, &task->off_inf, req);
 		} break;
 		case MPP_CMD_SET_RCB_INFO: {
 			struct rkvenc2_session_priv *priv = session->priv;
 
 			if (priv)
-				rkvenc2_extract_rcb_info(&priv->rcb_inf, req);
+				rkvenc2_extract_rcb_info(msgs, &priv->rcb_inf, req);
 		} break;
 		default:
 			break;
@@ -1034,6 +1035,13 @@ static void rkvenc2_check_split_task(struct mpp_dev *mpp, struct rkvenc_task *ta
 		INIT_KFIFO(task->slice_info);
 }
 
+/* relative encoding cost per macroblock of each format */
+static const u32 rkvenc2_fmt_weight[] = {
+	[RKVENC_FMT_H264E]	= 3,
+	[RKVENC_FMT_H265E]	= 4,
+	[RKVENC_FMT_JPEGE]	= 1,
+};
+
 static void *rkvenc_alloc_task(struct mpp_session *session,
 			       struct mpp_task_msgs *msgs)
 {
@@ -1061,6 +1069,16 @@ static void *rkvenc_alloc_task(struct mpp_session *session,
 	ret = rkvenc_task_get_format(mpp, task);
 	if (ret)
 		goto free_task;
+	/* estimated cost for multi-core balance */
+	if (session->priv) {
+		struct rkvenc2_session_priv *priv = session->priv;
+		u32 weight = task->fmt < ARRAY_SIZE(rkvenc2_fmt_weight) ?
+			     rkvenc2_fmt_weight[task->fmt] : 1;
+
+		mpp_task->cost = mpp_task_calc_cost(priv->codec_info[ENC_INFO_WIDTH].val,
+						    priv->codec_info[ENC_INFO_HEIGHT].val,
+						    weight);
+	}
 	/* process fd in register */
 	if (!(msgs->flags & MPP_FLAGS_REG_FD_NO_TRANS)) {
 		u32 i, j;
@@ -1143,38 +1161,33 @@ static void *rkvenc_alloc_task(struct mpp_session *session,
 static void *rkvenc2_prepare(struct mpp_dev *mpp, struct mpp_task *mpp_task)
 {
 	struct mpp_taskqueue *queue = mpp->queue;
+	struct mpp_dev *core;
 	unsigned long core_idle;
 	unsigned long flags;
-	u32 core_id_max;
-	s32 core_id;
-	u32 i;
-
-	spin_lock_irqsave(&queue->running_lock, flags);
 
+	/*
+	 * Only this worker marks cores busy, so the idle mask can not shrink
+	 * between the dispatch pick and taking the running lock.
+	 */
 	core_idle = queue->core_idle;
-	core_id_max = queue->core_id_max;
-
-	for (i = 0; i <= core_id_max; i++) {
-		struct mpp_dev *mpp = queue->cores[i];
+	core = mpp_taskqueue_dispatch(queue, mpp_task, core_idle);
 
-		if (mpp && mpp->disable)
-			clear_bit(i, &core_idle);
-	}
-
-	core_id = find_first_bit(&core_idle, core_id_max + 1);
+	spin_lock_irqsave(&queue->running_lock, flags);
 
-	if (core_id >= core_id_max + 1 || !queue->cores[core_id]) {
+	if (!core) {
 		mpp_task = NULL;
-		mpp_dbg_core("core %d all busy %lx\n", core_id, core_idle);
+		mpp_dbg_core("core all busy %lx\n", core_idle);
 	} else {
 		struct rkvenc_task *task = to_rkvenc_task(mpp_task);
+		s32 core_id = core->core_id;
 
 		clear_bit(core_id, &queue->core_idle);
-		mpp_task->mpp = queue->cores[core_id];
+		mpp_task->mpp = core;
 		mpp_task->core_id = core_id;
+		mpp_core_load_begin(core, mpp_task);
 		rkvenc2_set_rcbbuf(mpp_task->mpp, mpp_task->session, task);
-		mpp_dbg_core("core %d set idle %lx -> %lx\n", core_id,
-			     core_idle, queue->core_idle);
+		mpp_dbg_core("core %d set idle %lx -> %lx cost %u\n", core_id,
+			     core_idle, queue->core_idle, mpp_task->cost);
 	}
 
 	spin_unlock_irqrestore(&queue->running_lock, flags);
@@ -1719,6 +1732,7 @@ static int rkvenc_isr(struct mpp_dev *mpp)
 			mpp_task_dump_hw_reg(mpp);
 	}
 
+	mpp_core_load_end(mpp, mpp_task);
 	mpp_task_finish(mpp_task->session, mpp_task);
 
 	core_idle = queue->core_idle;
@@ -1805,6 +1819,8 @@ static int rkvenc_free_task(struct mpp_session *session,
 {
 	struct rkvenc_task *task = to_rkvenc_task(mpp_task);
 
+	if (task->bs_buf)
+		mpp_dma_release(session->dma, task->bs_buf);
 	mpp_task_finalize(session, mpp_task);
 	rkvenc_free_class_msg(task);
 	kfree(task);
@@ -2212,6 +2228,9 @@ static int rkvenc_reset(struct mpp_dev *mpp)
 		mpp_pmu_idle_request(mpp, false);
 	}
 
+	/* nothing left on the core after reset */
+	if (mpp->cur_task)
+		mpp_core_load_end(mpp, mpp->cur_task);
 	set_bit(mpp->core_id, &queue->core_idle);
 
 	spin_lock_irqsave(&ccu->lock_dchs, flags);
@@ -2310,6 +2329,7 @@ static void rkvenc2_task_timeout_process(struct mpp_session *session,
 		u32 end = RKVENC2_TIMEOUT_DUMP_REG_END;
 		u32 offset;
 
+		mpp_core_load_end(mpp, task);
 		dev_err(mpp->dev, "core %d dump timeout status:\n", mpp->core_id);
 
 		for (offset = start; offset < end; offset += sizeof(u32))
@@ -12,6 +12,7 @@
 
 #include <linux/completion.h>
 #include <linux/delay.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/of_platform.h>
 #include <linux/proc_fs.h>
@@ -41,6 +42,7 @@
 #define HAS_RKVENC2	IS_ENABLED(CONFIG_ROCKCHIP_MPP_RKVENC2)
 #define HAS_AV1DEC	IS_ENABLED(CONFIG_ROCKCHIP_MPP_AV1DEC)
 #define HAS_VDPP	IS_ENABLED(CONFIG_ROCKCHIP_MPP_VDPP)
+#define HAS_NULL	IS_ENABLED(CONFIG_ROCKCHIP_MPP_NULL)
 
 #define MPP_REGISTER_DRIVER(srv, flag, X, x) {\
 	if (flag)\
@@ -222,6 +224,11 @@ static int mpp_dump_session(struct mpp_session *session, struct seq_file *s)
 	seq_printf(s, "session: pid=%d index=%d\n", session->pid, session->index);
 	seq_printf(s, " device: %s\n", dev_name(session->mpp->dev));
 	seq_printf(s, " memory: %lu MiB\n", K(K(t)));
+	seq_printf(s, "  sched: prio=%u tasks=%llu delay avg=%llu max=%llu us\n",
+		   session->prio, session->sched_cnt,
+		   session->sched_cnt ?
+		   div64_u64(session->sched_delay_sum_us, session->sched_cnt) : 0,
+		   session->sched_delay_max_us);
 
 	return 0;
 }
@@ -269,6 +276,7 @@ static int mpp_show_support_cmd(struct seq_file *file, void *v)
 	seq_printf(file, "SET_REG_WRITE:        0x%08x\n", MPP_CMD_SET_REG_WRITE);
 	seq_printf(file, "SET_REG_READ:         0x%08x\n", MPP_CMD_SET_REG_READ);
 	seq_printf(file, "SET_REG_ADDR_OFFSET:  0x%08x\n", MPP_CMD_SET_REG_ADDR_OFFSET);
+	seq_printf(file, "SET_TASK_DEADLINE:    0x%08x\n", MPP_CMD_SET_TASK_DEADLINE);
 	seq_printf(file, "SEND_BUTT:            0x%08x\n", MPP_CMD_SEND_BUTT);
 	seq_puts(file, "----\n");
 	seq_printf(file, "POLL_HW_FINISH:       0x%08x\n", MPP_CMD_POLL_HW_FINISH);
@@ -278,6 +286,8 @@ static int mpp_show_support_cmd(struct seq_file *file, void *v)
 	seq_printf(file, "TRANS_FD_TO_IOVA:     0x%08x\n", MPP_CMD_TRANS_FD_TO_IOVA);
 	seq_printf(file, "RELEASE_FD:           0x%08x\n", MPP_CMD_RELEASE_FD);
 	seq_printf(file, "SEND_CODEC_INFO:      0x%08x\n", MPP_CMD_SEND_CODEC_INFO);
+	seq_printf(file, "SET_EVENTFD:          0x%08x\n", MPP_CMD_SET_EVENTFD);
+	seq_printf(file, "SET_SESSION_PRIO:     0x%08x\n", MPP_CMD_SET_SESSION_PRIO);
 	seq_printf(file, "CONTROL_BUTT:         0x%08x\n", MPP_CMD_CONTROL_BUTT);
 
 	return 0;
@@ -430,6 +440,7 @@ static int mpp_service_probe(struct platform_device *pdev)
 	MPP_REGISTER_DRIVER(srv, HAS_RKVENC2, RKVENC2, rkvenc2);
 	MPP_REGISTER_DRIVER(srv, HAS_AV1DEC, AV1DEC, av1dec);
 	MPP_REGISTER_DRIVER(srv, HAS_VDPP, VDPP, vdpp);
+	MPP_REGISTER_DRIVER(srv, HAS_NULL, MPPNULL, null);
 
 	dev_info(dev, "probe success\n");
 
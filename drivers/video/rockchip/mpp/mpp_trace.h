@@ -0,0 +1,97 @@
+/* SPDX-License-Identifier: (GPL-2.0+ OR MIT) */
+/*
+ * Copyright (c) 2024 Rockchip Electronics Co., Ltd
+ *
+ * Tracepoints of task life cycle in mpp service
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM	mpp
+
+#if !defined(_MPP_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _MPP_TRACE_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+
+#include "mpp_common.h"
+
+DECLARE_EVENT_CLASS(mpp_task,
+
+	TP_PROTO(struct mpp_dev *mpp, struct mpp_task *task),
+
+	TP_ARGS(mpp, task),
+
+	TP_STRUCT__entry(
+		__string(name, dev_name(mpp->dev))
+		__field(u32, session)
+		__field(u32, task)
+		__field(s32, core)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dev_name(mpp->dev));
+		__entry->session = task->session->index;
+		__entry->task = task->task_index;
+		__entry->core = task->core_id;
+	),
+
+	TP_printk("dev %s session %u task %u core %d",
+		  __get_str(name), __entry->session, __entry->task,
+		  __entry->core)
+);
+
+DEFINE_EVENT(mpp_task, mpp_task_enqueue,
+	     TP_PROTO(struct mpp_dev *mpp, struct mpp_task *task),
+	     TP_ARGS(mpp, task));
+
+DEFINE_EVENT(mpp_task, mpp_task_dispatch,
+	     TP_PROTO(struct mpp_dev *mpp, struct mpp_task *task),
+	     TP_ARGS(mpp, task));
+
+DEFINE_EVENT(mpp_task, mpp_task_hw_start,
+	     TP_PROTO(struct mpp_dev *mpp, struct mpp_task *task),
+	     TP_ARGS(mpp, task));
+
+DEFINE_EVENT(mpp_task, mpp_task_irq,
+	     TP_PROTO(struct mpp_dev *mpp, struct mpp_task *task),
+	     TP_ARGS(mpp, task));
+
+TRACE_EVENT(mpp_task_finish,
+
+	TP_PROTO(struct mpp_dev *mpp, struct mpp_task *task,
+		 s64 hw_us, s64 total_us),
+
+	TP_ARGS(mpp, task, hw_us, total_us),
+
+	TP_STRUCT__entry(
+		__string(name, dev_name(mpp->dev))
+		__field(u32, session)
+		__field(u32, task)
+		__field(s32, core)
+		__field(s64, hw_us)
+		__field(s64, total_us)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dev_name(mpp->dev));
+		__entry->session = task->session->index;
+		__entry->task = task->task_index;
+		__entry->core = task->core_id;
+		__entry->hw_us = hw_us;
+		__entry->total_us = total_us;
+	),
+
+	TP_printk("dev %s session %u task %u core %d hw %lld us total %lld us",
+		  __get_str(name), __entry->session, __entry->task,
+		  __entry->core, __entry->hw_us, __entry->total_us)
+);
+
+#endif /* _MPP_TRACE_H */
+
+/* this part must be outside header guard */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE mpp_trace
+#include <trace/define_trace.h>
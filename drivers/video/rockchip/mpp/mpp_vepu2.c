@@ -235,8 +235,8 @@ static int vepu_extract_task_msg(struct vepu_task *task,
 					    off_s, off_e);
 			if (ret)
 				continue;
-			if (copy_from_user((u8 *)task->reg + req->offset,
-					   req->data, req->size)) {
+			if (mpp_msgs_copy_from_user(msgs, (u8 *)task->reg + req->offset,
+						    req->data, req->size)) {
 				mpp_err("copy_from_user reg failed\n");
 				return -EIO;
 			}
@@ -254,7 +254,7 @@ static int vepu_extract_task_msg(struct vepu_task *task,
 			       req, sizeof(*req));
 		} break;
 		case MPP_CMD_SET_REG_ADDR_OFFSET: {
-			mpp_extract_reg_offset_info(&task->off_inf, req);
+			mpp_extract_reg_offset_info(msgs, &task->off_inf, req);
 		} break;
 		default:
 			break;
@@ -519,6 +519,8 @@ static int vepu_free_task(struct mpp_session *session,
 {
 	struct vepu_task *task = to_vepu_task(mpp_task);
 
+	if (task->bs_buf)
+		mpp_dma_release(session->dma, task->bs_buf);
 	mpp_task_finalize(session, mpp_task);
 	kfree(task);
 
@@ -10,6 +10,7 @@
 
 #include <linux/list.h>
 #include <linux/mutex.h>
+#include <linux/rcupdate.h>
 #include <linux/videodev2.h>
 #include <media/media-request.h>
 
@@ -230,6 +231,9 @@ typedef void (*v4l2_ctrl_notify_fnc)(struct v4l2_ctrl *ctrl, void *priv);
  *		array for both the cur and new values. So @p_array is actually
  *		sized for 2 * @p_array_alloc_elems * @elem_size. Only valid if
  *		@is_array is true.
+ * @snap_idx:	Index of the current value in the value snapshot of the
+ *		handler, or -1 if the control is not part of the snapshot.
+ *		Drivers should never touch this field.
  * @cur:	Structure to store the current value.
  * @cur.val:	The control's current value, if the @type is represented via
  *		a u32 integer (see &enum v4l2_ctrl_type).
@@ -290,6 +294,7 @@ struct v4l2_ctrl {
 	void *priv;
 	void *p_array;
 	u32 p_array_alloc_elems;
+	int snap_idx;
 	s32 val;
 	struct {
 		s32 val;
@@ -352,6 +357,26 @@ struct v4l2_ctrl_ref {
 	union v4l2_ctrl_ptr p_req;
 };
 
+/**
+ * struct v4l2_ctrl_snapshot - A read-only copy of the current control values.
+ *
+ * @rcu:	Used to free the snapshot once it is replaced.
+ * @nr_of_vals:	Number of entries in @vals.
+ * @vals:	The current values, indexed by &v4l2_ctrl->snap_idx.
+ *
+ * The snapshot holds the values of all non-compound integer controls of a
+ * handler (%V4L2_CTRL_TYPE_INTEGER, _INTEGER64, _BOOLEAN, _MENU,
+ * _INTEGER_MENU and _BITMASK). Once enabled for the handler with
+ * v4l2_ctrl_handler_enable_snapshot(), it is published through RCU every
+ * time one or more of those values changes, so drivers can read the current
+ * values without taking the handler lock, see v4l2_ctrl_g_ctrl_snapshot().
+ */
+struct v4l2_ctrl_snapshot {
+	struct rcu_head rcu;
+	u32 nr_of_vals;
+	s64 vals[];
+};
+
 /**
  * struct v4l2_ctrl_handler - The control handler keeps track of all the
  *	controls: both the controls owned by the handler and those inherited
@@ -384,6 +409,16 @@ struct v4l2_ctrl_ref {
  *		completed it is removed from this list.
  * @req_obj:	The &struct media_request_object, used to link into a
  *		&struct media_request. This request object has a refcount.
+ * @snapshot:	The last published &struct v4l2_ctrl_snapshot, or NULL.
+ * @nr_of_snap_vals: Number of controls owned by the handler that are part
+ *		of the snapshot.
+ * @snap_enabled: Set by v4l2_ctrl_handler_enable_snapshot(), the snapshot is
+ *		only kept up to date for the handlers that need it.
+ * @snap_dirty:	Set when one of the snapshot values changed since the last
+ *		time the snapshot was published.
+ * @snap_batch:	Set while a batch of values is applied, see
+ *		__v4l2_ctrl_s_ctrls_batch(). The snapshot is only published
+ *		once at the end of the batch.
  */
 struct v4l2_ctrl_handler {
 	struct mutex _lock;
@@ -400,6 +435,23 @@ struct v4l2_ctrl_handler {
 	struct list_head requests;
 	struct list_head requests_queued;
 	struct media_request_object req_obj;
+	struct v4l2_ctrl_snapshot __rcu *snapshot;
+	u32 nr_of_snap_vals;
+	bool snap_enabled;
+	bool snap_dirty;
+	bool snap_batch;
+};
+
+/**
+ * struct v4l2_ctrl_batch_val - A control value of a batched update.
+ *
+ * @ctrl:	The control.
+ * @val:	The new value. On success this is updated with the value that
+ *		was actually applied (e.g. rounded to the control's step).
+ */
+struct v4l2_ctrl_batch_val {
+	struct v4l2_ctrl *ctrl;
+	s64 val;
 };
 
 /**
@@ -1159,6 +1211,99 @@ static inline int v4l2_ctrl_s_ctrl_int64(struct v4l2_ctrl *ctrl, s64 val)
 	return rval;
 }
 
+/**
+ * v4l2_ctrl_handler_enable_snapshot() - Keep a value snapshot of the handler.
+ *
+ * @hdl:	The control handler.
+ *
+ * Publishing a snapshot copies all the values of the handler on each change,
+ * so it is only done for the handlers whose values are read with
+ * v4l2_ctrl_g_ctrl_snapshot() or v4l2_ctrl_g_ctrls_snapshot(). This may be
+ * called more than once, and by another driver than the handler owner.
+ *
+ * Returns 0 on success or -ENOMEM if the first snapshot can't be allocated.
+ */
+int v4l2_ctrl_handler_enable_snapshot(struct v4l2_ctrl_handler *hdl);
+
+/**
+ * v4l2_ctrl_g_ctrl_snapshot() - Helper function to get the current value of
+ *	a control without locking its handler.
+ *
+ * @ctrl:	The control.
+ *
+ * This returns the control's value from the last published value snapshot
+ * of its handler, which must have snapshots enabled with
+ * v4l2_ctrl_handler_enable_snapshot(). It never sleeps and does not take the
+ * handler lock, so it can be used from interrupt context and from within the
+ * &v4l2_ctrl_ops functions. Volatile controls are not refreshed: the value is
+ * the one that was last set.
+ *
+ * This function is for non-compound integer type controls only.
+ */
+s64 v4l2_ctrl_g_ctrl_snapshot(struct v4l2_ctrl *ctrl);
+
+/**
+ * v4l2_ctrl_g_ctrls_snapshot() - Helper function to get the current values
+ *	of several controls without locking their handler.
+ *
+ * @ctrls:	Array of controls.
+ * @vals:	Array filled with the values of @ctrls.
+ * @num:	Number of entries in @ctrls and @vals.
+ *
+ * Like v4l2_ctrl_g_ctrl_snapshot(), but all values owned by the same handler
+ * are taken from the same snapshot, so values set together by
+ * __v4l2_ctrl_s_ctrls_batch() are never seen half applied.
+ */
+void v4l2_ctrl_g_ctrls_snapshot(struct v4l2_ctrl * const *ctrls, s64 *vals,
+				unsigned int num);
+
+/**
+ * __v4l2_ctrl_s_ctrls_batch() - Unlocked variant of v4l2_ctrl_s_ctrls_batch().
+ *
+ * @hdl:	The control handler owning all the controls.
+ * @vals:	Array of controls and their new values.
+ * @num:	Number of entries in @vals.
+ *
+ * This sets the new values of several controls at once, typically the
+ * per-frame exposure and gain controls of a sensor. All values are validated
+ * and all touched clusters are tried before any of them is applied, each
+ * cluster is set once and the value snapshot of the handler is published
+ * once, after the whole batch. If the s_ctrl op of a cluster fails, the
+ * clusters set before it stay applied and published. This function assumes
+ * the handler is already locked, allowing it to be used from within the
+ * &v4l2_ctrl_ops functions.
+ *
+ * This function is for non-compound integer type controls only, all owned
+ * by @hdl.
+ */
+int __v4l2_ctrl_s_ctrls_batch(struct v4l2_ctrl_handler *hdl,
+			      struct v4l2_ctrl_batch_val *vals,
+			      unsigned int num);
+
+/**
+ * v4l2_ctrl_s_ctrls_batch() - Helper function to set several control values
+ *	at once from within a driver.
+ *
+ * @hdl:	The control handler owning all the controls.
+ * @vals:	Array of controls and their new values.
+ * @num:	Number of entries in @vals.
+ *
+ * See __v4l2_ctrl_s_ctrls_batch(). This function will lock the handler, so
+ * it cannot be used from within the &v4l2_ctrl_ops functions.
+ */
+static inline int v4l2_ctrl_s_ctrls_batch(struct v4l2_ctrl_handler *hdl,
+					  struct v4l2_ctrl_batch_val *vals,
+					  unsigned int num)
+{
+	int rval;
+
+	mutex_lock(hdl->lock);
+	rval = __v4l2_ctrl_s_ctrls_batch(hdl, vals, num);
+	mutex_unlock(hdl->lock);
+
+	return rval;
+}
+
 /**
  * __v4l2_ctrl_s_ctrl_string() - Unlocked variant of v4l2_ctrl_s_ctrl_string().
  *
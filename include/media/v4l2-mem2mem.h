@@ -38,11 +38,21 @@
  *		if the transaction ended normally.
  *		This function does not have to (and will usually not) wait
  *		until the device enters a state when it can be stopped.
+ * @device_prepare: optional. Called for the next queued job while all the
+ *		job slots of the device are busy, so the driver can set up
+ *		that job (e.g. compute its register values) while the
+ *		running ones go on. It is called at most once per job, in
+ *		non-atomic context and never concurrently with device_run()
+ *		for the same instance. The buffers stay on the ready queues,
+ *		and the job may still be canceled without device_run() being
+ *		called, so the driver must check in device_run() that what
+ *		was prepared is still valid.
  */
 struct v4l2_m2m_ops {
 	void (*device_run)(void *priv);
 	int (*job_ready)(void *priv);
 	void (*job_abort)(void *priv);
+	void (*device_prepare)(void *priv);
 };
 
 struct video_device;
@@ -138,6 +148,10 @@ struct v4l2_m2m_buffer {
  * running instance or NULL if no instance is running
  *
  * @m2m_dev: opaque pointer to the internal data to handle M2M context
+ *
+ * When more than one job may run at a time, see v4l2_m2m_set_max_jobs(),
+ * this is the instance which was started last, and the driver has to keep
+ * track of the instance of each job itself.
  */
 void *v4l2_m2m_get_curr_priv(struct v4l2_m2m_dev *m2m_dev);
 
@@ -311,7 +325,7 @@ void v4l2_m2m_last_buffer_done(struct v4l2_m2m_ctx *m2m_ctx,
  * @m2m_dev: opaque pointer to the internal data to handle M2M context
  *
  * Called by a driver in the suspend hook. Stop new jobs from being run, and
- * wait for current running job to finish.
+ * wait for all the running jobs to finish.
  */
 void v4l2_m2m_suspend(struct v4l2_m2m_dev *m2m_dev);
 
@@ -511,6 +525,23 @@ unsigned long v4l2_m2m_get_unmapped_area(struct file *file, unsigned long addr,
  */
 struct v4l2_m2m_dev *v4l2_m2m_init(const struct v4l2_m2m_ops *m2m_ops);
 
+/**
+ * v4l2_m2m_set_max_jobs() - set the number of jobs which may run at a time
+ *
+ * @m2m_dev: opaque pointer to the internal data to handle M2M context
+ * @max_jobs: the number of jobs, at least 1
+ *
+ * By default a single job runs at a time. Devices with several processing
+ * cores may run the jobs of up to @max_jobs different instances at the same
+ * time, each instance still has at most one job queued or running. The
+ * driver must be able to tell the instance of each finished job, as
+ * v4l2_m2m_get_curr_priv() only returns the last started one.
+ *
+ * Should be called from the driver's ``probe()`` function, before any
+ * instance is opened.
+ */
+void v4l2_m2m_set_max_jobs(struct v4l2_m2m_dev *m2m_dev, unsigned int max_jobs);
+
 #if defined(CONFIG_MEDIA_CONTROLLER)
 void v4l2_m2m_unregister_media_controller(struct v4l2_m2m_dev *m2m_dev);
 int v4l2_m2m_register_media_controller(struct v4l2_m2m_dev *m2m_dev,
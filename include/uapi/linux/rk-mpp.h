@@ -14,6 +14,7 @@
 
 #define MPP_IOC_CFG_V1			_IOW(MPP_IOC_MAGIC, 1, unsigned int)
 #define MPP_IOC_CFG_V2			_IOW(MPP_IOC_MAGIC, 2, unsigned int)
+#define MPP_IOC_CFG_BATCH		_IOW(MPP_IOC_MAGIC, 3, struct mpp_batch)
 
 /**
  * Command type: keep the same as user space
@@ -37,6 +38,7 @@ enum MPP_DEV_COMMAND_TYPE {
 	MPP_CMD_SET_REG_ADDR_OFFSET	= MPP_CMD_SEND_BASE + 2,
 	MPP_CMD_SET_RCB_INFO		= MPP_CMD_SEND_BASE + 3,
 	MPP_CMD_SET_SESSION_FD		= MPP_CMD_SEND_BASE + 4,
+	MPP_CMD_SET_TASK_DEADLINE	= MPP_CMD_SEND_BASE + 5,
 	MPP_CMD_SEND_BUTT,
 
 	MPP_CMD_POLL_BASE		= 0x300,
@@ -49,6 +51,8 @@ enum MPP_DEV_COMMAND_TYPE {
 	MPP_CMD_TRANS_FD_TO_IOVA	= MPP_CMD_CONTROL_BASE + 1,
 	MPP_CMD_RELEASE_FD		= MPP_CMD_CONTROL_BASE + 2,
 	MPP_CMD_SEND_CODEC_INFO		= MPP_CMD_CONTROL_BASE + 3,
+	MPP_CMD_SET_EVENTFD		= MPP_CMD_CONTROL_BASE + 4,
+	MPP_CMD_SET_SESSION_PRIO	= MPP_CMD_CONTROL_BASE + 5,
 	MPP_CMD_CONTROL_BUTT,
 
 	MPP_CMD_BUTT,
@@ -73,10 +77,86 @@ struct mpp_request {
 
 #define MPP_BAT_MSG_DONE		(0x00000001)
 
+/*
+ * Session priority for MPP_CMD_SET_SESSION_PRIO
+ *
+ * Tasks sharing one taskqueue run earliest deadline first. A task without
+ * deadline set by MPP_CMD_SET_TASK_DEADLINE (__u32 in us from submission)
+ * gets the slack of its session priority, so that bulk sessions yield to
+ * realtime ones but are never starved. Tasks of one session keep order.
+ * MPP_SESSION_PRIO_RT requires CAP_SYS_NICE.
+ */
+enum MPP_SESSION_PRIO {
+	MPP_SESSION_PRIO_RT		= 0,
+	MPP_SESSION_PRIO_NORMAL		= 1,
+	MPP_SESSION_PRIO_BULK		= 2,
+	MPP_SESSION_PRIO_BUTT,
+};
+
 struct mpp_bat_msg {
 	__u64 flag;
 	__u32 fd;
 	__s32 ret;
 };
 
+/*
+ * Batch submission for MPP_IOC_CFG_BATCH
+ *
+ * All tasks of one batch are described in a single contiguous payload, which
+ * is copied into kernel at once. The payload starts with task_cnt tasks, each
+ * task header is followed by its req_cnt requests. Register data of the
+ * requests are located by data_offset from the start of the payload. Each
+ * task is run as the message list of one MPP_IOC_CFG_V1 call.
+ */
+struct mpp_batch_req {
+	__u32 cmd;
+	__u32 flags;
+	__u32 size;
+	__u32 offset;
+	__u32 data_offset;
+	__u32 reserved;
+};
+
+struct mpp_batch_task {
+	__u32 req_cnt;
+	__u32 flags;
+	__u64 user_data;
+	struct mpp_batch_req reqs[];
+};
+
+/*
+ * completion for each task, written back in submission order. When a task
+ * fails to be set up, it gets the error and the tasks after it are not run
+ * and get -ECANCELED.
+ */
+struct mpp_batch_result {
+	__u64 user_data;
+	__u32 task_id;
+	__s32 ret;
+};
+
+struct mpp_batch {
+	__u32 task_cnt;
+	__u32 flags;
+	__u32 size;
+	__u32 reserved;
+	__u64 data_ptr;
+	__u64 result_ptr;
+};
+
+/*
+ * Asynchronous completion
+ *
+ * Tasks sent without MPP_CMD_POLL_HW_FINISH can be collected by read() on
+ * the session fd, which returns one record per finished task in submission
+ * order and copies back the registers of MPP_CMD_SET_REG_READ like the poll
+ * command does. poll() reports EPOLLIN once the oldest task is finished,
+ * and an eventfd bound by MPP_CMD_SET_EVENTFD is signaled on each finished
+ * task. A negative eventfd unbinds it.
+ */
+struct mpp_task_done {
+	__u32 task_id;
+	__s32 ret;
+};
+
 #endif /* _UAPI_RK_MPP_H */
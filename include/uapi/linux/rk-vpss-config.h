@@ -68,6 +68,10 @@
 #define RKVPSS_CMD_CHECKPARAMS \
 	_IOW('V', BASE_VIDIOC_PRIVATE + 55, struct rkvpss_frame_cfg)
 
+/* queue frames to handle in order, without waiting for them */
+#define RKVPSS_CMD_FRAME_QUEUE \
+	_IOWR('V', BASE_VIDIOC_PRIVATE + 56, struct rkvpss_frame_batch)
+
 /********************************************************************/
 
 /* struct rkvpss_mirror_flip
@@ -264,6 +268,23 @@ struct rkvpss_frame_cfg {
 	struct rkvpss_output_cfg output[RKVPSS_OUTPUT_MAX];
 } __attribute__ ((packed));
 
+#define RKVPSS_FRAME_BATCH_MAX 16
+
+/* struct rkvpss_frame_batch
+ * frame handle configures queued at once
+ *
+ * cnt: number of frame configures, range 1~RKVPSS_FRAME_BATCH_MAX.
+ * out_fence_fd: return sync_file fd, signaled once all the frames are handled.
+ *               the fence has an error status if one of the frames failed,
+ *               and the next frames of the batch are not handled.
+ * cfg: user pointer to an array of cnt struct rkvpss_frame_cfg.
+ */
+struct rkvpss_frame_batch {
+	int cnt;
+	int out_fence_fd;
+	__u64 cfg;
+} __attribute__ ((packed));
+
 #define RKVPSS_BUF_MAX 32
 
 /* struct rkvpss_buf_info